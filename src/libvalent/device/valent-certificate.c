@@ -456,3 +456,111 @@ out:
   return g_object_get_data (G_OBJECT (certificate), "valent-certificate-pk");
 }
 
+
+/*
+ * Trusted Certificates
+ *
+ * Certificates of paired devices are loaded from the device configuration
+ * directory on first use, and cached by device ID until invalidated. Misses
+ * are not cached, since the device ID is chosen by the peer and any host on
+ * the network could otherwise grow the table without bound.
+ *
+ * The generation is incremented by each invalidation, so that a lookup racing
+ * with an invalidation does not cache the state it read before.
+ */
+static GMutex      trusted_lock;
+static GHashTable *trusted_certificates = NULL;
+static uint64_t    trusted_generation = 0;
+
+/**
+ * valent_certificate_ref_trusted:
+ * @device_id: a device ID
+ *
+ * Get the trusted certificate for @device_id.
+ *
+ * The certificate is read from the device configuration directory the first
+ * time it is requested, then cached until [func@Valent.certificate_invalidate]
+ * is called for @device_id.
+ *
+ * Returns: (transfer full) (nullable): a `GTlsCertificate`,
+ *   or %NULL if the device is not paired
+ *
+ * Since: 1.0
+ */
+GTlsCertificate *
+valent_certificate_ref_trusted (const char *device_id)
+{
+  g_autoptr (GTlsCertificate) certificate = NULL;
+  g_autofree char *path = NULL;
+  gpointer value = NULL;
+  uint64_t generation;
+
+  g_return_val_if_fail (valent_device_validate_id (device_id), NULL);
+
+  g_mutex_lock (&trusted_lock);
+  if (trusted_certificates != NULL &&
+      (value = g_hash_table_lookup (trusted_certificates, device_id)) != NULL)
+    {
+      certificate = g_object_ref (value);
+      g_mutex_unlock (&trusted_lock);
+
+      return g_steal_pointer (&certificate);
+    }
+  generation = trusted_generation;
+  g_mutex_unlock (&trusted_lock);
+
+  /* The file is read without holding the lock; if a concurrent lookup wins
+   * the race its entry is kept, and if the entry was invalidated in the
+   * meantime the result is returned without being cached.
+   */
+  path = g_build_filename (g_get_user_config_dir (), PACKAGE_NAME,
+                           "device", device_id,
+                           "certificate.pem",
+                           NULL);
+  certificate = g_tls_certificate_new_from_file (path, NULL);
+  if (certificate == NULL)
+    return NULL;
+
+  g_mutex_lock (&trusted_lock);
+  if (trusted_certificates == NULL)
+    {
+      trusted_certificates = g_hash_table_new_full (g_str_hash,
+                                                    g_str_equal,
+                                                    g_free,
+                                                    g_object_unref);
+    }
+
+  if (generation == trusted_generation &&
+      !g_hash_table_contains (trusted_certificates, device_id))
+    {
+      g_hash_table_insert (trusted_certificates,
+                           g_strdup (device_id),
+                           g_object_ref (certificate));
+    }
+  g_mutex_unlock (&trusted_lock);
+
+  return g_steal_pointer (&certificate);
+}
+
+/**
+ * valent_certificate_invalidate:
+ * @device_id: a device ID
+ *
+ * Invalidate the cached trusted certificate for @device_id.
+ *
+ * This should be called when a device is paired or unpaired, so that the next
+ * call to [func@Valent.certificate_ref_trusted] reads the current state.
+ *
+ * Since: 1.0
+ */
+void
+valent_certificate_invalidate (const char *device_id)
+{
+  g_return_if_fail (device_id != NULL && *device_id != '\0');
+
+  g_mutex_lock (&trusted_lock);
+  if (trusted_certificates != NULL)
+    g_hash_table_remove (trusted_certificates, device_id);
+  trusted_generation++;
+  g_mutex_unlock (&trusted_lock);
+}
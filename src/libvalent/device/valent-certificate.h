@@ -28,6 +28,10 @@ VALENT_AVAILABLE_IN_1_0
 const char      * valent_certificate_get_common_name (GTlsCertificate  *certificate);
 VALENT_AVAILABLE_IN_1_0
 GByteArray      * valent_certificate_get_public_key  (GTlsCertificate  *certificate);
+VALENT_AVAILABLE_IN_1_0
+GTlsCertificate * valent_certificate_ref_trusted     (const char       *device_id);
+VALENT_AVAILABLE_IN_1_0
+void              valent_certificate_invalidate      (const char       *device_id);
 
 G_END_DECLS
 
@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Andy Holmes <andrew.g.r.holmes@gmail.com>
+
+#pragma once
+
+#include "valent-channel.h"
+
+G_BEGIN_DECLS
+
+_VALENT_EXTERN
+size_t   valent_channel_read_packet_get_size (GAsyncResult *result);
+
+G_END_DECLS
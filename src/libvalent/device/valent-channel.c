@@ -13,8 +13,17 @@
 
 #include "valent-certificate.h"
 #include "valent-packet.h"
+#include "valent-packet-private.h"
 
 #include "valent-channel.h"
+#include "valent-channel-private.h"
+
+#define PACKET_MAX_SIZE    (64 * 1024 * 1024)
+#define PACKET_READ_SIZE   (16 * 1024)
+#define PACKET_THREAD_SIZE (64 * 1024)
+#define WRITE_BATCH_MAX    (64)
+#define WRITE_BATCH_SIZE   (64 * 1024)
+#define WRITE_BULK_SKIP    (4)
 
 
 /**
@@ -48,16 +57,18 @@
 
 typedef struct
 {
-  GIOStream        *base_stream;
-  GTlsCertificate  *certificate;
-  JsonNode         *identity;
-  GTlsCertificate  *peer_certificate;
-  JsonNode         *peer_identity;
+  GIOStream           *base_stream;
+  GTlsCertificate     *certificate;
+  JsonNode            *identity;
+  GTlsCertificate     *peer_certificate;
+  JsonNode            *peer_identity;
 
   /* Packet Buffer */
-  GDataInputStream *input_buffer;
-  GQueue            output_buffer;
-  unsigned int      pending : 1;
+  ValentPacketDecoder *input_buffer;
+  ValentPacketEncoder *output_encoder;
+  GQueue               output_buffer[3];
+  unsigned int         output_skipped;
+  unsigned int         pending : 1;
 } ValentChannelPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (ValentChannel, valent_channel, VALENT_TYPE_OBJECT)
@@ -176,13 +187,8 @@ valent_channel_set_base_stream (ValentChannel *self,
   valent_object_lock (VALENT_OBJECT (self));
   if (g_set_object (&priv->base_stream, base_stream))
     {
-      GInputStream *input_stream;
-
-      input_stream = g_io_stream_get_input_stream (base_stream);
-      priv->input_buffer = g_object_new (G_TYPE_DATA_INPUT_STREAM,
-                                         "base-stream",       input_stream,
-                                         "close-base-stream", FALSE,
-                                         NULL);
+      g_clear_pointer (&priv->input_buffer, valent_packet_decoder_unref);
+      priv->input_buffer = valent_packet_decoder_new (PACKET_MAX_SIZE);
     }
   valent_object_unlock (VALENT_OBJECT (self));
 }
@@ -210,7 +216,8 @@ valent_channel_finalize (GObject *object)
   ValentChannelPrivate *priv = valent_channel_get_instance_private (self);
 
   valent_object_lock (VALENT_OBJECT (self));
-  g_clear_object (&priv->input_buffer);
+  g_clear_pointer (&priv->input_buffer, valent_packet_decoder_unref);
+  g_clear_pointer (&priv->output_encoder, valent_packet_encoder_unref);
   g_clear_object (&priv->base_stream);
   g_clear_object (&priv->certificate);
   g_clear_pointer (&priv->identity, json_node_unref);
@@ -420,6 +427,9 @@ valent_channel_class_init (ValentChannelClass *klass)
 static void
 valent_channel_init (ValentChannel *self)
 {
+  ValentChannelPrivate *priv = valent_channel_get_instance_private (self);
+
+  priv->output_encoder = valent_packet_encoder_new ();
 }
 
 /**
@@ -567,20 +577,23 @@ valent_channel_close (ValentChannel  *channel,
   valent_object_lock (VALENT_OBJECT (channel));
   if (priv->base_stream != NULL && priv->input_buffer != NULL)
     {
-      g_autoptr (GTask) task = NULL;
-
-      task = g_queue_pop_head (&priv->output_buffer);
-      while (task != NULL)
+      for (unsigned int i = 0; i < G_N_ELEMENTS (priv->output_buffer); i++)
         {
-          g_task_return_new_error_literal (task,
-                                           G_IO_ERROR,
-                                           G_IO_ERROR_CONNECTION_CLOSED,
-                                           g_strerror (EPIPE));
-          g_clear_object (&task);
-          task = g_queue_pop_head (&priv->output_buffer);
+          g_autoptr (GTask) task = NULL;
+
+          task = g_queue_pop_head (&priv->output_buffer[i]);
+          while (task != NULL)
+            {
+              g_task_return_new_error_literal (task,
+                                               G_IO_ERROR,
+                                               G_IO_ERROR_CONNECTION_CLOSED,
+                                               g_strerror (EPIPE));
+              g_clear_object (&task);
+              task = g_queue_pop_head (&priv->output_buffer[i]);
+            }
         }
 
-      g_clear_object (&priv->input_buffer);
+      g_clear_pointer (&priv->input_buffer, valent_packet_decoder_unref);
       ret = g_io_stream_close (priv->base_stream, cancellable, error);
     }
   valent_object_unlock (VALENT_OBJECT (channel));
@@ -669,26 +682,65 @@ valent_channel_close_finish (ValentChannel  *channel,
   VALENT_RETURN (ret);
 }
 
+typedef struct
+{
+  GInputStream        *stream;
+  ValentPacketDecoder *decoder;
+  GBytes              *bytes;
+  size_t               size;
+} ReadData;
+
 static void
-valent_channel_read_packet_cb (GObject      *object,
-                               GAsyncResult *result,
-                               gpointer      user_data)
+read_data_free (gpointer user_data)
 {
-  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
-  g_autofree char *line = NULL;
+  ReadData *data = (ReadData *)user_data;
+
+  g_clear_object (&data->stream);
+  g_clear_pointer (&data->decoder, valent_packet_decoder_unref);
+  g_clear_pointer (&data->bytes, g_bytes_unref);
+  g_free (data);
+}
+
+static void
+valent_channel_decode_task (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+  ReadData *data = (ReadData *)task_data;
+  g_autoptr (GBytes) bytes = g_steal_pointer (&data->bytes);
   JsonNode *packet = NULL;
   GError *error = NULL;
 
-  line = g_data_input_stream_read_line_finish_utf8 (G_DATA_INPUT_STREAM (object),
-                                                    result,
-                                                    NULL,
-                                                    &error);
-  if (error != NULL)
+  packet = valent_packet_decode (bytes, &error);
+  if (packet == NULL)
     {
       g_task_return_error (task, g_steal_pointer (&error));
       return;
     }
-  else if (line == NULL)
+
+  g_task_return_pointer (task, packet, (GDestroyNotify)json_node_unref);
+}
+
+static void valent_channel_read_packet_next (GTask *task);
+
+static void
+g_input_stream_read_cb (GInputStream *stream,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
+  ReadData *data = g_task_get_task_data (task);
+  gssize n_read;
+  GError *error = NULL;
+
+  n_read = g_input_stream_read_finish (stream, result, &error);
+  if (n_read < 0)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+  else if (n_read == 0)
     {
       g_task_return_new_error (task,
                                G_IO_ERROR,
@@ -697,16 +749,61 @@ valent_channel_read_packet_cb (GObject      *object,
       return;
     }
 
-  packet = valent_packet_deserialize (line, &error);
-  if (packet == NULL)
+  valent_packet_decoder_commit (data->decoder, n_read);
+  valent_channel_read_packet_next (task);
+}
+
+/*
+ * Packets are decoded incrementally as data arrives, so each byte is only
+ * scanned once and malformed or oversized packets are rejected early. Large
+ * packets are parsed in a thread and returned to the caller's main context.
+ */
+static void
+valent_channel_read_packet_next (GTask *task)
+{
+  ReadData *data = g_task_get_task_data (task);
+  g_autoptr (GBytes) bytes = NULL;
+  uint8_t *buffer = NULL;
+  GError *error = NULL;
+
+  bytes = valent_packet_decoder_next (data->decoder, &error);
+  if (bytes != NULL)
+    {
+      JsonNode *packet = NULL;
+
+      data->size = g_bytes_get_size (bytes);
+
+      if (g_bytes_get_size (bytes) >= PACKET_THREAD_SIZE)
+        {
+          data->bytes = g_steal_pointer (&bytes);
+          g_task_run_in_thread (task, valent_channel_decode_task);
+          return;
+        }
+
+      packet = valent_packet_decode (bytes, &error);
+      if (packet == NULL)
+        {
+          g_task_return_error (task, g_steal_pointer (&error));
+          return;
+        }
+
+      g_task_return_pointer (task, packet, (GDestroyNotify)json_node_unref);
+      return;
+    }
+  else if (error != NULL)
     {
       g_task_return_error (task, g_steal_pointer (&error));
       return;
     }
 
-  g_task_return_pointer (task,
-                         g_steal_pointer (&packet),
-                         (GDestroyNotify)json_node_unref);
+  buffer = valent_packet_decoder_prepare (data->decoder, PACKET_READ_SIZE);
+  g_input_stream_read_async (data->stream,
+                             buffer,
+                             PACKET_READ_SIZE,
+                             g_task_get_priority (task),
+                             g_task_get_cancellable (task),
+                             (GAsyncReadyCallback)g_input_stream_read_cb,
+                             g_object_ref (task));
 }
 
 /**
@@ -741,12 +838,15 @@ valent_channel_read_packet (ValentChannel       *channel,
 
   if (!valent_channel_return_error_if_closed (channel, task))
     {
-      g_data_input_stream_read_line_async (priv->input_buffer,
-                                           G_PRIORITY_DEFAULT,
-                                           cancellable,
-                                           valent_channel_read_packet_cb,
-                                           g_object_ref (task));
+      ReadData *data = NULL;
+
+      data = g_new0 (ReadData, 1);
+      data->stream = g_object_ref (g_io_stream_get_input_stream (priv->base_stream));
+      data->decoder = valent_packet_decoder_ref (priv->input_buffer);
+      g_task_set_task_data (task, data, read_data_free);
       valent_object_unlock (VALENT_OBJECT (channel));
+
+      valent_channel_read_packet_next (task);
     }
 
   VALENT_EXIT;
@@ -782,53 +882,266 @@ valent_channel_read_packet_finish (ValentChannel  *channel,
   VALENT_RETURN (ret);
 }
 
+/*< private >
+ * valent_channel_read_packet_get_size:
+ * @result: a `GAsyncResult` from [method@Valent.Channel.read_packet]
+ *
+ * Get the encoded size of the packet read by @result, for accounting.
+ *
+ * Returns: the packet size in bytes, or `0` if unknown
+ */
+size_t
+valent_channel_read_packet_get_size (GAsyncResult *result)
+{
+  ReadData *data;
+
+  g_return_val_if_fail (G_IS_TASK (result), 0);
+
+  if (g_task_get_source_tag (G_TASK (result)) != valent_channel_read_packet)
+    return 0;
+
+  data = g_task_get_task_data (G_TASK (result));
+
+  return data != NULL ? data->size : 0;
+}
+
+/**
+ * valent_channel_push_input:
+ * @channel: a `ValentChannel`
+ * @bytes: a `GBytes`
+ *
+ * Prepend data to the incoming packet buffer.
+ *
+ * This is intended for [class@Valent.ChannelService] implementations that read
+ * past the end of the peer identity packet during the handshake (e.g. with
+ * [func@Valent.packet_from_stream_full]). The data will be read before any
+ * further data from [property@Valent.Channel:base-stream], so it must be called
+ * before the first call to [method@Valent.Channel.read_packet].
+ *
+ * Since: 1.0
+ */
+void
+valent_channel_push_input (ValentChannel *channel,
+                           GBytes        *bytes)
+{
+  ValentChannelPrivate *priv = valent_channel_get_instance_private (channel);
+  const uint8_t *data;
+  size_t size;
+
+  g_return_if_fail (VALENT_IS_CHANNEL (channel));
+  g_return_if_fail (bytes != NULL);
+
+  data = g_bytes_get_data (bytes, &size);
+
+  valent_object_lock (VALENT_OBJECT (channel));
+  if (priv->input_buffer != NULL)
+    valent_packet_decoder_unread (priv->input_buffer, data, size);
+  valent_object_unlock (VALENT_OBJECT (channel));
+}
+
 static void valent_channel_write_packet_next (ValentChannel *self);
 
+/*
+ * Priority Lanes
+ *
+ * Outgoing packets are sorted into lanes, so that latency-sensitive packets
+ * are not stuck behind large transfers, such as a contact list or message
+ * history. Packets are never split, so a lane can only overtake another at
+ * packet boundaries.
+ *
+ * The interactive lane is always served first. The bulk lane is served after
+ * the normal lane, but takes precedence once it has been passed over for
+ * %WRITE_BULK_SKIP batches, so that it can not be starved.
+ *
+ * Packets are only sent in the bulk lane if the caller asks for it, since a
+ * packet with a payload may be followed by another for the same resource, such
+ * as a notification icon and its cancellation.
+ */
+enum {
+  LANE_INTERACTIVE,
+  LANE_NORMAL,
+  LANE_BULK,
+};
+
+static inline unsigned int
+valent_channel_get_lane (JsonNode *packet,
+                         int       io_priority)
+{
+  const char *type;
+
+  if (io_priority < G_PRIORITY_DEFAULT)
+    return LANE_INTERACTIVE;
+
+  if (io_priority > G_PRIORITY_DEFAULT)
+    return LANE_BULK;
+
+  type = valent_packet_get_type (packet);
+  if (g_str_equal (type, "kdeconnect.pair") ||
+      g_str_equal (type, "kdeconnect.ping") ||
+      g_str_equal (type, "kdeconnect.presenter") ||
+      g_str_has_prefix (type, "kdeconnect.mousepad."))
+    return LANE_INTERACTIVE;
+
+  return LANE_NORMAL;
+}
+
+/*
+ * Write Coalescing
+ *
+ * Packets queued while a write is in progress are collected into a single
+ * vectored write, up to a byte budget. This allows bursts of small packets to
+ * share a TLS record and a main loop iteration, while each packet's task is
+ * still completed individually.
+ */
+typedef struct
+{
+  ValentChannel  *channel;
+  GPtrArray      *tasks;
+  GOutputVector  *vectors;
+} WriteBatch;
+
 static void
-g_output_stream_write_all_cb (GOutputStream *stream,
-                              GAsyncResult  *result,
-                              gpointer       user_data)
+write_batch_free (gpointer user_data)
 {
-  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
-  ValentChannel *self = g_task_get_source_object (task);
-  GError *error = NULL;
+  WriteBatch *batch = (WriteBatch *)user_data;
+
+  g_clear_object (&batch->channel);
+  g_clear_pointer (&batch->tasks, g_ptr_array_unref);
+  g_clear_pointer (&batch->vectors, g_free);
+  g_free (batch);
+}
+
+static void
+g_output_stream_writev_all_cb (GOutputStream *stream,
+                               GAsyncResult  *result,
+                               gpointer       user_data)
+{
+  WriteBatch *batch = (WriteBatch *)user_data;
+  g_autoptr (GError) error = NULL;
 
-  if (!g_output_stream_write_all_finish (stream, result, NULL, &error))
+  if (!g_output_stream_writev_all_finish (stream, result, NULL, &error))
     {
-      g_task_return_error (task, g_steal_pointer (&error));
+      for (unsigned int i = 0; i < batch->tasks->len; i++)
+        g_task_return_error (g_ptr_array_index (batch->tasks, i),
+                             g_error_copy (error));
+
+      write_batch_free (batch);
       return;
     }
 
-  valent_channel_write_packet_next (self);
-  g_task_return_boolean (task, TRUE);
+  valent_channel_write_packet_next (batch->channel);
+
+  for (unsigned int i = 0; i < batch->tasks->len; i++)
+    g_task_return_boolean (g_ptr_array_index (batch->tasks, i), TRUE);
+
+  write_batch_free (batch);
 }
 
 static void
 valent_channel_write_packet_next (ValentChannel *self)
 {
   ValentChannelPrivate *priv = valent_channel_get_instance_private (self);
-  g_autoptr (GTask) task = NULL;
+  WriteBatch *batch = NULL;
+  GCancellable *cancellable = NULL;
   GOutputStream *stream = NULL;
-  GBytes *bytes = NULL;
+  unsigned int lanes[] = { LANE_INTERACTIVE, LANE_NORMAL, LANE_BULK };
+  unsigned int n_queued = 0;
+  int priority = G_MAXINT;
+  size_t n_bytes = 0;
+  unsigned int n_vectors = 0;
+  gboolean bulk_served = FALSE;
 
   valent_object_lock (VALENT_OBJECT (self));
-  task = g_queue_pop_head (&priv->output_buffer);
-  if (task == NULL)
+  for (unsigned int i = 0; i < G_N_ELEMENTS (priv->output_buffer); i++)
+    n_queued += g_queue_get_length (&priv->output_buffer[i]);
+
+  if (n_queued == 0)
     {
       priv->pending = FALSE;
       valent_object_unlock (VALENT_OBJECT (self));
       return;
     }
 
+  batch = g_new0 (WriteBatch, 1);
+  batch->channel = g_object_ref (self);
+  batch->tasks = g_ptr_array_new_with_free_func (g_object_unref);
+  batch->vectors = g_new0 (GOutputVector, MIN (n_queued, WRITE_BATCH_MAX));
+
+  if (priv->output_skipped >= WRITE_BULK_SKIP)
+    {
+      lanes[1] = LANE_BULK;
+      lanes[2] = LANE_NORMAL;
+    }
+
+  /* Always take the first packet, then as many as fit in the budget, in lane
+   * order. A lane that doesn't fit ends the batch, to preserve ordering.
+   */
+  for (unsigned int i = 0; i < G_N_ELEMENTS (lanes); i++)
+    {
+      GQueue *queue = &priv->output_buffer[lanes[i]];
+      gboolean full = FALSE;
+
+      while (!g_queue_is_empty (queue) && n_vectors < WRITE_BATCH_MAX)
+        {
+          GTask *task = g_queue_peek_head (queue);
+          GBytes *bytes = g_task_get_task_data (task);
+          size_t size = g_bytes_get_size (bytes);
+
+          if (n_vectors > 0 && n_bytes + size > WRITE_BATCH_SIZE)
+            {
+              full = TRUE;
+              break;
+            }
+
+          task = g_queue_pop_head (queue);
+          if (g_task_return_error_if_cancelled (task))
+            {
+              g_object_unref (task);
+              continue;
+            }
+
+          if (n_vectors == 0)
+            cancellable = g_task_get_cancellable (task);
+          else if (cancellable != g_task_get_cancellable (task))
+            cancellable = NULL;
+
+          priority = MIN (priority, g_task_get_priority (task));
+          batch->vectors[n_vectors].buffer = g_bytes_get_data (bytes, NULL);
+          batch->vectors[n_vectors].size = size;
+          g_ptr_array_add (batch->tasks, task);
+          n_bytes += size;
+          n_vectors++;
+
+          if (lanes[i] == LANE_BULK)
+            bulk_served = TRUE;
+        }
+
+      if (full || n_vectors == WRITE_BATCH_MAX)
+        break;
+    }
+
+  if (bulk_served || g_queue_is_empty (&priv->output_buffer[LANE_BULK]))
+    priv->output_skipped = 0;
+  else
+    priv->output_skipped++;
+
+  /* Every task was cancelled */
+  if (n_vectors == 0)
+    {
+      write_batch_free (batch);
+      valent_object_unlock (VALENT_OBJECT (self));
+      valent_channel_write_packet_next (self);
+      return;
+    }
+
   stream = g_io_stream_get_output_stream (priv->base_stream);
-  bytes = g_task_get_task_data (task);
-  g_output_stream_write_all_async (stream,
-                                   g_bytes_get_data (bytes, NULL),
-                                   g_bytes_get_size (bytes),
-                                   g_task_get_priority (task),
-                                   g_task_get_cancellable (task),
-                                   (GAsyncReadyCallback)g_output_stream_write_all_cb,
-                                   g_object_ref (task));
+  g_output_stream_writev_all_async (stream,
+                                    batch->vectors,
+                                    n_vectors,
+                                    priority,
+                                    cancellable,
+                                    (GAsyncReadyCallback)g_output_stream_writev_all_cb,
+                                    batch);
   valent_object_unlock (VALENT_OBJECT (self));
 }
 
@@ -842,8 +1155,8 @@ valent_channel_write_packet_next (ValentChannel *self)
  *
  * Send a packet over the channel.
  *
- * Internally [class@Valent.Channel] uses an outgoing packet buffer, so
- * multiple requests can be started safely from any thread.
+ * This is equivalent to calling [method@Valent.Channel.write_packet_full]
+ * with %G_PRIORITY_DEFAULT.
  *
  * Call [method@Valent.Channel.write_packet_finish] to get the result.
  *
@@ -855,12 +1168,59 @@ valent_channel_write_packet (ValentChannel       *channel,
                              GCancellable        *cancellable,
                              GAsyncReadyCallback  callback,
                              gpointer             user_data)
+{
+  g_return_if_fail (VALENT_IS_CHANNEL (channel));
+  g_return_if_fail (VALENT_IS_PACKET (packet));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  valent_channel_write_packet_full (channel,
+                                    packet,
+                                    G_PRIORITY_DEFAULT,
+                                    cancellable,
+                                    callback,
+                                    user_data);
+}
+
+/**
+ * valent_channel_write_packet_full:
+ * @channel: a `ValentChannel`
+ * @packet: a KDE Connect packet
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): a `GCancellable`
+ * @callback: (scope async): a `GAsyncReadyCallback`
+ * @user_data: user supplied data
+ *
+ * Send a packet over the channel, with an explicit priority.
+ *
+ * Internally [class@Valent.Channel] uses an outgoing packet buffer, so
+ * multiple requests can be started safely from any thread. Packets queued
+ * while a write is in progress are coalesced into a single write.
+ *
+ * The `id` field is set to the current time when @packet is serialized, but
+ * @packet itself is not modified.
+ *
+ * Queued packets are sent in order of priority. If @io_priority is higher than
+ * %G_PRIORITY_DEFAULT the packet is sent before other queued packets, and if
+ * lower it is sent after them. If @io_priority is %G_PRIORITY_DEFAULT, input
+ * events and pairing requests are given a higher priority. Packets with the
+ * same priority are always sent in the order they were queued.
+ *
+ * Call [method@Valent.Channel.write_packet_finish] to get the result.
+ *
+ * Since: 1.0
+ */
+void
+valent_channel_write_packet_full (ValentChannel       *channel,
+                                  JsonNode            *packet,
+                                  int                  io_priority,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
 {
   ValentChannelPrivate *priv = valent_channel_get_instance_private (channel);
   g_autoptr (GTask) task = NULL;
   g_autoptr (GBytes) bytes = NULL;
-  g_autofree char *packet_str = NULL;
-  size_t packet_len = 0;
+  unsigned int lane;
 
   VALENT_ENTRY;
 
@@ -868,18 +1228,21 @@ valent_channel_write_packet (ValentChannel       *channel,
   g_return_if_fail (VALENT_IS_PACKET (packet));
   g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-  packet_str = valent_packet_serialize (packet, &packet_len);
-  bytes = g_bytes_new_take (g_steal_pointer (&packet_str), packet_len);
+  bytes = valent_packet_encoder_encode (priv->output_encoder,
+                                        packet,
+                                        valent_timestamp_ms ());
+  lane = valent_channel_get_lane (packet, io_priority);
 
   task = g_task_new (channel, cancellable, callback, user_data);
   g_task_set_source_tag (task, valent_channel_write_packet);
+  g_task_set_priority (task, io_priority);
   g_task_set_task_data (task,
                         g_steal_pointer (&bytes),
                         (GDestroyNotify)g_bytes_unref);
 
   if (!valent_channel_return_error_if_closed (channel, task))
     {
-      g_queue_push_tail (&priv->output_buffer, g_object_ref (task));
+      g_queue_push_tail (&priv->output_buffer[lane], g_object_ref (task));
       if (!priv->pending)
         {
           priv->pending = TRUE;
@@ -897,7 +1260,8 @@ valent_channel_write_packet (ValentChannel       *channel,
  * @result: a `GAsyncResult`
  * @error: (nullable): a `GError`
  *
- * Finish an operation started by [method@Valent.Channel.write_packet].
+ * Finish an operation started by [method@Valent.Channel.write_packet] or
+ * [method@Valent.Channel.write_packet_full].
  *
  * Returns: %TRUE if successful, or %FALSE with @error set
  *
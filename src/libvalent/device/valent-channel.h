@@ -85,12 +85,22 @@ JsonNode        * valent_channel_read_packet_finish   (ValentChannel        *cha
                                                        GAsyncResult         *result,
                                                        GError              **error);
 VALENT_AVAILABLE_IN_1_0
+void              valent_channel_push_input           (ValentChannel        *channel,
+                                                       GBytes               *bytes);
+VALENT_AVAILABLE_IN_1_0
 void              valent_channel_write_packet         (ValentChannel        *channel,
                                                        JsonNode             *packet,
                                                        GCancellable         *cancellable,
                                                        GAsyncReadyCallback   callback,
                                                        gpointer              user_data);
 VALENT_AVAILABLE_IN_1_0
+void              valent_channel_write_packet_full    (ValentChannel        *channel,
+                                                       JsonNode             *packet,
+                                                       int                   io_priority,
+                                                       GCancellable         *cancellable,
+                                                       GAsyncReadyCallback   callback,
+                                                       gpointer              user_data);
+VALENT_AVAILABLE_IN_1_0
 gboolean          valent_channel_write_packet_finish  (ValentChannel        *channel,
                                                        GAsyncResult         *result,
                                                        GError              **error);
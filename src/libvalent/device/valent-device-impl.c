@@ -7,6 +7,7 @@
 
 #include "valent-device.h"
 #include "valent-device-impl.h"
+#include "valent-device-private.h"
 
 
 struct _ValentDeviceImpl
@@ -63,10 +64,48 @@ static const GDBusPropertyInfo * const iface_properties[] = {
   NULL,
 };
 
+static const GDBusArgInfo * const get_packet_statistics_out[] = {
+  &((const GDBusArgInfo){
+    -1,
+    "statistics",
+    "a{s(ttt)}",
+    NULL
+  }),
+  NULL,
+};
+
+static const GDBusArgInfo * const get_queue_statistics_out[] = {
+  &((const GDBusArgInfo){
+    -1,
+    "statistics",
+    "a{st}",
+    NULL
+  }),
+  NULL,
+};
+
+static const GDBusMethodInfo * const iface_methods[] = {
+  &((const GDBusMethodInfo){
+    -1,
+    "GetPacketStatistics",
+    NULL,
+    (GDBusArgInfo **)&get_packet_statistics_out,
+    NULL
+  }),
+  &((const GDBusMethodInfo){
+    -1,
+    "GetQueueStatistics",
+    NULL,
+    (GDBusArgInfo **)&get_queue_statistics_out,
+    NULL
+  }),
+  NULL,
+};
+
 static const GDBusInterfaceInfo iface_info = {
   -1,
   "ca.andyholmes.Valent.Device",
-  NULL,
+  (GDBusMethodInfo **)&iface_methods,
   NULL,
   (GDBusPropertyInfo **)&iface_properties,
   NULL
@@ -143,6 +182,32 @@ valent_device_impl_method_call (GDBusConnection       *connection,
                                 GDBusMethodInvocation *invocation,
                                 void                  *user_data)
 {
+  ValentDeviceImpl *self = VALENT_DEVICE_IMPL (user_data);
+
+  g_assert (VALENT_IS_DEVICE_IMPL (self));
+
+  if (g_str_equal (method_name, "GetPacketStatistics"))
+    {
+      g_autoptr (GVariant) statistics = NULL;
+
+      statistics = valent_device_dup_packet_statistics (self->device);
+      g_dbus_method_invocation_return_value (invocation,
+                                             g_variant_new ("(@a{s(ttt)})",
+                                                            statistics));
+      return;
+    }
+
+  if (g_str_equal (method_name, "GetQueueStatistics"))
+    {
+      g_autoptr (GVariant) statistics = NULL;
+
+      statistics = valent_device_dup_queue_statistics (self->device);
+      g_dbus_method_invocation_return_value (invocation,
+                                             g_variant_new ("(@a{st})",
+                                                            statistics));
+      return;
+    }
+
   g_dbus_method_invocation_return_error (invocation,
                                          G_DBUS_ERROR,
                                          G_DBUS_ERROR_UNKNOWN_METHOD,
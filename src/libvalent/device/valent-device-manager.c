@@ -5,7 +5,10 @@
 
 #include "config.h"
 
+#include <errno.h>
+
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <libvalent-core.h>
 
 #include "../core/valent-component-private.h"
@@ -19,6 +22,9 @@
 #include "valent-packet.h"
 
 #define DEVICE_UNPAIRED_MAX (10)
+#define STATE_FLUSH_DELAY   (2)
+#define STATE_RECORDS_DIR   "devices"
+#define STATE_LEGACY_FILE   "devices.json"
 
 
 /**
@@ -41,11 +47,18 @@ struct _ValentDeviceManager
   GSettings                *settings;
   GCancellable             *cancellable;
   ValentContext            *context;
+  GTlsCertificate          *certificate;
+  gboolean                  services_ready;
 
   GPtrArray                *devices;
+  GHashTable               *index;
+  unsigned int              n_paired;
   GHashTable               *plugins;
   ValentContext            *plugins_context;
   JsonNode                 *state;
+  GHashTable               *state_dirty;
+  unsigned int              state_flush_id;
+  gboolean                  state_loading;
 
   GDBusObjectManagerServer *dbus;
   GHashTable               *exports;
@@ -57,9 +70,27 @@ static void           valent_device_manager_remove_device (ValentDeviceManager *
                                                            ValentDevice        *device);
 static ValentDevice * valent_device_manager_ensure_device (ValentDeviceManager *manager,
                                                            JsonNode            *identity);
+static void           valent_device_manager_mark_state    (ValentDeviceManager *manager,
+                                                           const char          *device_id);
+static void           valent_device_manager_flush_state   (ValentDeviceManager *manager);
 
 static void   g_list_model_iface_init     (GListModelInterface *iface);
 
+/*< private >
+ * DeviceEntry:
+ * @device: (not nullable): a `ValentDevice`
+ * @paired: whether @device was paired when last seen
+ *
+ * An entry in the device ID index, used to resolve devices without scanning
+ * the list model. The paired state is cached so that the number of unpaired
+ * devices can be maintained incrementally as state changes are observed.
+ */
+typedef struct
+{
+  ValentDevice *device;
+  gboolean      paired;
+} DeviceEntry;
+
 G_DEFINE_FINAL_TYPE_WITH_CODE (ValentDeviceManager, valent_device_manager, VALENT_TYPE_APPLICATION_PLUGIN,
                                G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, g_list_model_iface_init))
 
@@ -185,7 +216,10 @@ valent_device_manager_export_device (ValentDeviceManager *self,
                                                             action_group,
                                                             NULL);
 
-  menu_model = valent_device_get_menu (device);
+  /* Exporting the device must not instantiate its plugins; the menu is
+   * populated when a client queries the action group.
+   */
+  menu_model = valent_device_peek_menu (device);
   info->menu_id = g_dbus_connection_export_menu_model (info->connection,
                                                        info->object_path,
                                                        menu_model,
@@ -209,13 +243,8 @@ valent_device_manager_check_device (ValentDeviceManager *self,
   if ((valent_device_get_state (device) & VALENT_DEVICE_STATE_PAIRED) != 0)
     return TRUE;
 
-  for (unsigned int i = 0, len = self->devices->len; i < len; i++)
-    {
-      ValentDevice *check = g_ptr_array_index (self->devices, i);
-
-      if ((valent_device_get_state (check) & VALENT_DEVICE_STATE_PAIRED) == 0)
-        n_unpaired++;
-    }
+  g_assert (self->devices->len >= self->n_paired);
+  n_unpaired = self->devices->len - self->n_paired;
 
   if (n_unpaired >= DEVICE_UNPAIRED_MAX)
     {
@@ -253,7 +282,17 @@ on_channel (ValentChannelService *service,
 
   if (!valent_device_manager_check_device (self, device))
     {
+      ValentDeviceState state = valent_device_get_state (device);
+
       valent_object_destroy (VALENT_OBJECT (channel));
+
+      /* A rejected device that was created for this channel will never emit
+       * a state change, so drop it now rather than letting it accumulate.
+       */
+      if ((state & VALENT_DEVICE_STATE_CONNECTED) == 0 &&
+          (state & VALENT_DEVICE_STATE_PAIRED) == 0)
+        valent_device_manager_remove_device (self, device);
+
       VALENT_EXIT;
     }
 
@@ -315,8 +354,9 @@ valent_device_manager_enable_plugin (ValentDeviceManager *self,
   plugin->extension = peas_engine_create_extension (valent_get_plugin_engine (),
                                                     plugin->info,
                                                     VALENT_TYPE_CHANNEL_SERVICE,
-                                                    "parent",  self,
-                                                    "context", plugin->context,
+                                                    "certificate", self->certificate,
+                                                    "parent",      self,
+                                                    "context",     plugin->context,
                                                     NULL);
   g_return_if_fail (G_IS_OBJECT (plugin->extension));
 
@@ -375,13 +415,22 @@ valent_device_manager_disable_plugin (ValentDeviceManager *self,
 static void
 on_plugin_enabled_changed (ValentPlugin *plugin)
 {
+  ValentDeviceManager *self;
+
   g_assert (plugin != NULL);
   g_assert (VALENT_IS_DEVICE_MANAGER (plugin->parent));
 
+  self = VALENT_DEVICE_MANAGER (plugin->parent);
+
   if (valent_plugin_get_enabled (plugin))
-    valent_device_manager_enable_plugin (plugin->parent, plugin);
-  else
-    valent_device_manager_disable_plugin (plugin->parent, plugin);
+    {
+      if (self->services_ready && plugin->extension == NULL)
+        valent_device_manager_enable_plugin (self, plugin);
+    }
+  else if (plugin->extension != NULL)
+    {
+      valent_device_manager_disable_plugin (self, plugin);
+    }
 }
 
 static void
@@ -407,7 +456,7 @@ on_load_service (PeasEngine          *engine,
                               G_CALLBACK (on_plugin_enabled_changed));
   g_hash_table_insert (self->plugins, info, plugin);
 
-  if (valent_plugin_get_enabled (plugin))
+  if (self->services_ready && valent_plugin_get_enabled (plugin))
     valent_device_manager_enable_plugin (self, plugin);
 }
 
@@ -440,6 +489,17 @@ on_device_state (ValentDevice        *device,
                  ValentDeviceManager *self)
 {
   ValentDeviceState state = valent_device_get_state (device);
+  DeviceEntry *entry;
+
+  entry = g_hash_table_lookup (self->index, valent_device_get_id (device));
+  if (entry != NULL && entry->paired != ((state & VALENT_DEVICE_STATE_PAIRED) != 0))
+    {
+      entry->paired = !entry->paired;
+      if (entry->paired)
+        self->n_paired++;
+      else
+        self->n_paired--;
+    }
 
   if ((state & VALENT_DEVICE_STATE_CONNECTED) != 0 &&
       (state & VALENT_DEVICE_STATE_PAIRED) != 0)
@@ -447,16 +507,39 @@ on_device_state (ValentDevice        *device,
       g_autoptr (ValentChannel) channel = NULL;
       JsonNode *identity = NULL;
 
+      JsonObject *records = json_node_get_object (self->state);
+      const char *device_id = valent_device_get_id (device);
+      JsonNode *record = NULL;
+
       channel = g_list_model_get_item (valent_device_get_channels (device), 0);
       identity = valent_channel_get_peer_identity (channel);
-      json_object_set_object_member (json_node_get_object (self->state),
-                                     valent_device_get_id (device),
-                                     json_node_dup_object (identity));
+
+      record = json_object_get_member (records, device_id);
+      if (record == NULL || !json_node_equal (record, identity))
+        {
+          json_object_set_object_member (records,
+                                         device_id,
+                                         json_node_dup_object (identity));
+          valent_device_manager_mark_state (self, device_id);
+        }
     }
   else if ((state & VALENT_DEVICE_STATE_PAIRED) == 0)
     {
-      json_object_remove_member (json_node_get_object (self->state),
-                                 valent_device_get_id (device));
+      JsonObject *records = json_node_get_object (self->state);
+      const char *device_id = valent_device_get_id (device);
+
+      /* While the cache is loading, the record may exist but not be loaded
+       * yet, so it is marked for removal regardless.
+       */
+      if (json_object_has_member (records, device_id))
+        {
+          json_object_remove_member (records, device_id);
+          valent_device_manager_mark_state (self, device_id);
+        }
+      else if (self->state_loading)
+        {
+          valent_device_manager_mark_state (self, device_id);
+        }
 
       if ((state & VALENT_DEVICE_STATE_CONNECTED) == 0)
         valent_device_manager_remove_device (self, device);
@@ -467,6 +550,7 @@ static void
 valent_device_manager_add_device (ValentDeviceManager *self,
                                   ValentDevice        *device)
 {
+  DeviceEntry *entry;
   unsigned int position = 0;
 
   VALENT_ENTRY;
@@ -474,7 +558,7 @@ valent_device_manager_add_device (ValentDeviceManager *self,
   g_assert (VALENT_IS_DEVICE_MANAGER (self));
   g_assert (VALENT_IS_DEVICE (device));
 
-  if (g_ptr_array_find (self->devices, device, NULL))
+  if (g_hash_table_contains (self->index, valent_device_get_id (device)))
     {
       g_warning ("Device \"%s\" already managed by \"%s\"",
                  valent_device_get_name (device),
@@ -488,6 +572,14 @@ valent_device_manager_add_device (ValentDeviceManager *self,
                            self,
                            G_CONNECT_DEFAULT);
 
+  entry = g_new0 (DeviceEntry, 1);
+  entry->device = device;
+  entry->paired = (valent_device_get_state (device) & VALENT_DEVICE_STATE_PAIRED) != 0;
+  if (entry->paired)
+    self->n_paired++;
+
+  g_hash_table_insert (self->index, (char *)valent_device_get_id (device), entry);
+
   position = self->devices->len;
   g_ptr_array_add (self->devices, g_object_ref (device));
   g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
@@ -498,19 +590,12 @@ valent_device_manager_add_device (ValentDeviceManager *self,
   VALENT_EXIT;
 }
 
-static inline gboolean
-find_device_by_id (gconstpointer a,
-                   gconstpointer b)
-{
-  return g_str_equal (valent_device_get_id ((ValentDevice *)a), (const char *)b);
-}
-
 static ValentDevice *
 valent_device_manager_ensure_device (ValentDeviceManager *self,
                                      JsonNode            *identity)
 {
   const char *device_id;
-  unsigned int position = 0;
+  DeviceEntry *entry;
 
   g_assert (VALENT_IS_DEVICE_MANAGER (self));
   g_assert (VALENT_IS_PACKET (identity));
@@ -528,25 +613,24 @@ valent_device_manager_ensure_device (ValentDeviceManager *self,
       return NULL;
     }
 
-  if (!g_ptr_array_find_with_equal_func (self->devices,
-                                         device_id,
-                                         find_device_by_id,
-                                         &position))
+  if ((entry = g_hash_table_lookup (self->index, device_id)) == NULL)
     {
       g_autoptr (ValentDevice) device = NULL;
 
       device = valent_device_new_full (VALENT_OBJECT (self), identity);
       valent_device_manager_add_device (self, device);
-      position = (self->devices->len - 1);
+
+      return device;
     }
 
-  return g_ptr_array_index (self->devices, position);
+  return entry->device;
 }
 
 static void
 valent_device_manager_remove_device (ValentDeviceManager *self,
                                      ValentDevice        *device)
 {
+  DeviceEntry *entry;
   unsigned int position = 0;
 
   VALENT_ENTRY;
@@ -564,6 +648,11 @@ valent_device_manager_remove_device (ValentDeviceManager *self,
 
   g_signal_handlers_disconnect_by_data (device, self);
 
+  entry = g_hash_table_lookup (self->index, valent_device_get_id (device));
+  if (entry != NULL && entry->paired)
+    self->n_paired--;
+
+  g_hash_table_remove (self->index, valent_device_get_id (device));
   g_hash_table_remove (self->exports, device);
   g_ptr_array_remove_index (self->devices, position);
   g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
@@ -571,94 +660,507 @@ valent_device_manager_remove_device (ValentDeviceManager *self,
   VALENT_EXIT;
 }
 
+/*
+ * Startup
+ *
+ * Loading the local certificate (possibly generating it on first launch) and
+ * parsing the device cache are both done in a thread. The certificate is a
+ * prerequisite for the channel services, so they are started as soon as it is
+ * ready, independent of the device cache.
+ */
 static void
-valent_device_manager_load_state (ValentDeviceManager *self)
+valent_device_manager_start_services (ValentDeviceManager *self)
 {
-  JsonObjectIter iter;
-  const char *device_id;
-  JsonNode *identity;
-  g_autoptr (GFile) path = NULL;
-  g_autoptr (GTlsCertificate) certificate = NULL;
-  g_autoptr (GError) error = NULL;
+  GHashTableIter iter;
+  ValentPlugin *plugin;
 
   g_assert (VALENT_IS_DEVICE_MANAGER (self));
 
-  /* Ensure we're wiping old certificates with invalid device IDs. In the
-   * unlikely event of an error, the channel service will re-generate it.
+  self->services_ready = TRUE;
+
+  g_hash_table_iter_init (&iter, self->plugins);
+  while (g_hash_table_iter_next (&iter, NULL, (void **)&plugin))
+    {
+      if (plugin->extension == NULL && valent_plugin_get_enabled (plugin))
+        valent_device_manager_enable_plugin (self, plugin);
+    }
+}
+
+static void
+valent_device_manager_load_certificate_task (GTask        *task,
+                                             gpointer      source_object,
+                                             gpointer      task_data,
+                                             GCancellable *cancellable)
+{
+  const char *path = (const char *)task_data;
+  g_autoptr (GTlsCertificate) certificate = NULL;
+  GError *error = NULL;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  certificate = valent_certificate_new_sync (path, &error);
+
+  /* Ensure we're wiping old certificates with invalid device IDs, then
+   * generate a new one.
    *
    * TODO: remove this after a period of time
    */
-  path = valent_context_get_config_file (self->context, ".");
-  certificate = valent_certificate_new_sync (g_file_peek_path (path), NULL);
-  if (certificate != NULL)
+  if (certificate != NULL &&
+      !valent_device_validate_id (valent_certificate_get_common_name (certificate)))
+    {
+      g_autofree char *cert_path = NULL;
+      g_autofree char *pkey_path = NULL;
+
+      cert_path = g_build_filename (path, "certificate.pem", NULL);
+      g_remove (cert_path);
+      pkey_path = g_build_filename (path, "private.pem", NULL);
+      g_remove (pkey_path);
+
+      g_clear_object (&certificate);
+      certificate = valent_certificate_new_sync (path, &error);
+    }
+
+  if (certificate == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&certificate), g_object_unref);
+}
+
+static void
+valent_device_manager_load_certificate_cb (ValentDeviceManager *self,
+                                           GAsyncResult        *result,
+                                           gpointer             user_data)
+{
+  g_autoptr (GTlsCertificate) certificate = NULL;
+  g_autoptr (GError) error = NULL;
+
+  g_assert (VALENT_IS_DEVICE_MANAGER (self));
+  g_assert (g_task_is_valid (result, self));
+
+  certificate = g_task_propagate_pointer (G_TASK (result), &error);
+  if (certificate == NULL)
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
+      /* The channel services will attempt to load it themselves */
+      g_warning ("%s(): %s", G_STRFUNC, error->message);
+    }
+
+  g_set_object (&self->certificate, certificate);
+  valent_device_manager_start_services (self);
+}
+
+/*< private >
+ * state_record_write:
+ * @dir: (type filename): the record directory
+ * @device_id: a device ID
+ * @identity: (nullable): an identity packet
+ * @error: (nullable): a `GError`
+ *
+ * Atomically replace the record for @device_id with @identity, or remove it
+ * if @identity is %NULL.
+ *
+ * Returns: %TRUE if successful, or %FALSE with @error set
+ */
+static gboolean
+state_record_write (const char  *dir,
+                    const char  *device_id,
+                    JsonNode    *identity,
+                    GError     **error)
+{
+  g_autoptr (JsonGenerator) generator = NULL;
+  g_autofree char *filename = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *data = NULL;
+  size_t len = 0;
+
+  g_assert (dir != NULL);
+  g_assert (device_id != NULL);
+
+  filename = g_strconcat (device_id, ".json", NULL);
+  path = g_build_filename (dir, filename, NULL);
+
+  if (identity == NULL)
     {
-      device_id = valent_certificate_get_common_name (certificate);
-      if (!valent_device_validate_id (device_id))
+      if (g_remove (path) != 0 && errno != ENOENT)
         {
-          g_autoptr (GFile) cert_file = NULL;
-          g_autoptr (GFile) pkey_file = NULL;
-
-          cert_file = valent_context_get_config_file (self->context,
-                                                      "certificate.pem");
-          g_file_delete (cert_file, NULL, NULL);
-          pkey_file = valent_context_get_config_file (self->context,
-                                                      "private.pem");
-          g_file_delete (pkey_file, NULL, NULL);
+          int errsv = errno;
+
+          g_set_error (error,
+                       G_IO_ERROR,
+                       g_io_error_from_errno (errsv),
+                       "Removing %s: %s",
+                       path,
+                       g_strerror (errsv));
+          return FALSE;
         }
+
+      return TRUE;
     }
 
-  if (self->state == NULL)
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      int errsv = errno;
+
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Creating %s: %s",
+                   dir,
+                   g_strerror (errsv));
+      return FALSE;
+    }
+
+  generator = g_object_new (JSON_TYPE_GENERATOR,
+                            "root", identity,
+                            NULL);
+  data = json_generator_to_data (generator, &len);
+
+  return g_file_set_contents_full (path,
+                                   data,
+                                   len,
+                                   G_FILE_SET_CONTENTS_CONSISTENT,
+                                   0600,
+                                   error);
+}
+
+typedef struct
+{
+  char *records_dir;
+  char *legacy_path;
+} StateLoadData;
+
+static void
+state_load_data_free (gpointer data)
+{
+  StateLoadData *load = (StateLoadData *)data;
+
+  g_clear_pointer (&load->records_dir, g_free);
+  g_clear_pointer (&load->legacy_path, g_free);
+  g_free (load);
+}
+
+static void
+valent_device_manager_load_state_task (GTask        *task,
+                                       gpointer      source_object,
+                                       gpointer      task_data,
+                                       GCancellable *cancellable)
+{
+  StateLoadData *load = (StateLoadData *)task_data;
+  g_autoptr (JsonParser) parser = NULL;
+  g_autoptr (JsonNode) state = NULL;
+  g_autoptr (GDir) dir = NULL;
+  JsonObject *records;
+  const char *name;
+
+  parser = json_parser_new ();
+  state = json_node_new (JSON_NODE_OBJECT);
+  json_node_take_object (state, json_object_new ());
+  records = json_node_get_object (state);
+
+  /* Read one record per device, ignoring anything that isn't named like a
+   * record for a valid device ID (e.g. temporary files being written by
+   * g_file_set_contents()). Records that fail to parse are left in place.
+   */
+  if ((dir = g_dir_open (load->records_dir, 0, NULL)) != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          g_autofree char *path = NULL;
+          g_autofree char *device_id = NULL;
+          JsonNode *identity = NULL;
+
+          if (!g_str_has_suffix (name, ".json"))
+            continue;
+
+          device_id = g_strndup (name, strlen (name) - strlen (".json"));
+          if (!valent_device_validate_id (device_id))
+            continue;
+
+          path = g_build_filename (load->records_dir, name, NULL);
+          if (json_parser_load_from_file (parser, path, NULL) &&
+              (identity = json_parser_get_root (parser)) != NULL &&
+              VALENT_IS_PACKET (identity))
+            {
+              json_object_set_member (records,
+                                      device_id,
+                                      json_parser_steal_root (parser));
+              continue;
+            }
+
+          VALENT_NOTE ("ignoring invalid device record \"%s\"", name);
+        }
+    }
+
+  /* Migrate the single-file cache from previous versions, only removing it
+   * once every record has been written
+   */
+  if (json_parser_load_from_file (parser, load->legacy_path, NULL))
     {
-      g_autoptr (JsonParser) parser = NULL;
-      g_autoptr (GFile) file = NULL;
+      JsonNode *legacy = json_parser_get_root (parser);
+      gboolean migrated = TRUE;
+
+      if (legacy != NULL && JSON_NODE_HOLDS_OBJECT (legacy))
+        {
+          JsonObjectIter iter;
+          const char *device_id;
+          JsonNode *identity;
+
+          json_object_iter_init (&iter, json_node_get_object (legacy));
+          while (json_object_iter_next (&iter, &device_id, &identity))
+            {
+              g_autoptr (GError) error = NULL;
+
+              if (json_object_has_member (records, device_id) ||
+                  !valent_device_validate_id (device_id) ||
+                  !VALENT_IS_PACKET (identity))
+                continue;
+
+              if (!state_record_write (load->records_dir, device_id, identity, &error))
+                {
+                  g_warning ("%s(): %s", G_STRFUNC, error->message);
+                  migrated = FALSE;
+                }
+
+              json_object_set_member (records, device_id, json_node_copy (identity));
+            }
+        }
+
+      if (migrated)
+        g_remove (load->legacy_path);
+    }
+
+  g_task_return_pointer (task,
+                         g_steal_pointer (&state),
+                         (GDestroyNotify)json_node_unref);
+}
 
-      parser = json_parser_new ();
-      file = valent_context_get_cache_file (self->context, "devices.json");
-      if (json_parser_load_from_file (parser, g_file_peek_path (file), NULL))
-        self->state = json_parser_steal_root (parser);
+static void
+valent_device_manager_load_state_cb (ValentDeviceManager *self,
+                                     GAsyncResult        *result,
+                                     gpointer             user_data)
+{
+  g_autoptr (JsonNode) state = NULL;
+  g_autoptr (GError) error = NULL;
+  JsonObject *current;
+  JsonObjectIter iter;
+  const char *device_id;
+  JsonNode *identity;
 
-      if (self->state == NULL || !JSON_NODE_HOLDS_OBJECT (self->state))
+  g_assert (VALENT_IS_DEVICE_MANAGER (self));
+  g_assert (g_task_is_valid (result, self));
+
+  self->state_loading = FALSE;
+
+  state = g_task_propagate_pointer (G_TASK (result), &error);
+  if (error != NULL)
+    g_warning ("%s(): %s", G_STRFUNC, error->message);
+
+  /* Devices that changed while the cache was loading have the most recent
+   * record, so only add the cached entries that are still missing.
+   */
+  current = json_node_get_object (self->state);
+  if (state != NULL)
+    {
+      json_object_iter_init (&iter, json_node_get_object (state));
+      while (json_object_iter_next (&iter, &device_id, &identity))
         {
-          g_clear_pointer (&self->state, json_node_unref);
-          self->state = json_node_new (JSON_NODE_OBJECT);
-          json_node_take_object (self->state, json_object_new ());
+          if (!json_object_has_member (current, device_id) &&
+              !g_hash_table_contains (self->state_dirty, device_id))
+            json_object_set_member (current, device_id, json_node_copy (identity));
         }
     }
 
-  json_object_iter_init (&iter, json_node_get_object (self->state));
+  /* Write any records that were changed while the cache was loading, which
+   * may include those from a shutdown that happened in the meantime.
+   */
+  valent_device_manager_flush_state (self);
+
+  if (self->cancellable == NULL)
+    return;
+
+  json_object_iter_init (&iter, current);
   while (json_object_iter_next (&iter, &device_id, &identity))
     valent_device_manager_ensure_device (self, identity);
 }
 
+static void
+valent_device_manager_load_state (ValentDeviceManager *self)
+{
+  g_autoptr (GTask) certificate_task = NULL;
+  g_autoptr (GFile) config = NULL;
+
+  g_assert (VALENT_IS_DEVICE_MANAGER (self));
+
+  config = valent_context_get_config_file (self->context, ".");
+  certificate_task = g_task_new (self,
+                                 self->cancellable,
+                                 (GAsyncReadyCallback)valent_device_manager_load_certificate_cb,
+                                 NULL);
+  g_task_set_source_tag (certificate_task, valent_device_manager_load_state);
+  g_task_set_task_data (certificate_task,
+                        g_file_get_path (config),
+                        g_free);
+  g_task_run_in_thread (certificate_task,
+                        valent_device_manager_load_certificate_task);
+
+  if (self->state == NULL)
+    {
+      g_autoptr (GTask) state_task = NULL;
+      g_autoptr (GFile) records = NULL;
+      g_autoptr (GFile) legacy = NULL;
+      StateLoadData *load = NULL;
+
+      self->state = json_node_new (JSON_NODE_OBJECT);
+      json_node_take_object (self->state, json_object_new ());
+
+      records = valent_context_get_cache_file (self->context, STATE_RECORDS_DIR);
+      legacy = valent_context_get_cache_file (self->context, STATE_LEGACY_FILE);
+      load = g_new0 (StateLoadData, 1);
+      load->records_dir = g_file_get_path (records);
+      load->legacy_path = g_file_get_path (legacy);
+
+      /* The load is not cancellable, since the state can't be saved until
+       * it completes; if the manager shuts down in the meantime, the save is
+       * deferred until the callback.
+       */
+      self->state_loading = TRUE;
+      state_task = g_task_new (self,
+                               NULL,
+                               (GAsyncReadyCallback)valent_device_manager_load_state_cb,
+                               NULL);
+      g_task_set_source_tag (state_task, valent_device_manager_load_state);
+      g_task_set_task_data (state_task, load, state_load_data_free);
+      g_task_run_in_thread (state_task, valent_device_manager_load_state_task);
+    }
+  else if (!self->state_loading)
+    {
+      JsonObjectIter iter;
+      const char *device_id;
+      JsonNode *identity;
+
+      json_object_iter_init (&iter, json_node_get_object (self->state));
+      while (json_object_iter_next (&iter, &device_id, &identity))
+        valent_device_manager_ensure_device (self, identity);
+    }
+}
+
+static void
+valent_device_manager_flush_state (ValentDeviceManager *self)
+{
+  g_autoptr (GFile) records = NULL;
+  g_autofree char *records_dir = NULL;
+  GHashTableIter iter;
+  const char *device_id;
+
+  g_assert (VALENT_IS_DEVICE_MANAGER (self));
+
+  g_clear_handle_id (&self->state_flush_id, g_source_remove);
+
+  /* Records are written once the cache is loaded
+   */
+  if (self->state_loading)
+    return;
+
+  if (g_hash_table_size (self->state_dirty) == 0)
+    return;
+
+  records = valent_context_get_cache_file (self->context, STATE_RECORDS_DIR);
+  records_dir = g_file_get_path (records);
+
+  g_hash_table_iter_init (&iter, self->state_dirty);
+  while (g_hash_table_iter_next (&iter, (void **)&device_id, NULL))
+    {
+      g_autoptr (GError) error = NULL;
+      JsonNode *identity = NULL;
+
+      if (self->state != NULL)
+        identity = json_object_get_member (json_node_get_object (self->state),
+                                           device_id);
+
+      if (!state_record_write (records_dir, device_id, identity, &error))
+        {
+          g_warning ("%s(): %s", G_STRFUNC, error->message);
+          continue;
+        }
+
+      g_hash_table_iter_remove (&iter);
+    }
+}
+
+static gboolean
+valent_device_manager_flush_state_cb (gpointer data)
+{
+  ValentDeviceManager *self = VALENT_DEVICE_MANAGER (data);
+
+  self->state_flush_id = 0;
+  valent_device_manager_flush_state (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*< private >
+ * valent_device_manager_mark_state:
+ * @self: a `ValentDeviceManager`
+ * @device_id: a device ID
+ *
+ * Mark the record for @device_id as changed. Writes are debounced, so that a
+ * burst of identity updates results in a single write for each device.
+ */
+static void
+valent_device_manager_mark_state (ValentDeviceManager *self,
+                                  const char          *device_id)
+{
+  g_assert (VALENT_IS_DEVICE_MANAGER (self));
+  g_assert (device_id != NULL);
+
+  g_hash_table_add (self->state_dirty, g_strdup (device_id));
+
+  if (self->state_flush_id == 0)
+    {
+      self->state_flush_id =
+        g_timeout_add_seconds_full (G_PRIORITY_LOW,
+                                    STATE_FLUSH_DELAY,
+                                    valent_device_manager_flush_state_cb,
+                                    g_object_ref (self),
+                                    g_object_unref);
+    }
+}
+
 static void
 valent_device_manager_save_state (ValentDeviceManager *self)
 {
-  g_autoptr (JsonGenerator) generator = NULL;
-  g_autoptr (GFile) file = NULL;
-  g_autoptr (GError) error = NULL;
+  JsonObject *records;
 
   g_assert (VALENT_IS_DEVICE_MANAGER (self));
 
+  records = json_node_get_object (self->state);
   for (unsigned int i = 0, len = self->devices->len; i < len; i++)
     {
       ValentDevice *device = g_ptr_array_index (self->devices, i);
       ValentDeviceState state = valent_device_get_state (device);
+      const char *device_id = valent_device_get_id (device);
+
+      if ((state & VALENT_DEVICE_STATE_PAIRED) != 0)
+        continue;
 
-      if ((state & VALENT_DEVICE_STATE_PAIRED) == 0)
+      if (json_object_has_member (records, device_id))
         {
-          json_object_remove_member (json_node_get_object (self->state),
-                                     valent_device_get_id (device));
+          json_object_remove_member (records, device_id);
+          valent_device_manager_mark_state (self, device_id);
+        }
+      else if (self->state_loading)
+        {
+          valent_device_manager_mark_state (self, device_id);
         }
     }
 
-  generator = g_object_new (JSON_TYPE_GENERATOR,
-                            "pretty", TRUE,
-                            "root",   self->state,
-                            NULL);
-
-  file = valent_context_get_cache_file (self->context, "devices.json");
-  if (!json_generator_to_file (generator, g_file_peek_path (file), &error))
-    g_warning ("%s(): %s", G_STRFUNC, error->message);
+  valent_device_manager_flush_state (self);
 }
 
 /*
@@ -670,6 +1172,7 @@ device_action (GSimpleAction *action,
                gpointer       user_data)
 {
   ValentDeviceManager *manager = valent_device_manager_get_default ();
+  DeviceEntry *entry;
   const char *device_id;
   const char *name;
   g_autoptr (GVariantIter) targetv = NULL;
@@ -681,16 +1184,8 @@ device_action (GSimpleAction *action,
   g_variant_get (parameter, "(&s&sav)", &device_id, &name, &targetv);
   g_variant_iter_next (targetv, "v", &target);
 
-  for (unsigned int i = 0, len = manager->devices->len; i < len; i++)
-    {
-      ValentDevice *device = g_ptr_array_index (manager->devices, i);
-
-      if (g_strcmp0 (device_id, valent_device_get_id (device)) == 0)
-        {
-          g_action_group_activate_action (G_ACTION_GROUP (device), name, target);
-          break;
-        }
-    }
+  if ((entry = g_hash_table_lookup (manager->index, device_id)) != NULL)
+    g_action_group_activate_action (G_ACTION_GROUP (entry->device), name, target);
 }
 
 static const GActionEntry app_actions[] = {
@@ -760,6 +1255,8 @@ valent_device_manager_shutdown (ValentApplicationPlugin *plugin)
 
   g_signal_handlers_disconnect_by_data (valent_get_plugin_engine (), self);
   g_hash_table_remove_all (self->plugins);
+  self->services_ready = FALSE;
+  g_clear_object (&self->certificate);
   valent_device_manager_save_state (self);
 
   n_devices = self->devices->len;
@@ -769,6 +1266,8 @@ valent_device_manager_shutdown (ValentApplicationPlugin *plugin)
       g_signal_handlers_disconnect_by_data (device, self);
     }
 
+  g_hash_table_remove_all (self->index);
+  self->n_paired = 0;
   g_ptr_array_remove_range (self->devices, 0, n_devices);
   g_list_model_items_changed (G_LIST_MODEL (self), 0, n_devices, 0);
 
@@ -869,8 +1368,12 @@ valent_device_manager_finalize (GObject *object)
   g_clear_pointer (&self->exports, g_hash_table_unref);
   g_clear_pointer (&self->plugins, g_hash_table_unref);
   g_clear_pointer (&self->plugins_context, g_object_unref);
+  g_clear_pointer (&self->index, g_hash_table_unref);
   g_clear_pointer (&self->devices, g_ptr_array_unref);
+  g_clear_handle_id (&self->state_flush_id, g_source_remove);
+  g_clear_pointer (&self->state_dirty, g_hash_table_unref);
   g_clear_pointer (&self->state, json_node_unref);
+  g_clear_object (&self->certificate);
   g_clear_object (&self->context);
 
   G_OBJECT_CLASS (valent_device_manager_parent_class)->finalize (object);
@@ -896,6 +1399,8 @@ valent_device_manager_init (ValentDeviceManager *self)
 {
   self->context = valent_context_new (NULL, NULL, NULL);
   self->devices = g_ptr_array_new_with_free_func (_valent_object_deref);
+  self->index = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+  self->state_dirty = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   self->exports = g_hash_table_new_full (NULL, NULL, NULL, device_export_free);
   self->plugins = g_hash_table_new_full (NULL, NULL, NULL, valent_plugin_free);
   self->plugins_context = valent_context_new (self->context, "network", NULL);
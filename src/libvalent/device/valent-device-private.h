@@ -8,7 +8,16 @@
 G_BEGIN_DECLS
 
 _VALENT_EXTERN
-ValentDevice * valent_device_new_full (ValentObject *parent,
-                                       JsonNode     *identity);
+ValentDevice * valent_device_new_full              (ValentObject *parent,
+                                                    JsonNode     *identity);
+_VALENT_EXTERN
+GVariant     * valent_device_dup_packet_statistics (ValentDevice *device);
+_VALENT_EXTERN
+GVariant     * valent_device_dup_queue_statistics  (ValentDevice *device);
+_VALENT_EXTERN
+void           valent_device_set_threaded_io       (ValentDevice *device,
+                                                    gboolean      threaded);
+_VALENT_EXTERN
+GMenuModel   * valent_device_peek_menu             (ValentDevice *device);
 
 G_END_DECLS
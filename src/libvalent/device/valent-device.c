@@ -15,6 +15,7 @@
 #include "../core/valent-component-private.h"
 #include "valent-certificate.h"
 #include "valent-channel.h"
+#include "valent-channel-private.h"
 #include "valent-device-common.h"
 #include "valent-device-enums.h"
 #include "valent-device-plugin.h"
@@ -33,6 +34,10 @@
 #define PAIR_REQUEST_TIMEOUT      (30)
 #define PAIR_CLOCK_SKEW_THRESHOLD (1800)
 
+#define PACKET_QUEUE_MAX          (64)
+#define PACKET_QUEUE_BATCH        (16)
+#define PACKET_READER_KEY         "valent-device-packet-reader"
+
 
 /**
  * ValentDevice:
@@ -61,8 +66,11 @@ struct _ValentDevice
   char            *id;
   char            *name;
   char            *type;
-  char           **incoming_capabilities;
-  char           **outgoing_capabilities;
+  char           **incoming_types;
+  char           **outgoing_types;
+  GArray          *incoming_capabilities;
+  GArray          *outgoing_capabilities;
+  unsigned int     capabilities_generation;
   int64_t          protocol_version;
 
   /* State */
@@ -76,8 +84,16 @@ struct _ValentDevice
   /* Plugins */
   PeasEngine      *engine;
   GHashTable      *plugins;
-  GHashTable      *handlers;
+  gboolean         plugins_ready;
+  GPtrArray       *handlers;
+  GArray          *packet_stats;
+  gboolean         threaded_io;
+  uint64_t         queue_deferred;
+  uint64_t         queue_dropped;
   GHashTable      *actions;
+  GHashTable      *actions_pending;
+  unsigned int     actions_source;
+  gboolean         actions_deferred;
   GMenu           *menu;
 };
 
@@ -96,10 +112,304 @@ typedef enum {
 
 static GParamSpec *properties[PROP_STATE + 1] = { NULL, };
 
+static void   valent_device_ensure_plugins (ValentDevice *device);
+static void   valent_device_ensure_actions (ValentDevice *device);
+
+
+/*
+ * Capabilities
+ *
+ * Packet types are interned into a process-wide, compact ID space, so that
+ * device and plugin capabilities can be represented as bitsets. Matching a
+ * plugin against a device is then a word-wise intersection, and the packet
+ * handlers can be stored in an array indexed by the packet type's ID.
+ */
+typedef struct
+{
+  GArray       *incoming;
+  GArray       *outgoing;
+  unsigned int *incoming_ids;
+  unsigned int  n_incoming_ids;
+} PluginCapabilities;
+
+static GMutex       capability_lock;
+static GHashTable  *capability_ids = NULL;
+static GPtrArray   *capability_names = NULL;
+static GQuark       capability_quark = 0;
+static unsigned int capability_pair = 0;
+static gboolean     default_threaded_io = FALSE;
+
+/*< private >
+ * PacketStats:
+ * @packets: number of packets received
+ * @bytes: encoded size of the packets received
+ * @handler_time: cumulative time spent in handlers, in microseconds
+ *
+ * Per-type accounting for incoming packets, indexed by packet type ID.
+ */
+typedef struct
+{
+  uint64_t packets;
+  uint64_t bytes;
+  uint64_t handler_time;
+} PacketStats;
+
+/*< private >
+ * capability_intern:
+ * @type: a packet type
+ *
+ * Get the ID for @type, adding it to the table if necessary.
+ *
+ * The table is never pruned, so only types declared by plugins are interned.
+ * Types from a remote device are resolved with capability_lookup(), since a
+ * type no plugin declares can not match any plugin.
+ *
+ * Returns: the capability ID
+ */
+static unsigned int
+capability_intern (const char *type)
+{
+  void *value = NULL;
+  unsigned int id;
+
+  g_assert (type != NULL && *type != '\0');
+
+  g_mutex_lock (&capability_lock);
+  if (capability_ids == NULL)
+    {
+      capability_ids = g_hash_table_new (g_str_hash, g_str_equal);
+      capability_names = g_ptr_array_new ();
+    }
+
+  if (g_hash_table_lookup_extended (capability_ids, type, NULL, &value))
+    {
+      id = GPOINTER_TO_UINT (value);
+    }
+  else
+    {
+      char *name = g_strdup (type);
+
+      id = capability_names->len;
+      g_ptr_array_add (capability_names, name);
+      g_hash_table_insert (capability_ids, name, GUINT_TO_POINTER (id));
+    }
+  g_mutex_unlock (&capability_lock);
+
+  return id;
+}
+
+static gboolean
+capability_lookup (const char   *type,
+                   unsigned int *id)
+{
+  void *value = NULL;
+  gboolean ret = FALSE;
+
+  g_assert (type != NULL);
+  g_assert (id != NULL);
+
+  g_mutex_lock (&capability_lock);
+  if (capability_ids != NULL &&
+      g_hash_table_lookup_extended (capability_ids, type, NULL, &value))
+    {
+      *id = GPOINTER_TO_UINT (value);
+      ret = TRUE;
+    }
+  g_mutex_unlock (&capability_lock);
+
+  return ret;
+}
+
+static inline void
+capability_set_add (GArray       *set,
+                    unsigned int  id)
+{
+  unsigned int word = id / 64;
+
+  if (word >= set->len)
+    g_array_set_size (set, word + 1);
+
+  g_array_index (set, uint64_t, word) |= ((uint64_t)1 << (id % 64));
+}
+
+/*< private >
+ * capability_generation:
+ *
+ * Get the number of interned types, which changes each time a plugin declares
+ * a new type.
+ *
+ * Returns: the capability table generation
+ */
+static inline unsigned int
+capability_generation (void)
+{
+  unsigned int ret = 0;
+
+  g_mutex_lock (&capability_lock);
+  if (capability_names != NULL)
+    ret = capability_names->len;
+  g_mutex_unlock (&capability_lock);
+
+  return ret;
+}
+
+static inline gboolean
+capability_set_intersects (GArray *a,
+                           GArray *b)
+{
+  unsigned int len = MIN (a->len, b->len);
+
+  for (unsigned int i = 0; i < len; i++)
+    {
+      if ((g_array_index (a, uint64_t, i) & g_array_index (b, uint64_t, i)) != 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*< private >
+ * capability_set_lookup:
+ * @types: (nullable): a %NULL-terminated list of packet types
+ *
+ * Create a capability set for @types, from a remote device. Types that have
+ * not been interned are skipped, so the set is bounded by the types plugins
+ * declare.
+ *
+ * Returns: (transfer full): a new capability set
+ */
+static GArray *
+capability_set_lookup (const char * const *types)
+{
+  GArray *set;
+
+  set = g_array_sized_new (FALSE, TRUE, sizeof (uint64_t), 1);
+
+  for (size_t i = 0; types != NULL && types[i] != NULL; i++)
+    {
+      unsigned int id;
+
+      if (capability_lookup (types[i], &id))
+        capability_set_add (set, id);
+    }
+
+  return set;
+}
+
+static GArray *
+capability_set_new (const char * const *types,
+                    GArray             *ids)
+{
+  GArray *set;
+
+  set = g_array_sized_new (FALSE, TRUE, sizeof (uint64_t), 1);
+
+  for (size_t i = 0; types != NULL && types[i] != NULL; i++)
+    {
+      unsigned int id;
+
+      if (*types[i] == '\0')
+        continue;
+
+      id = capability_intern (types[i]);
+      capability_set_add (set, id);
+
+      if (ids != NULL)
+        g_array_append_val (ids, id);
+    }
+
+  return set;
+}
+
+static void
+handlers_free (gpointer data)
+{
+  if (data != NULL)
+    g_ptr_array_unref (data);
+}
+
+static void
+plugin_capabilities_free (gpointer data)
+{
+  PluginCapabilities *caps = data;
+
+  g_clear_pointer (&caps->incoming, g_array_unref);
+  g_clear_pointer (&caps->outgoing, g_array_unref);
+  g_clear_pointer (&caps->incoming_ids, g_free);
+  g_free (caps);
+}
+
+/*< private >
+ * plugin_capabilities_get:
+ * @info: a `PeasPluginInfo`
+ *
+ * Get the packet capabilities declared by @info, parsing and interning them
+ * the first time the plugin is seen.
+ *
+ * Returns: (transfer none): the plugin capabilities
+ */
+static PluginCapabilities *
+plugin_capabilities_get (PeasPluginInfo *info)
+{
+  PluginCapabilities *caps;
+  const char *incoming;
+  const char *outgoing;
+
+  g_assert (info != NULL);
+
+  if G_UNLIKELY (capability_quark == 0)
+    capability_quark = g_quark_from_static_string ("valent-device-capabilities");
+
+  caps = g_object_get_qdata (G_OBJECT (info), capability_quark);
+  if G_LIKELY (caps != NULL)
+    return caps;
+
+  caps = g_new0 (PluginCapabilities, 1);
+
+  incoming = peas_plugin_info_get_external_data (info, "DevicePluginIncoming");
+  if (incoming != NULL)
+    {
+      g_auto (GStrv) types = g_strsplit (incoming, ";", -1);
+      g_autoptr (GArray) ids = NULL;
+
+      ids = g_array_new (FALSE, FALSE, sizeof (unsigned int));
+      caps->incoming = capability_set_new ((const char * const *)types, ids);
+      caps->n_incoming_ids = ids->len;
+      caps->incoming_ids = (unsigned int *)(void *)g_array_steal (ids, NULL);
+    }
+
+  outgoing = peas_plugin_info_get_external_data (info, "DevicePluginOutgoing");
+  if (outgoing != NULL)
+    {
+      g_auto (GStrv) types = g_strsplit (outgoing, ";", -1);
+
+      caps->outgoing = capability_set_new ((const char * const *)types, NULL);
+    }
+
+  g_object_set_qdata_full (G_OBJECT (info),
+                           capability_quark,
+                           caps,
+                           plugin_capabilities_free);
+
+  return caps;
+}
+
 
 /*
  * GActionGroup
  */
+static GAction *
+valent_device_lookup_action (ValentDevice *self,
+                             const char   *action_name)
+{
+  GAction *action;
+
+  if ((action = g_hash_table_lookup (self->actions, action_name)) != NULL)
+    return action;
+
+  return g_hash_table_lookup (self->actions_pending, action_name);
+}
+
 static void
 valent_device_activate_action (GActionGroup *action_group,
                                const char   *action_name,
@@ -108,7 +418,9 @@ valent_device_activate_action (GActionGroup *action_group,
   ValentDevice *self = VALENT_DEVICE (action_group);
   GAction *action;
 
-  if ((action = g_hash_table_lookup (self->actions, action_name)) != NULL)
+  valent_device_ensure_actions (self);
+
+  if ((action = valent_device_lookup_action (self, action_name)) != NULL)
     g_action_activate (action, parameter);
 }
 
@@ -120,7 +432,9 @@ valent_device_change_action_state (GActionGroup *action_group,
   ValentDevice *self = VALENT_DEVICE (action_group);
   GAction *action;
 
-  if ((action = g_hash_table_lookup (self->actions, action_name)) != NULL)
+  valent_device_ensure_actions (self);
+
+  if ((action = valent_device_lookup_action (self, action_name)) != NULL)
     g_action_change_state (action, value);
 }
 
@@ -133,6 +447,8 @@ valent_device_list_actions (GActionGroup *action_group)
   gpointer key;
   unsigned int i = 0;
 
+  valent_device_ensure_actions (self);
+
   actions = g_new0 (char *, g_hash_table_size (self->actions) + 1);
 
   g_hash_table_iter_init (&iter, self->actions);
@@ -155,6 +471,8 @@ valent_device_query_action (GActionGroup        *action_group,
   ValentDevice *self = VALENT_DEVICE (action_group);
   GAction *action;
 
+  valent_device_ensure_actions (self);
+
   if ((action = g_hash_table_lookup (self->actions, action_name)) == NULL)
     return FALSE;
 
@@ -189,6 +507,39 @@ g_action_group_iface_init (GActionGroupInterface *iface)
 /*
  * Private plugin methods
  */
+static gboolean
+valent_device_actions_added_cb (gpointer data)
+{
+  ValentDevice *self = VALENT_DEVICE (data);
+  g_autoptr (GHashTable) pending = NULL;
+  g_autofree const char **names = NULL;
+  unsigned int n_names = 0;
+
+  self->actions_source = 0;
+
+  /* The pending table owns the names until the signals have been emitted,
+   * in case a handler removes the action from the device.
+   */
+  pending = g_steal_pointer (&self->actions_pending);
+  self->actions_pending = g_hash_table_new_full (g_str_hash,
+                                                 g_str_equal,
+                                                 g_free,
+                                                 g_object_unref);
+
+  names = (const char **)g_hash_table_get_keys_as_array (pending, &n_names);
+  for (unsigned int i = 0; i < n_names; i++)
+    {
+      g_hash_table_replace (self->actions,
+                            g_strdup (names[i]),
+                            g_object_ref (g_hash_table_lookup (pending, names[i])));
+    }
+
+  for (unsigned int i = 0; i < n_names; i++)
+    g_action_group_action_added (G_ACTION_GROUP (self), names[i]);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 on_plugin_action_added (GActionGroup *action_group,
                         const char   *action_name,
@@ -204,6 +555,27 @@ on_plugin_action_added (GActionGroup *action_group,
   action = g_action_map_lookup_action (G_ACTION_MAP (action_group),
                                        action_name);
 
+  /* Actions added while plugins are instantiated for a caller of the
+   * `GActionGroup` interface are announced from an idle callback, since the
+   * caller may be in the middle of iterating or querying the group.
+   */
+  if (self->actions_deferred)
+    {
+      g_hash_table_replace (self->actions_pending,
+                            g_steal_pointer (&full_name),
+                            g_object_ref (action));
+
+      if (self->actions_source == 0)
+        {
+          self->actions_source = g_idle_add_full (G_PRIORITY_DEFAULT,
+                                                  valent_device_actions_added_cb,
+                                                  g_object_ref (self),
+                                                  g_object_unref);
+        }
+
+      return;
+    }
+
   g_hash_table_replace (self->actions,
                         g_strdup (full_name),
                         g_object_ref (action));
@@ -216,11 +588,16 @@ on_plugin_action_enabled_changed (GActionGroup *action_group,
                                   gboolean      enabled,
                                   ValentPlugin *plugin)
 {
+  ValentDevice *self = VALENT_DEVICE (plugin->parent);
   g_autofree char *full_name = NULL;
 
   full_name = g_strdup_printf ("%s.%s",
                                peas_plugin_info_get_module_name (plugin->info),
                                action_name);
+
+  if (g_hash_table_contains (self->actions_pending, full_name))
+    return;
+
   g_action_group_action_enabled_changed (G_ACTION_GROUP (plugin->parent),
                                          full_name,
                                          enabled);
@@ -238,6 +615,11 @@ on_plugin_action_removed (GActionGroup *action_group,
                                peas_plugin_info_get_module_name (plugin->info),
                                action_name);
 
+  /* Actions that were never announced are removed silently
+   */
+  if (g_hash_table_remove (self->actions_pending, full_name))
+    return;
+
   g_action_group_action_removed (G_ACTION_GROUP (plugin->parent), full_name);
   g_hash_table_remove (self->actions, full_name);
 }
@@ -248,11 +630,16 @@ on_plugin_action_state_changed (GActionGroup *action_group,
                                 GVariant     *value,
                                 ValentPlugin *plugin)
 {
+  ValentDevice *self = VALENT_DEVICE (plugin->parent);
   g_autofree char *full_name = NULL;
 
   full_name = g_strdup_printf ("%s.%s",
                                peas_plugin_info_get_module_name (plugin->info),
                                action_name);
+
+  if (g_hash_table_contains (self->actions_pending, full_name))
+    return;
+
   g_action_group_action_state_changed (G_ACTION_GROUP (plugin->parent),
                                        full_name,
                                        value);
@@ -264,7 +651,7 @@ valent_device_enable_plugin (ValentDevice *device,
 {
   g_auto (GStrv) actions = NULL;
   g_autofree char *urn = NULL;
-  const char *incoming = NULL;
+  PluginCapabilities *caps = NULL;
 
   g_assert (VALENT_IS_DEVICE (device));
   g_assert (plugin != NULL);
@@ -279,27 +666,22 @@ valent_device_enable_plugin (ValentDevice *device,
 
   /* Register packet handlers
    */
-  incoming = peas_plugin_info_get_external_data (plugin->info,
-                                                 "DevicePluginIncoming");
-  if (incoming != NULL)
+  caps = plugin_capabilities_get (plugin->info);
+  for (unsigned int i = 0; i < caps->n_incoming_ids; i++)
     {
-      g_auto (GStrv) capabilities = NULL;
+      GPtrArray *handlers = NULL;
+      unsigned int id = caps->incoming_ids[i];
 
-      capabilities = g_strsplit (incoming, ";", -1);
+      if (id >= device->handlers->len)
+        g_ptr_array_set_size (device->handlers, id + 1);
 
-      for (unsigned int i = 0; capabilities[i] != NULL; i++)
+      if ((handlers = g_ptr_array_index (device->handlers, id)) == NULL)
         {
-          GPtrArray *handlers = NULL;
-          const char *type = capabilities[i];
-
-          if ((handlers = g_hash_table_lookup (device->handlers, type)) == NULL)
-            {
-              handlers = g_ptr_array_new ();
-              g_hash_table_insert (device->handlers, g_strdup (type), handlers);
-            }
-
-          g_ptr_array_add (handlers, plugin->extension);
+          handlers = g_ptr_array_new ();
+          g_ptr_array_index (device->handlers, id) = handlers;
         }
+
+      g_ptr_array_add (handlers, plugin->extension);
     }
 
   /* Register plugin actions
@@ -340,7 +722,7 @@ valent_device_disable_plugin (ValentDevice *device,
                               ValentPlugin *plugin)
 {
   g_auto (GStrv) actions = NULL;
-  const char *incoming = NULL;
+  PluginCapabilities *caps = NULL;
 
   g_assert (VALENT_IS_DEVICE (device));
   g_assert (plugin != NULL);
@@ -359,24 +741,23 @@ valent_device_disable_plugin (ValentDevice *device,
 
   /* Unregister packet handlers
    */
-  incoming = peas_plugin_info_get_external_data (plugin->info,
-                                                 "DevicePluginIncoming");
-  if (incoming != NULL)
+  caps = plugin_capabilities_get (plugin->info);
+  for (unsigned int i = 0; i < caps->n_incoming_ids; i++)
     {
-      g_auto (GStrv) capabilities = NULL;
+      GPtrArray *handlers = NULL;
+      unsigned int id = caps->incoming_ids[i];
 
-      capabilities = g_strsplit (incoming, ";", -1);
-      for (size_t i = 0; capabilities[i] != NULL; i++)
-        {
-          GPtrArray *handlers = NULL;
+      if (id >= device->handlers->len)
+        continue;
 
-          handlers = g_hash_table_lookup (device->handlers, capabilities[i]);
-          if (handlers == NULL)
-            continue;
+      if ((handlers = g_ptr_array_index (device->handlers, id)) == NULL)
+        continue;
 
-          g_ptr_array_remove (handlers, plugin->extension);
-          if (handlers->len == 0)
-            g_hash_table_remove (device->handlers, capabilities[i]);
+      g_ptr_array_remove (handlers, plugin->extension);
+      if (handlers->len == 0)
+        {
+          g_ptr_array_index (device->handlers, id) = NULL;
+          g_ptr_array_unref (handlers);
         }
     }
 
@@ -391,18 +772,102 @@ on_plugin_enabled_changed (ValentPlugin *plugin)
   g_assert (VALENT_IS_DEVICE (plugin->parent));
 
   if (valent_plugin_get_enabled (plugin))
-    valent_device_enable_plugin (plugin->parent, plugin);
-  else
-    valent_device_disable_plugin (plugin->parent, plugin);
+    {
+      ValentDevice *device = VALENT_DEVICE (plugin->parent);
+
+      if (device->plugins_ready && plugin->extension == NULL)
+        valent_device_enable_plugin (device, plugin);
+    }
+  else if (plugin->extension != NULL)
+    {
+      valent_device_disable_plugin (plugin->parent, plugin);
+    }
+}
+
+/*< private >
+ * valent_device_ensure_plugins:
+ * @device: a `ValentDevice`
+ *
+ * Instantiate the extensions for each enabled plugin.
+ *
+ * Until a device connects, or something inspects its action group or menu,
+ * each supported plugin is only tracked by its `ValentPlugin` descriptor.
+ * This avoids constructing extensions (and whatever stores they open) for
+ * remembered devices that may never connect during the session.
+ */
+static void
+valent_device_ensure_plugins (ValentDevice *device)
+{
+  GHashTableIter iter;
+  ValentPlugin *plugin;
+
+  g_assert (VALENT_IS_DEVICE (device));
+
+  if G_LIKELY (device->plugins_ready)
+    return;
+
+  if (valent_object_in_destruction (VALENT_OBJECT (device)))
+    return;
+
+  VALENT_NOTE ("%s: instantiating plugins", device->name);
+
+  device->plugins_ready = TRUE;
+
+  g_hash_table_iter_init (&iter, device->plugins);
+  while (g_hash_table_iter_next (&iter, NULL, (void **)&plugin))
+    {
+      if (plugin->extension == NULL && valent_plugin_get_enabled (plugin))
+        valent_device_enable_plugin (device, plugin);
+    }
+}
+
+/*< private >
+ * valent_device_ensure_actions:
+ * @device: a `ValentDevice`
+ *
+ * Like valent_device_ensure_plugins(), but for callers of the `GActionGroup`
+ * interface, so that `GActionGroup::action-added` is not emitted reentrantly.
+ */
+static void
+valent_device_ensure_actions (ValentDevice *device)
+{
+  g_assert (VALENT_IS_DEVICE (device));
+
+  if G_LIKELY (device->plugins_ready)
+    return;
+
+  device->actions_deferred = TRUE;
+  valent_device_ensure_plugins (device);
+  device->actions_deferred = FALSE;
+}
+
+static void
+valent_device_update_capabilities (ValentDevice *device)
+{
+  g_assert (VALENT_IS_DEVICE (device));
+
+  device->capabilities_generation = capability_generation ();
+  g_clear_pointer (&device->incoming_capabilities, g_array_unref);
+  g_clear_pointer (&device->outgoing_capabilities, g_array_unref);
+
+  if (device->incoming_types != NULL)
+    {
+      device->incoming_capabilities =
+        capability_set_lookup ((const char * const *)device->incoming_types);
+    }
+
+  if (device->outgoing_types != NULL)
+    {
+      device->outgoing_capabilities =
+        capability_set_lookup ((const char * const *)device->outgoing_types);
+    }
 }
 
 static gboolean
 valent_device_supports_plugin (ValentDevice   *device,
                                PeasPluginInfo *info)
 {
-  const char **device_incoming;
-  const char **device_outgoing;
-  const char *in_str, *out_str;
+  PluginCapabilities *caps;
 
   g_assert (VALENT_IS_DEVICE (device));
   g_assert (info != NULL);
@@ -414,42 +879,30 @@ valent_device_supports_plugin (ValentDevice   *device,
 
   /* Plugins that don't handle packets aren't dependent on capabilities
    */
-  in_str = peas_plugin_info_get_external_data (info, "DevicePluginIncoming");
-  out_str = peas_plugin_info_get_external_data (info, "DevicePluginOutgoing");
-  if (in_str == NULL && out_str == NULL)
+  caps = plugin_capabilities_get (info);
+  if (caps->incoming == NULL && caps->outgoing == NULL)
     return TRUE;
 
+  /* The device capabilities only include interned types, so they are rebuilt
+   * if a plugin has declared new types since.
+   */
+  if (device->capabilities_generation != capability_generation ())
+    valent_device_update_capabilities (device);
+
   /* If capabilities are ready, check if the plugin outgoing matches the
    * incoming device or vice-versa.
    */
-  device_incoming = (const char **)device->incoming_capabilities;
-  device_outgoing = (const char **)device->outgoing_capabilities;
-  if (device_incoming == NULL || device_outgoing == NULL)
+  if (device->incoming_capabilities == NULL ||
+      device->outgoing_capabilities == NULL)
     return FALSE;
 
-  if (out_str != NULL)
-    {
-      g_auto (GStrv) plugin_outgoing = NULL;
-
-      plugin_outgoing = g_strsplit (out_str, ";", -1);
-      for (size_t i = 0; plugin_outgoing[i] != NULL; i++)
-        {
-          if (g_strv_contains (device_incoming, plugin_outgoing[i]))
-            return TRUE;
-        }
-    }
-
-  if (in_str != NULL)
-    {
-      g_auto (GStrv) plugin_incoming = NULL;
+  if (caps->outgoing != NULL &&
+      capability_set_intersects (caps->outgoing, device->incoming_capabilities))
+    return TRUE;
 
-      plugin_incoming = g_strsplit (in_str, ";", -1);
-      for (size_t i = 0; plugin_incoming[i] != NULL; i++)
-        {
-          if (g_strv_contains (device_outgoing, plugin_incoming[i]))
-            return TRUE;
-        }
-    }
+  if (caps->incoming != NULL &&
+      capability_set_intersects (caps->incoming, device->outgoing_capabilities))
+    return TRUE;
 
   return FALSE;
 }
@@ -476,7 +929,7 @@ on_load_plugin (PeasEngine     *engine,
                               G_CALLBACK (on_plugin_enabled_changed));
   g_hash_table_insert (self->plugins, plugin_info, plugin);
 
-  if (valent_plugin_get_enabled (plugin))
+  if (self->plugins_ready && valent_plugin_get_enabled (plugin))
     valent_device_enable_plugin (self, plugin);
 }
 
@@ -651,8 +1104,8 @@ valent_device_set_paired (ValentDevice *self,
   /* Store the certificate in the configuration directory if paired,
    * otherwise delete the certificate and clear the data context.
    *
-   * TODO: KDE Connect uses certificate pinning, but there is no shared resource
-   *       mediating between a ValentDevice and a ValentChannelService.
+   * The cached trusted certificate is invalidated either way, so the next
+   * connection handshake sees the current pairing state.
    */
   certificate_file = valent_context_get_config_file (self->context,
                                                      "certificate.pem");
@@ -702,6 +1155,7 @@ valent_device_set_paired (ValentDevice *self,
       valent_context_clear (self->context);
     }
 
+  valent_certificate_invalidate (self->id);
   self->paired = paired;
 
   valent_device_reset_pair (self);
@@ -965,13 +1419,11 @@ valent_device_handle_identity (ValentDevice *device,
   /* In practice these are static, but in principle could change with the
    * channel (e.g. TCP and Bluetooth).
    */
-  g_clear_pointer (&device->incoming_capabilities, g_strfreev);
-  device->incoming_capabilities =
-    valent_packet_dup_strv (packet, "incomingCapabilities");
-
-  g_clear_pointer (&device->outgoing_capabilities, g_strfreev);
-  device->outgoing_capabilities =
-    valent_packet_dup_strv (packet, "outgoingCapabilities");
+  g_clear_pointer (&device->incoming_types, g_strfreev);
+  g_clear_pointer (&device->outgoing_types, g_strfreev);
+  device->incoming_types = valent_packet_dup_strv (packet, "incomingCapabilities");
+  device->outgoing_types = valent_packet_dup_strv (packet, "outgoingCapabilities");
+  valent_device_update_capabilities (device);
 
   /* It's not clear if this is only a required field for TLS connections,
    * or if it applies to Bluetooth as well.
@@ -988,21 +1440,43 @@ valent_device_handle_identity (ValentDevice *device,
 
 static void
 valent_device_handle_packet (ValentDevice *self,
-                             JsonNode     *packet)
+                             JsonNode     *packet,
+                             size_t        size)
 {
   GPtrArray *handlers = NULL;
+  PacketStats *stats = NULL;
   const char *type;
+  unsigned int id;
+  int64_t begin;
 
   g_assert (VALENT_IS_DEVICE (self));
   g_assert (VALENT_IS_PACKET (packet));
 
   VALENT_JSON (packet, self->name);
 
+  /* Only types declared by plugins are interned, so neither arbitrary packets
+   * nor identity packets can be used to grow the table.
+   */
   type = valent_packet_get_type (packet);
-  if G_UNLIKELY (g_str_equal (type, "kdeconnect.pair"))
+  if G_LIKELY (capability_lookup (type, &id))
     {
-      valent_device_handle_pair (self, packet);
-      return;
+      if (id >= self->packet_stats->len)
+        g_array_set_size (self->packet_stats, id + 1);
+
+      stats = &g_array_index (self->packet_stats, PacketStats, id);
+      stats->packets += 1;
+      stats->bytes += size;
+
+      if G_UNLIKELY (id == capability_pair)
+        {
+          begin = g_get_monotonic_time ();
+          valent_device_handle_pair (self, packet);
+          stats->handler_time += g_get_monotonic_time () - begin;
+          return;
+        }
+
+      if (id < self->handlers->len)
+        handlers = g_ptr_array_index (self->handlers, id);
     }
 
   if G_UNLIKELY (!self->paired)
@@ -1013,7 +1487,6 @@ valent_device_handle_packet (ValentDevice *self,
       return;
     }
 
-  handlers = g_hash_table_lookup (self->handlers, type);
   if G_UNLIKELY (handlers == NULL)
     {
       g_debug ("%s(): unsupported \"%s\" packet from %s",
@@ -1021,12 +1494,17 @@ valent_device_handle_packet (ValentDevice *self,
       return;
     }
 
+  begin = g_get_monotonic_time ();
   for (unsigned int i = 0, len = handlers->len; i < len; i++)
     {
       ValentDevicePlugin *handler = g_ptr_array_index (handlers, i);
 
       valent_device_plugin_handle_packet (handler, type, packet);
     }
+
+  /* The array may have been reallocated by a handler */
+  stats = &g_array_index (self->packet_stats, PacketStats, id);
+  stats->handler_time += g_get_monotonic_time () - begin;
 }
 
 /*
@@ -1105,7 +1583,9 @@ valent_device_destroy (ValentObject *object)
   g_signal_handlers_disconnect_by_data (self->engine, self);
   g_hash_table_remove_all (self->plugins);
   g_hash_table_remove_all (self->actions);
-  g_hash_table_remove_all (self->handlers);
+  g_hash_table_remove_all (self->actions_pending);
+  g_clear_handle_id (&self->actions_source, g_source_remove);
+  g_ptr_array_set_size (self->handlers, 0);
 
   VALENT_OBJECT_CLASS (valent_device_parent_class)->destroy (object);
 }
@@ -1177,8 +1657,10 @@ valent_device_finalize (GObject *object)
   g_clear_pointer (&self->id, g_free);
   g_clear_pointer (&self->name, g_free);
   g_clear_pointer (&self->type, g_free);
-  g_clear_pointer (&self->incoming_capabilities, g_strfreev);
-  g_clear_pointer (&self->outgoing_capabilities, g_strfreev);
+  g_clear_pointer (&self->incoming_types, g_strfreev);
+  g_clear_pointer (&self->outgoing_types, g_strfreev);
+  g_clear_pointer (&self->incoming_capabilities, g_array_unref);
+  g_clear_pointer (&self->outgoing_capabilities, g_array_unref);
 
   /* State */
   g_clear_object (&self->channels);
@@ -1187,7 +1669,9 @@ valent_device_finalize (GObject *object)
   /* Plugins */
   g_clear_pointer (&self->plugins, g_hash_table_unref);
   g_clear_pointer (&self->actions, g_hash_table_unref);
-  g_clear_pointer (&self->handlers, g_hash_table_unref);
+  g_clear_pointer (&self->actions_pending, g_hash_table_unref);
+  g_clear_pointer (&self->handlers, g_ptr_array_unref);
+  g_clear_pointer (&self->packet_stats, g_array_unref);
   g_clear_object (&self->menu);
 
   G_OBJECT_CLASS (valent_device_parent_class)->finalize (object);
@@ -1261,14 +1745,17 @@ valent_device_init (ValentDevice *self)
 
   self->channels = G_LIST_MODEL (g_list_store_new (VALENT_TYPE_CHANNEL));
   self->plugins = g_hash_table_new_full (NULL, NULL, NULL, valent_plugin_free);
-  self->handlers = g_hash_table_new_full (g_str_hash,
-                                          g_str_equal,
-                                          g_free,
-                                          (GDestroyNotify)g_ptr_array_unref);
+  self->handlers = g_ptr_array_new_with_free_func (handlers_free);
+  self->packet_stats = g_array_new (FALSE, TRUE, sizeof (PacketStats));
+  self->threaded_io = default_threaded_io;
   self->actions = g_hash_table_new_full (g_str_hash,
                                          g_str_equal,
                                          g_free,
                                          g_object_unref);
+  self->actions_pending = g_hash_table_new_full (g_str_hash,
+                                                 g_str_equal,
+                                                 g_free,
+                                                 g_object_unref);
   self->menu = g_menu_new ();
 
   /* Stock Actions */
@@ -1299,6 +1786,9 @@ valent_device_class_init (ValentDeviceClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   ValentObjectClass *vobject_class = VALENT_OBJECT_CLASS (klass);
 
+  capability_pair = capability_intern ("kdeconnect.pair");
+  default_threaded_io = (g_strcmp0 (g_getenv ("VALENT_THREADED_IO"), "1") == 0);
+
   object_class->constructed = valent_device_constructed;
   object_class->finalize = valent_device_finalize;
   object_class->get_property = valent_device_get_property;
@@ -1452,11 +1942,12 @@ valent_device_send_packet_cb (ValentChannel *channel,
       valent_object_destroy (VALENT_OBJECT (channel));
       if (self->channel != NULL)
         {
-          valent_channel_write_packet (self->channel,
-                                       packet,
-                                       cancellable,
-                                       (GAsyncReadyCallback)valent_device_send_packet_cb,
-                                       g_object_ref (task));
+          valent_channel_write_packet_full (self->channel,
+                                            packet,
+                                            g_task_get_priority (task),
+                                            cancellable,
+                                            (GAsyncReadyCallback)valent_device_send_packet_cb,
+                                            g_object_ref (task));
           return;
         }
     }
@@ -1474,6 +1965,9 @@ valent_device_send_packet_cb (ValentChannel *channel,
  *
  * Send a KDE Connect packet to the device.
  *
+ * This is equivalent to calling [method@Valent.Device.send_packet_full] with
+ * %G_PRIORITY_DEFAULT.
+ *
  * Call [method@Valent.Device.send_packet_finish] to get the result.
  *
  * If @device is disconnected or unpaired when this method is called,
@@ -1488,6 +1982,47 @@ valent_device_send_packet (ValentDevice        *device,
                            GCancellable        *cancellable,
                            GAsyncReadyCallback  callback,
                            gpointer             user_data)
+{
+  g_return_if_fail (VALENT_IS_DEVICE (device));
+  g_return_if_fail (VALENT_IS_PACKET (packet));
+
+  valent_device_send_packet_full (device,
+                                  packet,
+                                  G_PRIORITY_DEFAULT,
+                                  cancellable,
+                                  callback,
+                                  user_data);
+}
+
+/**
+ * valent_device_send_packet_full:
+ * @device: a `ValentDevice`
+ * @packet: a KDE Connect packet
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): a `GCancellable`
+ * @callback: (scope async): a `GAsyncReadyCallback`
+ * @user_data: user supplied data
+ *
+ * Send a KDE Connect packet to the device, with an explicit priority.
+ *
+ * See [method@Valent.Channel.write_packet_full] for how @io_priority affects
+ * the order packets are sent in.
+ *
+ * Call [method@Valent.Device.send_packet_finish] to get the result.
+ *
+ * If @device is disconnected or unpaired when this method is called,
+ * %G_IO_ERROR_NOT_CONNECTED or %G_IO_ERROR_PERMISSION_DENIED will be set on the
+ * result, respectively.
+ *
+ * Since: 1.0
+ */
+void
+valent_device_send_packet_full (ValentDevice        *device,
+                                JsonNode            *packet,
+                                int                  io_priority,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
 {
   g_autoptr (GTask) task = NULL;
 
@@ -1520,14 +2055,16 @@ valent_device_send_packet (ValentDevice        *device,
 
   task = g_task_new (device, cancellable, callback, user_data);
   g_task_set_source_tag (task, valent_device_send_packet);
+  g_task_set_priority (task, io_priority);
   g_task_set_task_data (task,
                         json_node_ref (packet),
                         (GDestroyNotify)json_node_unref);
-  valent_channel_write_packet (device->channel,
-                               packet,
-                               cancellable,
-                               (GAsyncReadyCallback)valent_device_send_packet_cb,
-                               g_steal_pointer (&task));
+  valent_channel_write_packet_full (device->channel,
+                                    packet,
+                                    io_priority,
+                                    cancellable,
+                                    (GAsyncReadyCallback)valent_device_send_packet_cb,
+                                    g_steal_pointer (&task));
 }
 
 /**
@@ -1536,7 +2073,8 @@ valent_device_send_packet (ValentDevice        *device,
  * @result: a `GAsyncResult`
  * @error: (nullable): a `GError`
  *
- * Finish an operation started by [method@Valent.Device.send_packet].
+ * Finish an operation started by [method@Valent.Device.send_packet] or
+ * [method@Valent.Device.send_packet_full].
  *
  * Returns: %TRUE if successful, or %FALSE with @error set
  *
@@ -1571,11 +2109,13 @@ read_packet_cb (ValentChannel *channel,
   packet = valent_channel_read_packet_finish (channel, result, &error);
   if (packet != NULL)
     {
+      size_t size = valent_channel_read_packet_get_size (result);
+
       valent_channel_read_packet (channel,
                                   g_task_get_cancellable (G_TASK (result)),
                                   (GAsyncReadyCallback)read_packet_cb,
                                   g_object_ref (device));
-      valent_device_handle_packet (device, packet);
+      valent_device_handle_packet (device, packet, size);
     }
   else
     {
@@ -1586,6 +2126,386 @@ read_packet_cb (ValentChannel *channel,
   g_object_unref (device);
 }
 
+/*
+ * Threaded I/O
+ *
+ * In threaded mode each channel is read by a dedicated worker thread, which
+ * reads and decodes packets in its own main context. Decoded packets are passed
+ * to the device's main context through a bounded queue; when the queue is full
+ * the worker stops reading until the device catches up, so the peer is slowed
+ * down by TCP flow control rather than packets being lost.
+ */
+typedef struct
+{
+  JsonNode *packet;
+  size_t    size;
+} QueuedPacket;
+
+typedef struct
+{
+  gatomicrefcount  ref_count;
+
+  GWeakRef         device;
+  GWeakRef         channel;
+  GCancellable    *cancellable;
+  GMainContext    *context;
+
+  /* protected by lock */
+  GMutex           lock;
+  GCond            cond;
+  GQueue           queue;
+  GError          *error;
+  uint64_t         n_deferred;
+  gboolean         done;
+  gboolean         stopped;
+  gboolean         dispatch_pending;
+} PacketReader;
+
+static void
+queued_packet_free (gpointer data)
+{
+  QueuedPacket *item = (QueuedPacket *)data;
+
+  g_clear_pointer (&item->packet, json_node_unref);
+  g_free (item);
+}
+
+static PacketReader *
+packet_reader_ref (PacketReader *reader)
+{
+  g_atomic_ref_count_inc (&reader->ref_count);
+
+  return reader;
+}
+
+static void
+packet_reader_unref (gpointer data)
+{
+  PacketReader *reader = (PacketReader *)data;
+
+  if (!g_atomic_ref_count_dec (&reader->ref_count))
+    return;
+
+  g_weak_ref_clear (&reader->device);
+  g_weak_ref_clear (&reader->channel);
+  g_clear_object (&reader->cancellable);
+  g_clear_pointer (&reader->context, g_main_context_unref);
+  g_queue_clear_full (&reader->queue, queued_packet_free);
+  g_clear_error (&reader->error);
+  g_mutex_clear (&reader->lock);
+  g_cond_clear (&reader->cond);
+  g_free (reader);
+}
+
+static inline gboolean
+packet_reader_is_stopped (PacketReader *reader)
+{
+  gboolean ret;
+
+  g_mutex_lock (&reader->lock);
+  ret = reader->stopped;
+  g_mutex_unlock (&reader->lock);
+
+  return ret;
+}
+
+static gboolean
+packet_reader_dispatch (gpointer data)
+{
+  PacketReader *reader = (PacketReader *)data;
+  g_autoptr (ValentDevice) device = NULL;
+  g_autoptr (GError) error = NULL;
+  GQueue batch = G_QUEUE_INIT;
+  uint64_t n_deferred = 0;
+  gboolean stopped = FALSE;
+  gboolean ret = G_SOURCE_REMOVE;
+  QueuedPacket *item;
+
+  /* If the device is gone, stop the worker rather than leaving it waiting
+   * for a dispatch that will never happen
+   */
+  device = g_weak_ref_get (&reader->device);
+  if (device == NULL)
+    {
+      g_cancellable_cancel (reader->cancellable);
+
+      g_mutex_lock (&reader->lock);
+      reader->stopped = TRUE;
+      reader->dispatch_pending = FALSE;
+      g_queue_clear_full (&reader->queue, queued_packet_free);
+      g_cond_broadcast (&reader->cond);
+      g_mutex_unlock (&reader->lock);
+
+      return G_SOURCE_REMOVE;
+    }
+
+  g_mutex_lock (&reader->lock);
+  for (unsigned int i = 0; i < PACKET_QUEUE_BATCH; i++)
+    {
+      if ((item = g_queue_pop_head (&reader->queue)) == NULL)
+        break;
+
+      g_queue_push_tail (&batch, item);
+    }
+
+  n_deferred = reader->n_deferred;
+  reader->n_deferred = 0;
+
+  if (!g_queue_is_empty (&reader->queue))
+    ret = G_SOURCE_CONTINUE;
+  else if (reader->done)
+    error = g_steal_pointer (&reader->error);
+
+  stopped = reader->stopped;
+  reader->dispatch_pending = (ret == G_SOURCE_CONTINUE);
+  g_cond_broadcast (&reader->cond);
+  g_mutex_unlock (&reader->lock);
+
+  if (stopped)
+    {
+      g_queue_clear_full (&batch, queued_packet_free);
+      return G_SOURCE_REMOVE;
+    }
+
+  device->queue_deferred += n_deferred;
+
+  /* Handling a packet may stop the reader, if it closes the channel
+   */
+  while ((item = g_queue_pop_head (&batch)) != NULL)
+    {
+      if (!stopped)
+        {
+          valent_device_handle_packet (device, item->packet, item->size);
+          stopped = packet_reader_is_stopped (reader);
+        }
+      else
+        {
+          device->queue_dropped += 1;
+        }
+
+      queued_packet_free (item);
+    }
+
+  if (error != NULL && !stopped)
+    {
+      g_autoptr (ValentChannel) channel = NULL;
+
+      VALENT_NOTE ("%s: %s", device->name, error->message);
+
+      if ((channel = g_weak_ref_get (&reader->channel)) != NULL)
+        valent_object_destroy (VALENT_OBJECT (channel));
+    }
+
+  return ret;
+}
+
+/* Must be called with the lock held */
+static void
+packet_reader_schedule_unlocked (PacketReader *reader)
+{
+  g_autoptr (GSource) source = NULL;
+
+  if (reader->dispatch_pending)
+    return;
+
+  reader->dispatch_pending = TRUE;
+
+  /* The source is always attached, rather than using g_main_context_invoke(),
+   * since the callback must never run in the worker thread.
+   */
+  source = g_idle_source_new ();
+  g_source_set_priority (source, G_PRIORITY_DEFAULT);
+  g_source_set_static_name (source, "[valent-packet-dispatch]");
+  g_source_set_callback (source,
+                         packet_reader_dispatch,
+                         packet_reader_ref (reader),
+                         packet_reader_unref);
+  g_source_attach (source, reader->context);
+}
+
+static gboolean
+packet_reader_push (PacketReader *reader,
+                    JsonNode     *packet,
+                    size_t        size,
+                    GError       *error)
+{
+  gboolean deferred = FALSE;
+  QueuedPacket *item;
+
+  g_mutex_lock (&reader->lock);
+  if (packet == NULL)
+    {
+      reader->error = error;
+      reader->done = TRUE;
+      packet_reader_schedule_unlocked (reader);
+      g_mutex_unlock (&reader->lock);
+      return FALSE;
+    }
+
+  while (g_queue_get_length (&reader->queue) >= PACKET_QUEUE_MAX &&
+         !reader->stopped)
+    {
+      if (!deferred)
+        {
+          reader->n_deferred += 1;
+          deferred = TRUE;
+        }
+
+      g_cond_wait (&reader->cond, &reader->lock);
+    }
+
+  if (reader->stopped)
+    {
+      g_mutex_unlock (&reader->lock);
+      return FALSE;
+    }
+
+  item = g_new0 (QueuedPacket, 1);
+  item->packet = json_node_ref (packet);
+  item->size = size;
+  g_queue_push_tail (&reader->queue, item);
+  packet_reader_schedule_unlocked (reader);
+  g_mutex_unlock (&reader->lock);
+
+  return TRUE;
+}
+
+static void
+packet_reader_read_cb (ValentChannel *channel,
+                       GAsyncResult  *result,
+                       gpointer       user_data)
+{
+  GAsyncResult **ret = (GAsyncResult **)user_data;
+
+  *ret = g_object_ref (result);
+}
+
+static gpointer
+packet_reader_thread (gpointer data)
+{
+  PacketReader *reader = (PacketReader *)data;
+  g_autoptr (GMainContext) context = NULL;
+  g_autoptr (ValentChannel) channel = NULL;
+
+  /* The worker holds the only strong reference to the channel from the
+   * reader, which the channel owns, and releases it when it exits.
+   */
+  channel = g_weak_ref_get (&reader->channel);
+  if (channel == NULL)
+    {
+      packet_reader_unref (reader);
+      return NULL;
+    }
+
+  context = g_main_context_new ();
+  g_main_context_push_thread_default (context);
+
+  while (TRUE)
+    {
+      g_autoptr (GAsyncResult) result = NULL;
+      g_autoptr (JsonNode) packet = NULL;
+      GError *error = NULL;
+      size_t size = 0;
+
+      valent_channel_read_packet (channel,
+                                  reader->cancellable,
+                                  (GAsyncReadyCallback)packet_reader_read_cb,
+                                  &result);
+
+      while (result == NULL)
+        g_main_context_iteration (context, TRUE);
+
+      packet = valent_channel_read_packet_finish (channel, result, &error);
+      size = valent_channel_read_packet_get_size (result);
+
+      if (!packet_reader_push (reader, packet, size, error))
+        break;
+    }
+
+  g_main_context_pop_thread_default (context);
+  packet_reader_unref (reader);
+
+  return NULL;
+}
+
+static void
+packet_reader_stop (gpointer data)
+{
+  PacketReader *reader = (PacketReader *)data;
+  g_autoptr (ValentDevice) device = NULL;
+  unsigned int n_dropped = 0;
+
+  g_cancellable_cancel (reader->cancellable);
+
+  g_mutex_lock (&reader->lock);
+  reader->stopped = TRUE;
+  n_dropped = g_queue_get_length (&reader->queue);
+  g_queue_clear_full (&reader->queue, queued_packet_free);
+  g_cond_broadcast (&reader->cond);
+  g_mutex_unlock (&reader->lock);
+
+  if ((device = g_weak_ref_get (&reader->device)) != NULL)
+    device->queue_dropped += n_dropped;
+
+  packet_reader_unref (reader);
+}
+
+static void
+valent_device_read_channel (ValentDevice  *device,
+                            ValentChannel *channel)
+{
+  g_autoptr (GCancellable) cancellable = NULL;
+  g_autoptr (GThread) thread = NULL;
+  g_autoptr (GError) error = NULL;
+  PacketReader *reader;
+
+  g_assert (VALENT_IS_DEVICE (device));
+  g_assert (VALENT_IS_CHANNEL (channel));
+
+  cancellable = valent_object_ref_cancellable (VALENT_OBJECT (device));
+
+  if (!device->threaded_io)
+    {
+      valent_channel_read_packet (channel,
+                                  cancellable,
+                                  (GAsyncReadyCallback)read_packet_cb,
+                                  g_object_ref (device));
+      return;
+    }
+
+  reader = g_new0 (PacketReader, 1);
+  g_atomic_ref_count_init (&reader->ref_count);
+  g_weak_ref_init (&reader->device, device);
+  g_weak_ref_init (&reader->channel, channel);
+  reader->cancellable = g_cancellable_new ();
+  reader->context = g_main_context_ref_thread_default ();
+  g_mutex_init (&reader->lock);
+  g_cond_init (&reader->cond);
+  g_queue_init (&reader->queue);
+
+  thread = g_thread_try_new ("valent-channel-reader",
+                             packet_reader_thread,
+                             packet_reader_ref (reader),
+                             &error);
+  if (thread == NULL)
+    {
+      g_warning ("%s(): %s", G_STRFUNC, error->message);
+      packet_reader_unref (reader);
+      packet_reader_unref (reader);
+
+      valent_channel_read_packet (channel,
+                                  cancellable,
+                                  (GAsyncReadyCallback)read_packet_cb,
+                                  g_object_ref (device));
+      return;
+    }
+
+  g_object_set_data_full (G_OBJECT (channel),
+                          PACKET_READER_KEY,
+                          reader,
+                          packet_reader_stop);
+}
+
 /**
  * valent_device_get_channels: (get-property channels)
  * @device: a `ValentDevice`
@@ -1611,6 +2531,8 @@ on_channel_destroy (ValentObject *object,
   ValentChannel *channel = VALENT_CHANNEL (object);
   unsigned int position = 0;
 
+  g_object_set_data (G_OBJECT (channel), PACKET_READER_KEY, NULL);
+
   if (g_list_store_find (G_LIST_STORE (self->channels), object, &position))
     {
       g_list_store_remove (G_LIST_STORE (self->channels), position);
@@ -1658,7 +2580,6 @@ valent_device_add_channel (ValentDevice  *device,
                            ValentChannel *channel)
 {
   JsonNode *peer_identity;
-  g_autoptr (GCancellable) cancellable = NULL;
   unsigned int n_channels = 0;
   unsigned int position = 0;
 
@@ -1682,12 +2603,9 @@ valent_device_add_channel (ValentDevice  *device,
    */
   peer_identity = valent_channel_get_peer_identity (channel);
   valent_device_handle_identity (device, peer_identity);
+  valent_device_ensure_plugins (device);
 
-  cancellable = valent_object_ref_cancellable (VALENT_OBJECT (device));
-  valent_channel_read_packet (channel,
-                              cancellable,
-                              (GAsyncReadyCallback)read_packet_cb,
-                              g_object_ref (device));
+  valent_device_read_channel (device, channel);
 
   /* Hold a reference to the channel if it has the highest priority,
    * and notify of the state change if it's the first channel
@@ -1775,6 +2693,8 @@ valent_device_get_menu (ValentDevice *device)
 {
   g_return_val_if_fail (VALENT_IS_DEVICE (device), NULL);
 
+  valent_device_ensure_plugins (device);
+
   return G_MENU_MODEL (device->menu);
 }
 
@@ -2004,3 +2924,107 @@ valent_device_validate_name (const char *name)
   return has_nonwhitespace;
 }
 
+/*< private >
+ * valent_device_dup_packet_statistics:
+ * @device: a `ValentDevice`
+ *
+ * Get the incoming packet statistics for @device.
+ *
+ * The result is a dictionary of packet type to a tuple of the number of
+ * packets received, their encoded size in bytes and the cumulative time spent
+ * handling them in microseconds.
+ *
+ * Returns: (transfer full): a `GVariant` of type `a{s(ttt)}`
+ */
+GVariant *
+valent_device_dup_packet_statistics (ValentDevice *device)
+{
+  GVariantBuilder builder;
+
+  g_return_val_if_fail (VALENT_IS_DEVICE (device), NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(ttt)}"));
+
+  g_mutex_lock (&capability_lock);
+  for (unsigned int i = 0; i < device->packet_stats->len; i++)
+    {
+      PacketStats *stats = &g_array_index (device->packet_stats, PacketStats, i);
+
+      if (stats->packets == 0)
+        continue;
+
+      g_variant_builder_add (&builder, "{s(ttt)}",
+                             g_ptr_array_index (capability_names, i),
+                             stats->packets,
+                             stats->bytes,
+                             stats->handler_time);
+    }
+  g_mutex_unlock (&capability_lock);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/*< private >
+ * valent_device_dup_queue_statistics:
+ * @device: a `ValentDevice`
+ *
+ * Get the incoming packet queue statistics for @device.
+ *
+ * The result is a dictionary with the number of times a reader was
+ * `deferred` because the queue was full, and the number of packets `dropped`
+ * because their channel closed before they were handled.
+ *
+ * Returns: (transfer full): a `GVariant` of type `a{st}`
+ */
+GVariant *
+valent_device_dup_queue_statistics (ValentDevice *device)
+{
+  GVariantBuilder builder;
+
+  g_return_val_if_fail (VALENT_IS_DEVICE (device), NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+  g_variant_builder_add (&builder, "{st}", "deferred", device->queue_deferred);
+  g_variant_builder_add (&builder, "{st}", "dropped", device->queue_dropped);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/*< private >
+ * valent_device_set_threaded_io:
+ * @device: a `ValentDevice`
+ * @threaded: whether to read channels in a thread
+ *
+ * Set whether channels added after this call are read and decoded by a
+ * dedicated worker thread, instead of on the main context.
+ *
+ * The default is %FALSE, unless the `VALENT_THREADED_IO` environment variable
+ * is set to `1`.
+ */
+void
+valent_device_set_threaded_io (ValentDevice *device,
+                               gboolean      threaded)
+{
+  g_return_if_fail (VALENT_IS_DEVICE (device));
+
+  device->threaded_io = !!threaded;
+}
+
+/*< private >
+ * valent_device_peek_menu:
+ * @device: a `ValentDevice`
+ *
+ * Get the [class@Gio.MenuModel] of the device, without instantiating plugins.
+ *
+ * This is used to export the menu, which is populated as plugins are
+ * instantiated by a channel or a query of the action group.
+ *
+ * Returns: (transfer none): a `GMenuModel`
+ */
+GMenuModel *
+valent_device_peek_menu (ValentDevice *device)
+{
+  g_return_val_if_fail (VALENT_IS_DEVICE (device), NULL);
+
+  return G_MENU_MODEL (device->menu);
+}
@@ -67,6 +67,13 @@ void                valent_device_send_packet          (ValentDevice         *de
                                                         GAsyncReadyCallback   callback,
                                                         gpointer              user_data);
 VALENT_AVAILABLE_IN_1_0
+void                valent_device_send_packet_full     (ValentDevice         *device,
+                                                        JsonNode             *packet,
+                                                        int                   io_priority,
+                                                        GCancellable         *cancellable,
+                                                        GAsyncReadyCallback   callback,
+                                                        gpointer              user_data);
+VALENT_AVAILABLE_IN_1_0
 gboolean            valent_device_send_packet_finish   (ValentDevice         *device,
                                                         GAsyncResult         *result,
                                                         GError              **error);
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Andy Holmes <andrew.g.r.holmes@gmail.com>
+
+#pragma once
+
+#include "valent-packet.h"
+
+G_BEGIN_DECLS
+
+/*< private >
+ * ValentPacketDecoder:
+ *
+ * An incremental decoder for newline-delimited KDE Connect packets.
+ */
+typedef struct _ValentPacketDecoder ValentPacketDecoder;
+
+_VALENT_EXTERN
+ValentPacketDecoder * valent_packet_decoder_new     (size_t               max_len);
+_VALENT_EXTERN
+ValentPacketDecoder * valent_packet_decoder_ref     (ValentPacketDecoder *decoder);
+_VALENT_EXTERN
+void                  valent_packet_decoder_unref   (ValentPacketDecoder *decoder);
+_VALENT_EXTERN
+uint8_t             * valent_packet_decoder_prepare (ValentPacketDecoder *decoder,
+                                                     size_t               size);
+_VALENT_EXTERN
+void                  valent_packet_decoder_commit  (ValentPacketDecoder *decoder,
+                                                     size_t               size);
+_VALENT_EXTERN
+void                  valent_packet_decoder_unread  (ValentPacketDecoder *decoder,
+                                                     const uint8_t       *data,
+                                                     size_t               size);
+_VALENT_EXTERN
+GBytes              * valent_packet_decoder_next    (ValentPacketDecoder  *decoder,
+                                                     GError              **error);
+_VALENT_EXTERN
+JsonNode            * valent_packet_decode          (GBytes               *bytes,
+                                                     GError              **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ValentPacketDecoder, valent_packet_decoder_unref)
+
+/*< private >
+ * ValentPacketEncoder:
+ *
+ * A reusable serializer for outgoing KDE Connect packets.
+ */
+typedef struct _ValentPacketEncoder ValentPacketEncoder;
+
+_VALENT_EXTERN
+ValentPacketEncoder * valent_packet_encoder_new     (void);
+_VALENT_EXTERN
+ValentPacketEncoder * valent_packet_encoder_ref     (ValentPacketEncoder *encoder);
+_VALENT_EXTERN
+void                  valent_packet_encoder_unref   (ValentPacketEncoder *encoder);
+_VALENT_EXTERN
+GBytes              * valent_packet_encoder_encode  (ValentPacketEncoder *encoder,
+                                                     JsonNode            *packet,
+                                                     int64_t              id);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ValentPacketEncoder, valent_packet_encoder_unref)
+
+G_END_DECLS
@@ -11,6 +11,8 @@
 #include "../core/valent-global.h"
 #include "valent-packet.h"
 
+#define PACKET_CHUNK_SIZE (4096)
+
 
 G_DEFINE_QUARK (valent-packet-error, valent_packet_error)
 
@@ -877,70 +879,230 @@ valent_packet_validate (JsonNode  *packet,
   return TRUE;
 }
 
-static void
-valent_packet_from_stream_task (GTask        *task,
-                                gpointer      source_object,
-                                gpointer      task_data,
-                                GCancellable *cancellable)
+/*< private >
+ * valent_packet_read_line_buffered:
+ * @stream: a `GBufferedInputStream`
+ * @max_len: the maximum line length
+ * @line_len: (out): a location for the line length
+ * @cancellable: (nullable): a `GCancellable`
+ * @error: (nullable): a `GError`
+ *
+ * Read a line from a buffered stream, filling and scanning the internal
+ * buffer. Only the bytes up to and including the line-feed are consumed, so any
+ * data that follows remains in @stream.
+ *
+ * Returns: (transfer full) (nullable): a line of data, or %NULL with @error set
+ */
+static char *
+valent_packet_read_line_buffered (GBufferedInputStream  *stream,
+                                  gssize                 max_len,
+                                  size_t                *line_len,
+                                  GCancellable          *cancellable,
+                                  GError               **error)
 {
-  GInputStream *stream = G_INPUT_STREAM (source_object);
-  gssize max_len = (gssize)(intptr_t)task_data;
-  g_autoptr (JsonParser) parser = NULL;
-  g_autoptr (JsonNode) packet = NULL;
   g_autofree char *line = NULL;
-  gssize count = 0;
-  gssize size = 4096;
-  GError *error = NULL;
+  const char *buffer;
+  const char *eol = NULL;
+  size_t available = 0;
+  size_t checked = 0;
 
-  g_assert (G_IS_INPUT_STREAM (stream));
+  while (TRUE)
+    {
+      gssize n_filled;
 
-#ifndef __clang_analyzer__
-  if (max_len < 0)
-    max_len = G_MAXSSIZE;
+      buffer = g_buffered_input_stream_peek_buffer (stream, &available);
+      eol = memchr (buffer + checked, '\n', available - checked);
+      if (eol != NULL)
+        {
+          available = (eol - buffer) + 1;
+          break;
+        }
+
+      checked = available;
+      if G_UNLIKELY (available >= (size_t)max_len)
+        break;
+
+      if (available == g_buffered_input_stream_get_buffer_size (stream))
+        {
+          g_buffered_input_stream_set_buffer_size (stream,
+                                                   MIN (available * 2, (size_t)max_len));
+        }
 
-  line = g_malloc0 (size);
+      n_filled = g_buffered_input_stream_fill (stream, -1, cancellable, error);
+      if (n_filled < 0)
+        return NULL;
+
+      if (n_filled == 0)
+        break;
+    }
+
+  if G_UNLIKELY (available > (size_t)max_len ||
+                 (eol == NULL && available == (size_t)max_len))
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_MESSAGE_TOO_LARGE,
+                           "Packet too large");
+      return NULL;
+    }
+
+  line = g_malloc (available + 1);
+  if (!g_input_stream_read_all (G_INPUT_STREAM (stream),
+                                line,
+                                available,
+                                NULL,
+                                cancellable,
+                                error))
+    return NULL;
+
+  line[available] = '\0';
+  *line_len = available;
+
+  return g_steal_pointer (&line);
+}
+
+/*< private >
+ * valent_packet_read_line:
+ * @stream: a `GInputStream`
+ * @max_len: the maximum line length
+ * @chunk_size: the number of bytes to request for each read
+ * @line_len: (out): a location for the line length
+ * @unread: (out) (nullable): a location for the data following the line-feed
+ * @cancellable: (nullable): a `GCancellable`
+ * @error: (nullable): a `GError`
+ *
+ * Read a line from @stream, requesting up to @chunk_size bytes at a time.
+ *
+ * Any bytes read past the line-feed are returned in @unread, which will be set
+ * to %NULL if the line-feed was the last byte read. If @stream is buffered, the
+ * data is scanned in place and @unread will always be %NULL.
+ *
+ * Returns: (transfer full) (nullable): a line of data, or %NULL with @error set
+ */
+static char *
+valent_packet_read_line (GInputStream  *stream,
+                         gssize         max_len,
+                         size_t         chunk_size,
+                         size_t        *line_len,
+                         GBytes       **unread,
+                         GCancellable  *cancellable,
+                         GError       **error)
+{
+  g_autofree char *line = NULL;
+  size_t count = 0;
+  size_t size = 4096;
+
+  if (G_IS_BUFFERED_INPUT_STREAM (stream))
+    {
+      return valent_packet_read_line_buffered (G_BUFFERED_INPUT_STREAM (stream),
+                                               max_len,
+                                               line_len,
+                                               cancellable,
+                                               error);
+    }
+
+  line = g_malloc (size + 1);
 
   while (TRUE)
     {
-      gssize read = 0;
+      const char *eol = NULL;
+      gssize n_read = 0;
 
-      if G_UNLIKELY (count == max_len)
+      if G_UNLIKELY (count == (size_t)max_len)
         {
-          g_task_return_new_error (task,
-                                   G_IO_ERROR,
-                                   G_IO_ERROR_MESSAGE_TOO_LARGE,
-                                   "Packet too large");
-          return;
+          g_set_error_literal (error,
+                               G_IO_ERROR,
+                               G_IO_ERROR_MESSAGE_TOO_LARGE,
+                               "Packet too large");
+          return NULL;
         }
 
       if G_UNLIKELY (count == size)
         {
-          size = MIN (size * 2, max_len);
-          line = g_realloc (line, size);
+          size = MIN (size * 2, (size_t)max_len);
+          line = g_realloc (line, size + 1);
         }
 
-      read = g_input_stream_read (stream,
-                                  line + count,
-                                  1,
-                                  cancellable,
-                                  &error);
-      if (error != NULL)
+      n_read = g_input_stream_read (stream,
+                                    line + count,
+                                    MIN (chunk_size, MIN (size, (size_t)max_len) - count),
+                                    cancellable,
+                                    error);
+      if (n_read < 0)
+        return NULL;
+
+      if (n_read == 0)
+        break;
+
+      eol = memchr (line + count, '\n', n_read);
+      count += n_read;
+
+      if (eol != NULL)
         {
-          g_task_return_error (task, g_steal_pointer (&error));
-          return;
+          size_t len = (eol - line) + 1;
+
+          if (count > len && unread != NULL)
+            *unread = g_bytes_new (line + len, count - len);
+
+          count = len;
+          break;
         }
+    }
 
-      if (read > 0)
-        count += read;
-      else if (read == 0)
-        break;
+  line[count] = '\0';
+  *line_len = count;
 
-      if G_UNLIKELY (line[count - 1] == '\n')
-        break;
+  return g_steal_pointer (&line);
+}
+
+typedef struct
+{
+  gssize  max_len;
+  size_t  chunk_size;
+  GBytes *unread;
+} PacketReadData;
+
+static void
+packet_read_data_free (gpointer user_data)
+{
+  PacketReadData *data = (PacketReadData *)user_data;
+
+  g_clear_pointer (&data->unread, g_bytes_unref);
+  g_free (data);
+}
+
+static void
+valent_packet_from_stream_task (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
+{
+  GInputStream *stream = G_INPUT_STREAM (source_object);
+  PacketReadData *data = (PacketReadData *)task_data;
+  g_autoptr (JsonParser) parser = NULL;
+  g_autoptr (JsonNode) packet = NULL;
+  g_autofree char *line = NULL;
+  size_t line_len = 0;
+  GError *error = NULL;
+
+  g_assert (G_IS_INPUT_STREAM (stream));
+
+#ifndef __clang_analyzer__
+  line = valent_packet_read_line (stream,
+                                  data->max_len,
+                                  data->chunk_size,
+                                  &line_len,
+                                  &data->unread,
+                                  cancellable,
+                                  &error);
+  if (line == NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
     }
 
   parser = json_parser_new_immutable ();
-  if (!json_parser_load_from_data (parser, line, count, &error))
+  if (!json_parser_load_from_data (parser, line, line_len, &error))
     {
       g_task_return_error (task, g_steal_pointer (&error));
       return;
@@ -976,6 +1138,10 @@ valent_packet_from_stream_task (GTask        *task,
  * If @max_len bytes are read without encountering a line-feed character, %NULL
  * will be returned with @error set to %G_IO_ERROR_MESSAGE_TOO_LARGE.
  *
+ * This function never reads past the line-feed, so if @stream is not a
+ * [class@Gio.BufferedInputStream] it will be read one byte at a time. Callers
+ * that can handle trailing data should use [func@Valent.packet_from_stream_full].
+ *
  * Call [func@Valent.packet_from_stream_finish] to get the result.
  *
  * Since: 1.0
@@ -987,16 +1153,15 @@ valent_packet_from_stream (GInputStream        *stream,
                            GAsyncReadyCallback  callback,
                            gpointer             user_data)
 {
-  g_autoptr (GTask) task = NULL;
-  gssize _max_len = max_len;
-
   g_return_if_fail (G_IS_INPUT_STREAM (stream));
   g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-  task = g_task_new (stream, cancellable, callback, user_data);
-  g_task_set_source_tag (task, valent_packet_from_stream);
-  g_task_set_task_data (task, (void *)(intptr_t)_max_len, NULL);
-  g_task_run_in_thread (task, valent_packet_from_stream_task);
+  valent_packet_from_stream_full (stream,
+                                  max_len,
+                                  1,
+                                  cancellable,
+                                  callback,
+                                  user_data);
 }
 
 /**
@@ -1020,7 +1185,91 @@ valent_packet_from_stream_finish (GInputStream  *stream,
   g_return_val_if_fail (g_task_is_valid (result, stream), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  return g_task_propagate_pointer (G_TASK (result), error);
+  return valent_packet_from_stream_full_finish (stream, result, NULL, error);
+}
+
+/**
+ * valent_packet_from_stream_full:
+ * @stream: a `GInputStream`
+ * @max_len: the maximum number bytes to read, or `-1` for no limit
+ * @chunk_size: the number of bytes to read at a time, or `0` for the default
+ * @cancellable: (nullable): a `GCancellable`
+ * @callback: (scope async): a `GAsyncReadyCallback`
+ * @user_data: user supplied data
+ *
+ * Read a KDE Connect packet from an input stream, in chunks of @chunk_size.
+ *
+ * This function behaves like [func@Valent.packet_from_stream], except that
+ * unbuffered streams are read up to @chunk_size bytes at a time. Any data read
+ * past the line-feed is returned by [func@Valent.packet_from_stream_full_finish],
+ * so it can be passed on to the next reader (e.g. [method@Valent.Channel.push_input]).
+ *
+ * Call [func@Valent.packet_from_stream_full_finish] to get the result.
+ *
+ * Since: 1.0
+ */
+void
+valent_packet_from_stream_full (GInputStream        *stream,
+                                gssize               max_len,
+                                size_t               chunk_size,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  PacketReadData *data = NULL;
+
+  g_return_if_fail (G_IS_INPUT_STREAM (stream));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  data = g_new0 (PacketReadData, 1);
+  data->max_len = (max_len < 0) ? G_MAXSSIZE : max_len;
+  data->chunk_size = (chunk_size > 0) ? chunk_size : PACKET_CHUNK_SIZE;
+
+  task = g_task_new (stream, cancellable, callback, user_data);
+  g_task_set_source_tag (task, valent_packet_from_stream_full);
+  g_task_set_task_data (task, data, packet_read_data_free);
+  g_task_run_in_thread (task, valent_packet_from_stream_task);
+}
+
+/**
+ * valent_packet_from_stream_full_finish:
+ * @stream: a `GInputStream`
+ * @result: a `GAsyncResult`
+ * @unread: (out) (optional) (nullable) (transfer full): a location for the
+ *   data that was read following the packet
+ * @error: (nullable): a `GError`
+ *
+ * Finish an operation started by [func@Valent.packet_from_stream_full].
+ *
+ * If @unread is not %NULL, it will be set to any data read after the packet,
+ * or %NULL if there was none. If @unread is %NULL, that data is discarded.
+ *
+ * Returns: (transfer full): a KDE Connect packet, or %NULL with @error set
+ *
+ * Since: 1.0
+ */
+JsonNode *
+valent_packet_from_stream_full_finish (GInputStream  *stream,
+                                       GAsyncResult  *result,
+                                       GBytes       **unread,
+                                       GError       **error)
+{
+  PacketReadData *data = NULL;
+  JsonNode *ret = NULL;
+
+  g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, stream), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  ret = g_task_propagate_pointer (G_TASK (result), error);
+  if (unread != NULL)
+    {
+      data = g_task_get_task_data (G_TASK (result));
+      *unread = (ret != NULL) ? g_steal_pointer (&data->unread) : NULL;
+    }
+
+  return ret;
 }
 
 static void
@@ -1209,3 +1458,778 @@ valent_packet_deserialize (const char  *json,
   return g_steal_pointer (&packet);
 }
 
+
+
+/*
+ * ValentPacketDecoder
+ *
+ * An incremental decoder that scans the structure of newline-delimited packets
+ * as data arrives. Each byte is scanned once, and the well-known top-level
+ * fields are checked as soon as their value begins, so malformed or oversized
+ * packets are rejected without waiting for the line-feed.
+ *
+ * Complete packets are returned as a `GBytes`, which can be parsed by
+ * valent_packet_decode() in any thread. Large packets take ownership of the
+ * buffer they were read into, rather than being copied.
+ */
+#define DECODER_STEAL_SIZE (64 * 1024)
+
+typedef enum
+{
+  PACKET_FIELD_NONE,
+  PACKET_FIELD_TYPE =                (1 << 0),
+  PACKET_FIELD_BODY =                (1 << 1),
+  PACKET_FIELD_PAYLOAD_SIZE =        (1 << 2),
+  PACKET_FIELD_PAYLOAD_TRANSFER =    (1 << 3),
+} PacketField;
+
+struct _ValentPacketDecoder
+{
+  uint8_t      *data;
+  size_t        size;
+  size_t        start;
+  size_t        end;
+  size_t        max_len;
+
+  /* Scanner */
+  size_t        offset;
+  size_t        key_start;
+  unsigned int  depth;
+  PacketField   field;
+  PacketField   fields;
+  unsigned int  started : 1;
+  unsigned int  closed : 1;
+  unsigned int  in_string : 1;
+  unsigned int  in_key : 1;
+  unsigned int  escape : 1;
+  unsigned int  expect_key : 1;
+  unsigned int  expect_value : 1;
+};
+
+static inline void
+valent_packet_decoder_reset (ValentPacketDecoder *decoder)
+{
+  decoder->key_start = 0;
+  decoder->depth = 0;
+  decoder->field = PACKET_FIELD_NONE;
+  decoder->fields = PACKET_FIELD_NONE;
+  decoder->started = FALSE;
+  decoder->closed = FALSE;
+  decoder->in_string = FALSE;
+  decoder->in_key = FALSE;
+  decoder->escape = FALSE;
+  decoder->expect_key = FALSE;
+  decoder->expect_value = FALSE;
+}
+
+static void
+valent_packet_decoder_free (gpointer data)
+{
+  ValentPacketDecoder *decoder = (ValentPacketDecoder *)data;
+
+  g_clear_pointer (&decoder->data, g_free);
+}
+
+/*< private >
+ * valent_packet_decoder_new:
+ * @max_len: the maximum packet size
+ *
+ * Create a new packet decoder.
+ *
+ * Returns: (transfer full): a `ValentPacketDecoder`
+ */
+ValentPacketDecoder *
+valent_packet_decoder_new (size_t max_len)
+{
+  ValentPacketDecoder *decoder;
+
+  decoder = g_atomic_rc_box_new0 (ValentPacketDecoder);
+  decoder->max_len = (max_len > 0) ? max_len : G_MAXSIZE;
+
+  return decoder;
+}
+
+/*< private >
+ * valent_packet_decoder_ref:
+ * @decoder: a `ValentPacketDecoder`
+ *
+ * Acquire a reference on @decoder.
+ *
+ * Returns: (transfer full): a `ValentPacketDecoder`
+ */
+ValentPacketDecoder *
+valent_packet_decoder_ref (ValentPacketDecoder *decoder)
+{
+  g_return_val_if_fail (decoder != NULL, NULL);
+
+  return g_atomic_rc_box_acquire (decoder);
+}
+
+/*< private >
+ * valent_packet_decoder_unref:
+ * @decoder: a `ValentPacketDecoder`
+ *
+ * Release a reference on @decoder.
+ */
+void
+valent_packet_decoder_unref (ValentPacketDecoder *decoder)
+{
+  g_return_if_fail (decoder != NULL);
+
+  g_atomic_rc_box_release_full (decoder, valent_packet_decoder_free);
+}
+
+/*< private >
+ * valent_packet_decoder_prepare:
+ * @decoder: a `ValentPacketDecoder`
+ * @size: the number of bytes to reserve
+ *
+ * Reserve @size bytes at the end of the buffer, for reading directly from a
+ * stream. Call valent_packet_decoder_commit() with the number of bytes written.
+ *
+ * Returns: (transfer none): a pointer to at least @size bytes
+ */
+uint8_t *
+valent_packet_decoder_prepare (ValentPacketDecoder *decoder,
+                               size_t               size)
+{
+  g_return_val_if_fail (decoder != NULL, NULL);
+
+  /* Reclaim the space used by packets that have already been returned
+   */
+  if (decoder->start > 0)
+    {
+      size_t len = decoder->end - decoder->start;
+
+      if (len > 0)
+        memmove (decoder->data, decoder->data + decoder->start, len);
+
+      decoder->offset -= decoder->start;
+      decoder->key_start -= MIN (decoder->key_start, decoder->start);
+      decoder->end = len;
+      decoder->start = 0;
+    }
+
+  if (decoder->size - decoder->end < size)
+    {
+      decoder->size = MAX (decoder->size * 2, decoder->end + size);
+      decoder->data = g_realloc (decoder->data, decoder->size);
+    }
+
+  return decoder->data + decoder->end;
+}
+
+/*< private >
+ * valent_packet_decoder_commit:
+ * @decoder: a `ValentPacketDecoder`
+ * @size: the number of bytes written
+ *
+ * Commit @size bytes written to the buffer returned by
+ * valent_packet_decoder_prepare().
+ */
+void
+valent_packet_decoder_commit (ValentPacketDecoder *decoder,
+                              size_t               size)
+{
+  g_return_if_fail (decoder != NULL);
+  g_return_if_fail (decoder->end + size <= decoder->size);
+
+  decoder->end += size;
+}
+
+/*< private >
+ * valent_packet_decoder_unread:
+ * @decoder: a `ValentPacketDecoder`
+ * @data: (array length=size): data to prepend
+ * @size: the size of @data
+ *
+ * Prepend @data to the buffer, to be decoded before any data already buffered.
+ */
+void
+valent_packet_decoder_unread (ValentPacketDecoder *decoder,
+                              const uint8_t       *data,
+                              size_t               size)
+{
+  size_t len;
+
+  g_return_if_fail (decoder != NULL);
+  g_return_if_fail (data != NULL || size == 0);
+
+  if (size == 0)
+    return;
+
+  valent_packet_decoder_prepare (decoder, size);
+  len = decoder->end;
+  memmove (decoder->data + size, decoder->data, len);
+  memcpy (decoder->data, data, size);
+  decoder->end += size;
+
+  /* Scan the buffer again from the beginning */
+  decoder->offset = 0;
+  valent_packet_decoder_reset (decoder);
+}
+
+static inline PacketField
+packet_field_from_key (const uint8_t *key,
+                       size_t         len)
+{
+#define KEY_EQUAL(str) (len == sizeof (str) - 1 && memcmp (key, str, len) == 0)
+  if (KEY_EQUAL ("type"))
+    return PACKET_FIELD_TYPE;
+  if (KEY_EQUAL ("body"))
+    return PACKET_FIELD_BODY;
+  if (KEY_EQUAL ("payloadSize"))
+    return PACKET_FIELD_PAYLOAD_SIZE;
+  if (KEY_EQUAL ("payloadTransferInfo"))
+    return PACKET_FIELD_PAYLOAD_TRANSFER;
+#undef KEY_EQUAL
+
+  return PACKET_FIELD_NONE;
+}
+
+static inline gboolean
+packet_field_check_value (PacketField  field,
+                          uint8_t      c,
+                          GError     **error)
+{
+  switch (field)
+    {
+    case PACKET_FIELD_TYPE:
+      if (c == '"')
+        return TRUE;
+
+      g_set_error_literal (error,
+                           VALENT_PACKET_ERROR,
+                           VALENT_PACKET_ERROR_INVALID_FIELD,
+                           "expected \"type\" field holding a string");
+      return FALSE;
+
+    case PACKET_FIELD_BODY:
+      if (c == '{')
+        return TRUE;
+
+      g_set_error_literal (error,
+                           VALENT_PACKET_ERROR,
+                           VALENT_PACKET_ERROR_INVALID_FIELD,
+                           "expected \"body\" field holding an object");
+      return FALSE;
+
+    case PACKET_FIELD_PAYLOAD_SIZE:
+      if (c == '-' || g_ascii_isdigit (c))
+        return TRUE;
+
+      g_set_error_literal (error,
+                           VALENT_PACKET_ERROR,
+                           VALENT_PACKET_ERROR_INVALID_FIELD,
+                           "expected \"payloadSize\" field to hold an integer");
+      return FALSE;
+
+    case PACKET_FIELD_PAYLOAD_TRANSFER:
+      if (c == '{')
+        return TRUE;
+
+      g_set_error_literal (error,
+                           VALENT_PACKET_ERROR,
+                           VALENT_PACKET_ERROR_INVALID_FIELD,
+                           "expected \"payloadTransferInfo\" field to hold an object");
+      return FALSE;
+
+    case PACKET_FIELD_NONE:
+    default:
+      return TRUE;
+    }
+}
+
+/*< private >
+ * valent_packet_decoder_next:
+ * @decoder: a `ValentPacketDecoder`
+ * @error: (nullable): a `GError`
+ *
+ * Scan the buffered data for the next complete packet.
+ *
+ * If a complete packet is available, it is returned without the trailing
+ * line-feed. If more data is required, %NULL is returned without setting
+ * @error. If the packet is malformed or larger than the maximum size, %NULL is
+ * returned with @error set, and the decoder should be discarded.
+ *
+ * Returns: (transfer full) (nullable): the serialized packet
+ */
+GBytes *
+valent_packet_decoder_next (ValentPacketDecoder  *decoder,
+                            GError              **error)
+{
+  g_return_val_if_fail (decoder != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  for (; decoder->offset < decoder->end; decoder->offset++)
+    {
+      uint8_t c = decoder->data[decoder->offset];
+
+      if G_UNLIKELY (decoder->offset - decoder->start >= decoder->max_len)
+        {
+          g_set_error_literal (error,
+                               G_IO_ERROR,
+                               G_IO_ERROR_MESSAGE_TOO_LARGE,
+                               "Packet too large");
+          return NULL;
+        }
+
+      if (decoder->in_string)
+        {
+          if (decoder->escape)
+            {
+              decoder->escape = FALSE;
+            }
+          else if (c == '\\')
+            {
+              decoder->escape = TRUE;
+            }
+          else if (c == '"')
+            {
+              decoder->in_string = FALSE;
+              if (decoder->in_key)
+                {
+                  decoder->in_key = FALSE;
+                  decoder->field = packet_field_from_key (decoder->data + decoder->key_start,
+                                                          decoder->offset - decoder->key_start);
+                  decoder->fields |= decoder->field;
+                }
+            }
+          else if G_UNLIKELY (c < 0x20)
+            {
+              g_set_error_literal (error,
+                                   VALENT_PACKET_ERROR,
+                                   VALENT_PACKET_ERROR_MALFORMED,
+                                   "unexpected control character in string");
+              return NULL;
+            }
+
+          continue;
+        }
+
+      if (c == '\n')
+        {
+          GBytes *ret = NULL;
+          size_t start = decoder->start;
+
+          /* Skip empty lines */
+          decoder->start = decoder->offset + 1;
+          if (!decoder->started)
+            continue;
+
+          if G_UNLIKELY (!decoder->closed)
+            {
+              g_set_error_literal (error,
+                                   VALENT_PACKET_ERROR,
+                                   VALENT_PACKET_ERROR_MALFORMED,
+                                   "unexpected end of packet");
+              return NULL;
+            }
+
+          if G_UNLIKELY ((decoder->fields & PACKET_FIELD_TYPE) == 0)
+            {
+              g_set_error_literal (error,
+                                   VALENT_PACKET_ERROR,
+                                   VALENT_PACKET_ERROR_MISSING_FIELD,
+                                   "expected \"type\" field holding a string");
+              return NULL;
+            }
+
+          if G_UNLIKELY ((decoder->fields & PACKET_FIELD_BODY) == 0)
+            {
+              g_set_error_literal (error,
+                                   VALENT_PACKET_ERROR,
+                                   VALENT_PACKET_ERROR_MISSING_FIELD,
+                                   "expected \"body\" field holding an object");
+              return NULL;
+            }
+
+          /* Small packets are copied, while larger packets take ownership of
+           * the buffer and any remaining data is moved to a new buffer.
+           */
+          if (decoder->offset - start < DECODER_STEAL_SIZE)
+            {
+              ret = g_bytes_new (decoder->data + start, decoder->offset - start);
+            }
+          else
+            {
+              uint8_t *data = g_steal_pointer (&decoder->data);
+              size_t len = decoder->end - decoder->start;
+
+              ret = g_bytes_new_with_free_func (data + start,
+                                                decoder->offset - start,
+                                                g_free,
+                                                data);
+
+              decoder->size = MAX (len, DECODER_STEAL_SIZE);
+              decoder->data = g_malloc (decoder->size);
+              if (len > 0)
+                memcpy (decoder->data, data + decoder->start, len);
+
+              decoder->start = 0;
+              decoder->end = len;
+            }
+
+          decoder->offset = decoder->start;
+          valent_packet_decoder_reset (decoder);
+
+          return ret;
+        }
+
+      if (c == ' ' || c == '\t' || c == '\r')
+        continue;
+
+      if G_UNLIKELY (decoder->closed)
+        {
+          g_set_error_literal (error,
+                               VALENT_PACKET_ERROR,
+                               VALENT_PACKET_ERROR_MALFORMED,
+                               "unexpected data following packet");
+          return NULL;
+        }
+
+      if G_UNLIKELY (!decoder->started)
+        {
+          if (c != '{')
+            {
+              g_set_error_literal (error,
+                                   VALENT_PACKET_ERROR,
+                                   VALENT_PACKET_ERROR_MALFORMED,
+                                   "expected the root element to be an object");
+              return NULL;
+            }
+
+          decoder->started = TRUE;
+          decoder->expect_key = TRUE;
+          decoder->depth = 1;
+          continue;
+        }
+
+      if (decoder->expect_value)
+        {
+          decoder->expect_value = FALSE;
+          if (!packet_field_check_value (decoder->field, c, error))
+            return NULL;
+
+          decoder->field = PACKET_FIELD_NONE;
+        }
+
+      switch (c)
+        {
+        case '"':
+          decoder->in_string = TRUE;
+          if (decoder->depth == 1 && decoder->expect_key)
+            {
+              decoder->in_key = TRUE;
+              decoder->expect_key = FALSE;
+              decoder->key_start = decoder->offset + 1;
+            }
+          break;
+
+        case '{':
+        case '[':
+          decoder->depth += 1;
+          break;
+
+        case '}':
+        case ']':
+          decoder->depth -= 1;
+          if (decoder->depth == 0)
+            decoder->closed = TRUE;
+          break;
+
+        case ',':
+          if (decoder->depth == 1)
+            decoder->expect_key = TRUE;
+          break;
+
+        case ':':
+          if (decoder->depth == 1)
+            decoder->expect_value = (decoder->field != PACKET_FIELD_NONE);
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  return NULL;
+}
+
+/*< private >
+ * valent_packet_decode:
+ * @bytes: a serialized KDE Connect packet
+ * @error: (nullable): a `GError`
+ *
+ * Parse and validate a packet returned by valent_packet_decoder_next().
+ *
+ * This function is thread-safe, so large packets may be decoded in a thread.
+ *
+ * Returns: (transfer full) (nullable): a KDE Connect packet
+ */
+JsonNode *
+valent_packet_decode (GBytes  *bytes,
+                      GError **error)
+{
+  g_autoptr (JsonParser) parser = NULL;
+  g_autoptr (JsonNode) packet = NULL;
+  const char *data;
+  size_t size;
+
+  g_return_val_if_fail (bytes != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  data = g_bytes_get_data (bytes, &size);
+  if (!g_utf8_validate_len (data, size, NULL))
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_DATA,
+                           "Invalid UTF-8");
+      return NULL;
+    }
+
+  parser = json_parser_new_immutable ();
+  if (!json_parser_load_from_data (parser, data, size, error))
+    return NULL;
+
+  packet = json_parser_steal_root (parser);
+  if (!valent_packet_validate (packet, error))
+    return NULL;
+
+  return g_steal_pointer (&packet);
+}
+
+
+/*
+ * ValentPacketEncoder
+ *
+ * A reusable serializer for outgoing packets. The `id` field is written from
+ * the timestamp passed by the caller, so the packet itself is not modified.
+ *
+ * Packets are serialized into pooled buffers, which are returned to the
+ * encoder when the last reference to the `GBytes` is dropped. New buffers are
+ * reserved from an average of recent packet sizes, so that most packets are
+ * serialized without reallocating.
+ */
+#define ENCODER_POOL_MAX  (8)
+#define ENCODER_POOL_SIZE (64 * 1024)
+#define ENCODER_SIZE_HINT (512)
+
+struct _ValentPacketEncoder
+{
+  GMutex         lock;
+  JsonGenerator *generator;
+  GPtrArray     *pool;
+  size_t         size_hint;
+};
+
+typedef struct
+{
+  ValentPacketEncoder *encoder;
+  GString             *str;
+} PacketBuffer;
+
+static void
+packet_buffer_free (gpointer data)
+{
+  PacketBuffer *buffer = (PacketBuffer *)data;
+
+  g_string_free (buffer->str, TRUE);
+  g_free (buffer);
+}
+
+static void
+valent_packet_encoder_release (gpointer data)
+{
+  PacketBuffer *buffer = (PacketBuffer *)data;
+  ValentPacketEncoder *encoder = g_steal_pointer (&buffer->encoder);
+
+  g_mutex_lock (&encoder->lock);
+  if (encoder->pool->len < ENCODER_POOL_MAX &&
+      buffer->str->allocated_len <= ENCODER_POOL_SIZE)
+    {
+      g_string_truncate (buffer->str, 0);
+      g_ptr_array_add (encoder->pool, g_steal_pointer (&buffer));
+    }
+  g_mutex_unlock (&encoder->lock);
+
+  g_clear_pointer (&buffer, packet_buffer_free);
+  valent_packet_encoder_unref (encoder);
+}
+
+static inline void
+valent_packet_encoder_append_string (GString    *str,
+                                     const char *value)
+{
+  g_string_append_c (str, '"');
+  for (const char *c = value; *c != '\0'; c++)
+    {
+      switch (*c)
+        {
+        case '"':
+          g_string_append (str, "\\\"");
+          break;
+
+        case '\\':
+          g_string_append (str, "\\\\");
+          break;
+
+        case '\n':
+          g_string_append (str, "\\n");
+          break;
+
+        case '\r':
+          g_string_append (str, "\\r");
+          break;
+
+        case '\t':
+          g_string_append (str, "\\t");
+          break;
+
+        default:
+          if ((unsigned char)*c < 0x20)
+            g_string_append_printf (str, "\\u%04x", (unsigned int)*c);
+          else
+            g_string_append_c (str, *c);
+          break;
+        }
+    }
+  g_string_append_c (str, '"');
+}
+
+static void
+valent_packet_encoder_free (gpointer data)
+{
+  ValentPacketEncoder *encoder = (ValentPacketEncoder *)data;
+
+  g_clear_object (&encoder->generator);
+  g_clear_pointer (&encoder->pool, g_ptr_array_unref);
+  g_mutex_clear (&encoder->lock);
+}
+
+/*< private >
+ * valent_packet_encoder_new:
+ *
+ * Create a new packet encoder.
+ *
+ * Returns: (transfer full): a `ValentPacketEncoder`
+ */
+ValentPacketEncoder *
+valent_packet_encoder_new (void)
+{
+  ValentPacketEncoder *encoder;
+
+  encoder = g_atomic_rc_box_new0 (ValentPacketEncoder);
+  g_mutex_init (&encoder->lock);
+  encoder->generator = json_generator_new ();
+  encoder->pool = g_ptr_array_new_with_free_func (packet_buffer_free);
+  encoder->size_hint = ENCODER_SIZE_HINT;
+
+  return encoder;
+}
+
+/*< private >
+ * valent_packet_encoder_ref:
+ * @encoder: a `ValentPacketEncoder`
+ *
+ * Acquire a reference on @encoder.
+ *
+ * Returns: (transfer full): a `ValentPacketEncoder`
+ */
+ValentPacketEncoder *
+valent_packet_encoder_ref (ValentPacketEncoder *encoder)
+{
+  g_return_val_if_fail (encoder != NULL, NULL);
+
+  return g_atomic_rc_box_acquire (encoder);
+}
+
+/*< private >
+ * valent_packet_encoder_unref:
+ * @encoder: a `ValentPacketEncoder`
+ *
+ * Release a reference on @encoder.
+ */
+void
+valent_packet_encoder_unref (ValentPacketEncoder *encoder)
+{
+  g_return_if_fail (encoder != NULL);
+
+  g_atomic_rc_box_release_full (encoder, valent_packet_encoder_free);
+}
+
+/*< private >
+ * valent_packet_encoder_encode:
+ * @encoder: a `ValentPacketEncoder`
+ * @packet: a KDE Connect packet
+ * @id: the packet ID, usually a timestamp
+ *
+ * Serialize @packet with a trailing line-feed, using @id for the `id` field.
+ *
+ * The data is owned by @encoder until the returned `GBytes` is released, so it
+ * can be passed directly to an output stream. This function is thread-safe.
+ *
+ * Returns: (transfer full): the serialized packet
+ */
+GBytes *
+valent_packet_encoder_encode (ValentPacketEncoder *encoder,
+                              JsonNode            *packet,
+                              int64_t              id)
+{
+  PacketBuffer *buffer = NULL;
+  GString *str;
+  JsonObjectIter iter;
+  const char *name;
+  JsonNode *node;
+
+  g_return_val_if_fail (encoder != NULL, NULL);
+  g_return_val_if_fail (VALENT_IS_PACKET (packet), NULL);
+
+  g_mutex_lock (&encoder->lock);
+  if (encoder->pool->len > 0)
+    {
+      buffer = g_ptr_array_steal_index_fast (encoder->pool,
+                                             encoder->pool->len - 1);
+    }
+  else
+    {
+      buffer = g_new0 (PacketBuffer, 1);
+      buffer->str = g_string_sized_new (encoder->size_hint);
+    }
+
+  /* Reserve space for a typical packet, without retaining huge buffers
+   */
+  str = buffer->str;
+  if (str->allocated_len <= encoder->size_hint)
+    {
+      g_string_set_size (str, MIN (encoder->size_hint * 2, ENCODER_POOL_SIZE));
+      g_string_truncate (str, 0);
+    }
+
+  g_string_append_printf (str, "{\"id\":%" G_GINT64_FORMAT, id);
+  json_object_iter_init_ordered (&iter, json_node_get_object (packet));
+  while (json_object_iter_next_ordered (&iter, &name, &node))
+    {
+      if (g_str_equal (name, "id"))
+        continue;
+
+      g_string_append_c (str, ',');
+      valent_packet_encoder_append_string (str, name);
+      g_string_append_c (str, ':');
+
+      json_generator_set_root (encoder->generator, node);
+      json_generator_to_gstring (encoder->generator, str);
+    }
+  g_string_append (str, "}\n");
+  json_generator_set_root (encoder->generator, NULL);
+
+  encoder->size_hint = (encoder->size_hint * 7 + str->len) / 8;
+  buffer->encoder = valent_packet_encoder_ref (encoder);
+  g_mutex_unlock (&encoder->lock);
+
+  return g_bytes_new_with_free_func (str->str,
+                                     str->len,
+                                     valent_packet_encoder_release,
+                                     buffer);
+}
@@ -165,6 +165,18 @@ JsonNode   * valent_packet_from_stream_finish (GInputStream         *stream,
                                                GAsyncResult         *result,
                                                GError              **error);
 VALENT_AVAILABLE_IN_1_0
+void         valent_packet_from_stream_full   (GInputStream         *stream,
+                                               gssize                max_len,
+                                               size_t                chunk_size,
+                                               GCancellable         *cancellable,
+                                               GAsyncReadyCallback   callback,
+                                               gpointer              user_data);
+VALENT_AVAILABLE_IN_1_0
+JsonNode   * valent_packet_from_stream_full_finish (GInputStream    *stream,
+                                                    GAsyncResult    *result,
+                                                    GBytes         **unread,
+                                                    GError         **error);
+VALENT_AVAILABLE_IN_1_0
 void         valent_packet_to_stream          (GOutputStream        *stream,
                                                JsonNode             *packet,
                                                GCancellable         *cancellable,
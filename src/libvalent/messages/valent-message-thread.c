@@ -16,8 +16,23 @@
 
 #include "valent-message-thread.h"
 
-#define GET_MESSAGE_RQ          "/ca/andyholmes/Valent/sparql/get-message.rq"
-#define GET_THREAD_MESSAGES_RQ  "/ca/andyholmes/Valent/sparql/get-thread-messages.rq"
+#define GET_MESSAGE_RQ                "/ca/andyholmes/Valent/sparql/get-message.rq"
+#define GET_THREAD_COUNT_RQ           "/ca/andyholmes/Valent/sparql/get-thread-count.rq"
+#define GET_THREAD_MESSAGES_RQ        "/ca/andyholmes/Valent/sparql/get-thread-messages.rq"
+#define GET_THREAD_MESSAGES_BEFORE_RQ "/ca/andyholmes/Valent/sparql/get-thread-messages-before.rq"
+
+/* Messages are loaded in pages of THREAD_PAGE_SIZE, aligned to list positions,
+ * and at most THREAD_PAGE_MAX pages are cached at once. When an item is
+ * requested within THREAD_PAGE_PREFETCH of a page boundary, the neighbouring
+ * page is loaded asynchronously.
+ *
+ * Pages are never loaded synchronously. An item requested from a page that
+ * isn't cached is returned as an empty placeholder without an IRI, which is
+ * replaced by emitting `GListModel::items-changed` once the page has loaded.
+ */
+#define THREAD_PAGE_SIZE     (50)
+#define THREAD_PAGE_MAX      (8)
+#define THREAD_PAGE_PREFETCH (10)
 
 struct _ValentMessageThread
 {
@@ -31,14 +46,21 @@ struct _ValentMessageThread
   TrackerNotifier         *notifier;
   GRegex                  *iri_pattern;
   TrackerSparqlStatement  *get_message_stmt;
+  TrackerSparqlStatement  *get_thread_count_stmt;
   TrackerSparqlStatement  *get_thread_messages_stmt;
+  TrackerSparqlStatement  *get_thread_messages_before_stmt;
   GCancellable            *cancellable;
 
   /* list */
-  GSequence               *items;
-  unsigned int             last_position;
-  GSequenceIter           *last_iter;
-  gboolean                 last_position_valid;
+  unsigned int             n_items;
+  unsigned int             generation;
+  gboolean                 loaded;
+  ValentMessage           *last_item;
+  GHashTable              *pages;
+  GQueue                   pages_lru;
+  GHashTable              *pages_pending;
+  GHashTable              *placeholders;
+  gboolean                 loading;
 };
 
 static void   g_list_model_iface_init (GListModelInterface *iface);
@@ -46,6 +68,10 @@ static void   g_list_model_iface_init (GListModelInterface *iface);
 static void   valent_message_thread_load         (ValentMessageThread *self);
 static void   valent_message_thread_load_message (ValentMessageThread *self,
                                                   const char          *iri);
+static void   valent_message_thread_load_page    (ValentMessageThread *self,
+                                                  unsigned int         page,
+                                                  unsigned int         n_items,
+                                                  gboolean             replace);
 
 G_DEFINE_FINAL_TYPE_WITH_CODE (ValentMessageThread, valent_message_thread, VALENT_TYPE_OBJECT,
                                G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, g_list_model_iface_init))
@@ -59,21 +85,23 @@ typedef enum {
 
 static GParamSpec *properties[PROP_PARTICIPANTS + 1] = { NULL, };
 
+typedef struct
+{
+  unsigned int  page;
+  unsigned int  n_items;
+  unsigned int  generation;
+  gboolean      replace;
+  gboolean      reverse;
+  GPtrArray    *messages;
+} PageRequest;
+
 static void
-valent_message_thread_items_changed (ValentMessageThread *self,
-                                     unsigned int         position,
-                                     unsigned int         removed,
-                                     unsigned int         added)
+page_request_free (gpointer data)
 {
-  /* check if the iter cache may have been invalidated */
-  if (position <= self->last_position)
-    {
-      self->last_iter = NULL;
-      self->last_position = 0;
-      self->last_position_valid = FALSE;
-    }
+  PageRequest *request = (PageRequest *)data;
 
-  g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
+  g_clear_pointer (&request->messages, g_ptr_array_unref);
+  g_free (request);
 }
 
 static inline int
@@ -83,8 +111,291 @@ valent_message_thread_sort_func (gconstpointer a,
 {
   int64_t date1 = valent_message_get_date ((ValentMessage *)a);
   int64_t date2 = valent_message_get_date ((ValentMessage *)b);
+  int64_t id1, id2;
+
+  if (date1 != date2)
+    return (date1 < date2) ? -1 : 1;
+
+  id1 = valent_message_get_id ((ValentMessage *)a);
+  id2 = valent_message_get_id ((ValentMessage *)b);
+
+  return (id1 < id2) ? -1 : (id1 > id2);
+}
+
+static inline void
+messages_reverse (GPtrArray *messages)
+{
+  for (unsigned int i = 0, j = messages->len - 1; messages->len > 0 && i < j; i++, j--)
+    {
+      gpointer tmp = messages->pdata[i];
+
+      messages->pdata[i] = messages->pdata[j];
+      messages->pdata[j] = tmp;
+    }
+}
+
+/*
+ * Page Cache
+ */
+static GPtrArray *
+valent_message_thread_lookup_page (ValentMessageThread *self,
+                                   unsigned int         page)
+{
+  gpointer key = GUINT_TO_POINTER (page);
+  GPtrArray *messages;
+
+  messages = g_hash_table_lookup (self->pages, key);
+  if (messages != NULL && self->pages_lru.head->data != key)
+    {
+      g_queue_remove (&self->pages_lru, key);
+      g_queue_push_head (&self->pages_lru, key);
+    }
+
+  return messages;
+}
+
+static void
+valent_message_thread_cache_page (ValentMessageThread *self,
+                                  unsigned int         page,
+                                  GPtrArray           *messages)
+{
+  gpointer key = GUINT_TO_POINTER (page);
+
+  if (g_hash_table_replace (self->pages, key, g_ptr_array_ref (messages)))
+    g_queue_push_head (&self->pages_lru, key);
+  else if (self->pages_lru.head->data != key)
+    {
+      g_queue_remove (&self->pages_lru, key);
+      g_queue_push_head (&self->pages_lru, key);
+    }
+
+  while (self->pages_lru.length > THREAD_PAGE_MAX)
+    {
+      key = g_queue_pop_tail (&self->pages_lru);
+      g_hash_table_remove (self->pages, key);
+    }
+}
+
+static void
+valent_message_thread_drop_pages (ValentMessageThread *self,
+                                  unsigned int         first)
+{
+  GList *iter = self->pages_lru.head;
+
+  while (iter != NULL)
+    {
+      GList *next = iter->next;
+
+      if (GPOINTER_TO_UINT (iter->data) >= first)
+        {
+          g_hash_table_remove (self->pages, iter->data);
+          g_queue_delete_link (&self->pages_lru, iter);
+        }
+
+      iter = next;
+    }
+
+  /* Pending loads may have been keyed on a dropped page
+   */
+  g_hash_table_remove_all (self->pages_pending);
+  self->generation++;
+}
+
+/*
+ * Placeholders
+ */
+static ValentMessage *
+valent_message_thread_ref_placeholder (ValentMessageThread *self,
+                                       unsigned int         position)
+{
+  gpointer key = GUINT_TO_POINTER (position);
+  ValentMessage *placeholder;
+
+  placeholder = g_hash_table_lookup (self->placeholders, key);
+  if (placeholder == NULL)
+    {
+      placeholder = g_object_new (VALENT_TYPE_MESSAGE, NULL);
+      g_hash_table_insert (self->placeholders, key, placeholder);
+    }
+
+  return g_object_ref (placeholder);
+}
+
+static void
+valent_message_thread_fill_placeholders (ValentMessageThread *self,
+                                         unsigned int         page,
+                                         GPtrArray           *messages)
+{
+  unsigned int first = page * THREAD_PAGE_SIZE;
+  unsigned int n_changed = 0;
+
+  /* Replace each run of contiguous placeholders with a single emission
+   */
+  for (unsigned int i = 0; i < messages->len; i++)
+    {
+      if (g_hash_table_remove (self->placeholders, GUINT_TO_POINTER (first + i)))
+        {
+          n_changed += 1;
+          continue;
+        }
 
-  return (date1 < date2) ? -1 : (date1 > date2);
+      if (n_changed > 0)
+        {
+          g_list_model_items_changed (G_LIST_MODEL (self),
+                                      first + i - n_changed,
+                                      n_changed,
+                                      n_changed);
+          n_changed = 0;
+        }
+    }
+
+  if (n_changed > 0)
+    {
+      g_list_model_items_changed (G_LIST_MODEL (self),
+                                  first + messages->len - n_changed,
+                                  n_changed,
+                                  n_changed);
+    }
+}
+
+/*< private >
+ * valent_message_thread_shift_placeholders:
+ * @self: a `ValentMessageThread`
+ * @position: the position of a removed item
+ *
+ * Move the placeholders after @position back by one, to follow the items
+ * they stand in for, then reload the pages they belong to.
+ */
+static void
+valent_message_thread_shift_placeholders (ValentMessageThread *self,
+                                          unsigned int         position)
+{
+  g_autoptr (GHashTable) placeholders = NULL;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  placeholders = g_steal_pointer (&self->placeholders);
+  self->placeholders = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+
+  g_hash_table_iter_init (&iter, placeholders);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      unsigned int index = GPOINTER_TO_UINT (key);
+
+      if (index == position)
+        continue;
+
+      if (index > position)
+        index -= 1;
+
+      g_hash_table_iter_steal (&iter);
+      g_hash_table_insert (self->placeholders, GUINT_TO_POINTER (index), value);
+    }
+}
+
+static void
+valent_message_thread_load_placeholders (ValentMessageThread *self)
+{
+  GHashTableIter iter;
+  gpointer key;
+
+  g_hash_table_iter_init (&iter, self->placeholders);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      unsigned int position = GPOINTER_TO_UINT (key);
+
+      if (position >= self->n_items)
+        {
+          g_hash_table_iter_remove (&iter);
+          continue;
+        }
+
+      valent_message_thread_load_page (self,
+                                       position / THREAD_PAGE_SIZE,
+                                       self->n_items,
+                                       FALSE);
+    }
+}
+
+/*
+ * Queries
+ */
+static TrackerSparqlStatement *
+valent_message_thread_prepare_page (ValentMessageThread  *self,
+                                    unsigned int          page,
+                                    unsigned int          n_items,
+                                    gboolean             *reverse,
+                                    GError              **error)
+{
+  TrackerSparqlStatement **stmt = &self->get_thread_messages_stmt;
+  const char *path = GET_THREAD_MESSAGES_RQ;
+  GPtrArray *adjacent = NULL;
+  ValentMessage *key = NULL;
+  unsigned int limit;
+  unsigned int offset = 0;
+  int64_t key_date = 0;
+  int64_t key_id = G_MININT64;
+  g_autoptr (GDateTime) datetime = NULL;
+  g_autofree char *date = NULL;
+
+  g_assert (VALENT_IS_MESSAGE_THREAD (self));
+  g_assert (page * THREAD_PAGE_SIZE < n_items);
+
+  limit = MIN (THREAD_PAGE_SIZE, n_items - page * THREAD_PAGE_SIZE);
+  *reverse = FALSE;
+
+  /* Seek from the keys of a neighbouring page if possible, falling back to an
+   * offset from the start of the thread.
+   */
+  if (page > 0)
+    adjacent = g_hash_table_lookup (self->pages, GUINT_TO_POINTER (page - 1));
+
+  if (adjacent != NULL && adjacent->len == THREAD_PAGE_SIZE)
+    {
+      key = g_ptr_array_index (adjacent, adjacent->len - 1);
+    }
+  else if ((adjacent = g_hash_table_lookup (self->pages, GUINT_TO_POINTER (page + 1))) != NULL &&
+           adjacent->len > 0 &&
+           limit == THREAD_PAGE_SIZE)
+    {
+      key = g_ptr_array_index (adjacent, 0);
+      stmt = &self->get_thread_messages_before_stmt;
+      path = GET_THREAD_MESSAGES_BEFORE_RQ;
+      *reverse = TRUE;
+    }
+  else
+    {
+      offset = page * THREAD_PAGE_SIZE;
+    }
+
+  if (*stmt == NULL)
+    {
+      *stmt = tracker_sparql_connection_load_statement_from_gresource (self->connection,
+                                                                       path,
+                                                                       self->cancellable,
+                                                                       error);
+    }
+
+  if (*stmt == NULL)
+    return NULL;
+
+  if (key != NULL)
+    {
+      key_date = valent_message_get_date (key);
+      key_id = valent_message_get_id (key);
+    }
+
+  datetime = g_date_time_new_from_unix_utc_usec (key_date * 1000);
+  date = g_date_time_format_iso8601 (datetime);
+
+  tracker_sparql_statement_bind_string (*stmt, "iri", self->iri);
+  tracker_sparql_statement_bind_string (*stmt, "date", date);
+  tracker_sparql_statement_bind_int (*stmt, "messageId", key_id);
+  tracker_sparql_statement_bind_int (*stmt, "limit", limit);
+  if (!*reverse)
+    tracker_sparql_statement_bind_int (*stmt, "offset", offset);
+
+  return g_object_ref (*stmt);
 }
 
 static void
@@ -95,7 +406,7 @@ valent_message_thread_load_message_cb (GObject      *object,
   ValentMessageThread *self = VALENT_MESSAGE_THREAD (object);
   g_autoptr (ValentMessage) message = NULL;
   int64_t latest_date = 0;
-  GSequenceIter *it;
+  GPtrArray *messages;
   unsigned int position;
   g_autoptr (GError) error = NULL;
 
@@ -123,47 +434,80 @@ valent_message_thread_load_message_cb (GObject      *object,
 
   /* Bail if we haven't loaded the rest of the thread yet
    */
-  if (self->cancellable == NULL)
+  if (!self->loaded)
     return;
 
-  it = g_sequence_insert_sorted (self->items,
-                                 g_object_ref (message),
-                                 valent_message_thread_sort_func, NULL);
-
-  position = g_sequence_iter_get_position (it);
-  valent_message_thread_items_changed (self, position, 0, 1);
-}
-
-static inline int
-valent_message_thread_lookup_func (gconstpointer a,
-                                   gconstpointer b,
-                                   gpointer      user_data)
-{
-  const char *iri = valent_object_get_iri ((ValentObject *)a);
+  /* New messages almost always sort last, so they can be appended without
+   * disturbing the page layout. Anything else requires a recount.
+   */
+  if (self->last_item != NULL &&
+      valent_message_thread_sort_func (message, self->last_item, NULL) <= 0)
+    {
+      valent_message_thread_load (self);
+      return;
+    }
 
-  return g_utf8_collate (iri, (const char *)b);
+  position = self->n_items;
+  messages = g_hash_table_lookup (self->pages,
+                                  GUINT_TO_POINTER (position / THREAD_PAGE_SIZE));
+  if (messages != NULL && messages->len == position % THREAD_PAGE_SIZE)
+    g_ptr_array_add (messages, g_object_ref (message));
+  else if (messages != NULL)
+    valent_message_thread_drop_pages (self, position / THREAD_PAGE_SIZE);
+
+  g_set_object (&self->last_item, message);
+  self->n_items += 1;
+  g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
+  valent_message_thread_load_placeholders (self);
 }
 
 static void
 valent_message_thread_remove_message (ValentMessageThread *self,
                                       const char          *iri)
 {
-  GSequenceIter *it;
-  unsigned int position;
+  GHashTableIter iter;
+  gpointer key;
+  GPtrArray *messages;
 
   g_assert (VALENT_IS_MESSAGE_THREAD (self));
 
-  it = g_sequence_lookup (self->items,
-                          (char *)iri,
-                          valent_message_thread_lookup_func,
-                          NULL);
+  if (!self->loaded)
+    return;
 
-  if (it != NULL)
+  g_hash_table_iter_init (&iter, self->pages);
+  while (g_hash_table_iter_next (&iter, &key, (void **)&messages))
     {
-      position = g_sequence_iter_get_position (it);
-      g_sequence_remove (it);
-      valent_message_thread_items_changed (self, position, 1, 0);
+      for (unsigned int i = 0; i < messages->len; i++)
+        {
+          ValentObject *message = g_ptr_array_index (messages, i);
+          unsigned int page = GPOINTER_TO_UINT (key);
+          unsigned int position;
+
+          if (g_strcmp0 (valent_object_get_iri (message), iri) != 0)
+            continue;
+
+          /* Every page from here on is now misaligned by one position
+           */
+          position = page * THREAD_PAGE_SIZE + i;
+          if (message == (ValentObject *)self->last_item)
+            {
+              g_clear_object (&self->last_item);
+              if (i > 0)
+                self->last_item = g_object_ref (g_ptr_array_index (messages, i - 1));
+            }
+
+          valent_message_thread_drop_pages (self, page);
+          valent_message_thread_shift_placeholders (self, position);
+          self->n_items -= 1;
+          g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
+          valent_message_thread_load_placeholders (self);
+          return;
+        }
     }
+
+  /* The position of a message outside the cache is unknown
+   */
+  valent_message_thread_load (self);
 }
 
 gboolean
@@ -203,7 +547,7 @@ on_notifier_event (TrackerNotifier     *notifier,
           //       last and pick one to update the last-message.
           if (self->cancellable != NULL)
             valent_message_thread_load_message (self, urn);
-          else if (latest_urn == NULL || g_utf8_collate (latest_urn, urn) < 0)
+          else if (latest_urn == NULL || strcmp (latest_urn, urn) < 0)
             latest_urn = urn;
           break;
 
@@ -329,14 +673,15 @@ valent_message_thread_load_message (ValentMessageThread *self,
 }
 
 static void
-valent_message_thread_load_cb (GObject      *object,
-                               GAsyncResult *result,
-                               gpointer      user_data)
+valent_message_thread_load_page_cb (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
 {
   ValentMessageThread *self = VALENT_MESSAGE_THREAD (object);
+  PageRequest *request = g_task_get_task_data (G_TASK (result));
   g_autoptr (GPtrArray) messages = NULL;
   g_autoptr (GError) error = NULL;
-  unsigned int position = 0;
+  unsigned int removed = 0;
 
   messages = g_task_propagate_pointer (G_TASK (result), &error);
   if (messages == NULL)
@@ -344,14 +689,51 @@ valent_message_thread_load_cb (GObject      *object,
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         g_warning ("%s(): %s: %s", G_STRFUNC, self->iri, error->message);
 
+      if (request->generation == self->generation)
+        g_hash_table_remove (self->pages_pending, GUINT_TO_POINTER (request->page));
+
       return;
     }
 
-  position = g_sequence_get_length (self->items);
-  for (unsigned int i = 0; i < messages->len; i++)
-    g_sequence_append (self->items, g_object_ref (g_ptr_array_index (messages, i)));
+  /* Discard pages that were requested for a stale layout
+   */
+  if (request->generation != self->generation)
+    return;
 
-  valent_message_thread_items_changed (self, position, 0, messages->len);
+  g_hash_table_remove (self->pages_pending, GUINT_TO_POINTER (request->page));
+
+  if (!request->replace)
+    {
+      unsigned int first = request->page * THREAD_PAGE_SIZE;
+
+      valent_message_thread_cache_page (self, request->page, messages);
+      valent_message_thread_fill_placeholders (self, request->page, messages);
+
+      /* A short page means the count is stale, so recount to correct the
+       * size of the list
+       */
+      if (messages->len < MIN (THREAD_PAGE_SIZE, self->n_items - first) &&
+          !self->loading)
+        valent_message_thread_load (self);
+
+      return;
+    }
+
+  /* This is the tail page of a (re)load, so replace the layout. Any
+   * placeholders are replaced by the items-changed emission.
+   */
+  g_hash_table_remove_all (self->pages);
+  g_queue_clear (&self->pages_lru);
+  g_hash_table_remove_all (self->placeholders);
+  valent_message_thread_cache_page (self, request->page, messages);
+
+  if (messages->len > 0)
+    g_set_object (&self->last_item, g_ptr_array_index (messages, messages->len - 1));
+
+  removed = self->n_items;
+  self->n_items = request->n_items;
+  self->loaded = TRUE;
+  g_list_model_items_changed (G_LIST_MODEL (self), 0, removed, self->n_items);
 }
 
 static void
@@ -360,7 +742,8 @@ cursor_get_messages_cb (TrackerSparqlCursor *cursor,
                         gpointer             user_data)
 {
   g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
-  GPtrArray *messages = g_task_get_task_data (task);
+  PageRequest *request = g_task_get_task_data (task);
+  GPtrArray *messages = request->messages;
   GError *error = NULL;
 
   if (tracker_sparql_cursor_next_finish (cursor, result, &error))
@@ -382,6 +765,9 @@ cursor_get_messages_cb (TrackerSparqlCursor *cursor,
     }
   else if (error == NULL)
     {
+      if (request->reverse)
+        messages_reverse (messages);
+
       g_task_return_pointer (task,
                              g_ptr_array_ref (messages),
                              (GDestroyNotify)g_ptr_array_unref);
@@ -417,6 +803,155 @@ execute_get_messages_cb (TrackerSparqlStatement *stmt,
                                     g_object_ref (task));
 }
 
+static void
+valent_message_thread_load_page (ValentMessageThread *self,
+                                 unsigned int         page,
+                                 unsigned int         n_items,
+                                 gboolean             replace)
+{
+  g_autoptr (GTask) task = NULL;
+  g_autoptr (TrackerSparqlStatement) stmt = NULL;
+  PageRequest *request = NULL;
+  GError *error = NULL;
+
+  g_assert (VALENT_IS_MESSAGE_THREAD (self));
+
+  if (!g_hash_table_add (self->pages_pending, GUINT_TO_POINTER (page)))
+    return;
+
+  request = g_new0 (PageRequest, 1);
+  request->page = page;
+  request->n_items = n_items;
+  request->generation = self->generation;
+  request->replace = replace;
+  request->messages = g_ptr_array_new_with_free_func (g_object_unref);
+
+  task = g_task_new (self, self->cancellable, valent_message_thread_load_page_cb, NULL);
+  g_task_set_source_tag (task, valent_message_thread_load_page);
+  g_task_set_task_data (task, request, page_request_free);
+
+  stmt = valent_message_thread_prepare_page (self, page, n_items,
+                                             &request->reverse, &error);
+  if (stmt == NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  tracker_sparql_statement_execute_async (stmt,
+                                          g_task_get_cancellable (task),
+                                          (GAsyncReadyCallback) execute_get_messages_cb,
+                                          g_object_ref (task));
+}
+
+static void
+valent_message_thread_load_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+  ValentMessageThread *self = VALENT_MESSAGE_THREAD (object);
+  unsigned int generation = GPOINTER_TO_UINT (g_task_get_task_data (G_TASK (result)));
+  gssize n_items = 0;
+  unsigned int removed = 0;
+  g_autoptr (GError) error = NULL;
+
+  n_items = g_task_propagate_int (G_TASK (result), &error);
+  if (n_items < 0)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s(): %s: %s", G_STRFUNC, self->iri, error->message);
+
+      if (generation == self->generation)
+        self->loading = FALSE;
+
+      return;
+    }
+
+  if (generation != self->generation)
+    return;
+
+  self->loading = FALSE;
+
+  /* Page loads requested before the count are keyed on the old layout
+   */
+  g_hash_table_remove_all (self->pages_pending);
+  self->generation++;
+
+  if (n_items > 0)
+    {
+      valent_message_thread_load_page (self,
+                                       (n_items - 1) / THREAD_PAGE_SIZE,
+                                       n_items,
+                                       TRUE);
+      return;
+    }
+
+  g_hash_table_remove_all (self->pages);
+  g_queue_clear (&self->pages_lru);
+  g_hash_table_remove_all (self->placeholders);
+  g_clear_object (&self->last_item);
+
+  removed = self->n_items;
+  self->n_items = 0;
+  self->loaded = TRUE;
+
+  if (removed > 0)
+    g_list_model_items_changed (G_LIST_MODEL (self), 0, removed, 0);
+}
+
+static void
+cursor_get_count_cb (TrackerSparqlCursor *cursor,
+                     GAsyncResult        *result,
+                     gpointer             user_data)
+{
+  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
+  int64_t n_items = 0;
+  GError *error = NULL;
+
+  if (tracker_sparql_cursor_next_finish (cursor, result, &error))
+    n_items = tracker_sparql_cursor_get_integer (cursor, 0);
+  tracker_sparql_cursor_close (cursor);
+
+  if (error != NULL)
+    g_task_return_error (task, g_steal_pointer (&error));
+  else
+    g_task_return_int (task, CLAMP (n_items, 0, G_MAXUINT));
+}
+
+static void
+execute_get_count_cb (TrackerSparqlStatement *stmt,
+                      GAsyncResult           *result,
+                      gpointer                user_data)
+{
+  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
+  g_autoptr (TrackerSparqlCursor) cursor = NULL;
+  GError *error = NULL;
+
+  cursor = tracker_sparql_statement_execute_finish (stmt, result, &error);
+  if (cursor == NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  /* The aggregate is computed when the cursor is stepped
+   */
+  tracker_sparql_cursor_next_async (cursor,
+                                    g_task_get_cancellable (task),
+                                    (GAsyncReadyCallback) cursor_get_count_cb,
+                                    g_object_ref (task));
+}
+
+/*< private >
+ * valent_message_thread_load:
+ * @self: a `ValentMessageThread`
+ *
+ * Count the messages in the thread, then load the most recent page.
+ *
+ * This is called the first time the size of the list is queried and whenever
+ * the page layout can no longer be adjusted in place. Cached pages remain
+ * valid until the new layout replaces them.
+ */
 static void
 valent_message_thread_load (ValentMessageThread *self)
 {
@@ -425,39 +960,61 @@ valent_message_thread_load (ValentMessageThread *self)
 
   g_assert (VALENT_IS_MESSAGE_THREAD (self));
 
-  if (self->connection == NULL || self->cancellable != NULL)
+  if (self->connection == NULL)
     return;
 
-  self->cancellable = valent_object_ref_cancellable (VALENT_OBJECT (self));
+  if (self->cancellable == NULL)
+    self->cancellable = valent_object_ref_cancellable (VALENT_OBJECT (self));
+
+  g_hash_table_remove_all (self->pages_pending);
+  self->generation++;
+  self->loading = TRUE;
+
   task = g_task_new (self, self->cancellable, valent_message_thread_load_cb, NULL);
   g_task_set_source_tag (task, valent_message_thread_load);
-  g_task_set_task_data (task,
-                        g_ptr_array_new_with_free_func (g_object_unref),
-                        (GDestroyNotify)g_ptr_array_unref);
+  g_task_set_task_data (task, GUINT_TO_POINTER (self->generation), NULL);
 
-  if (self->get_thread_messages_stmt == NULL)
+  if (self->get_thread_count_stmt == NULL)
     {
-      self->get_thread_messages_stmt =
+      self->get_thread_count_stmt =
         tracker_sparql_connection_load_statement_from_gresource (self->connection,
-                                                                 GET_THREAD_MESSAGES_RQ,
+                                                                 GET_THREAD_COUNT_RQ,
                                                                  self->cancellable,
                                                                  &error);
     }
 
-  if (self->get_thread_messages_stmt == NULL)
+  if (self->get_thread_count_stmt == NULL)
     {
       g_task_return_error (task, g_steal_pointer (&error));
       return;
     }
 
-  tracker_sparql_statement_bind_string (self->get_thread_messages_stmt, "iri",
+  tracker_sparql_statement_bind_string (self->get_thread_count_stmt, "iri",
                                         self->iri);
-  tracker_sparql_statement_execute_async (self->get_thread_messages_stmt,
+  tracker_sparql_statement_execute_async (self->get_thread_count_stmt,
                                           g_task_get_cancellable (task),
-                                          (GAsyncReadyCallback) execute_get_messages_cb,
+                                          (GAsyncReadyCallback) execute_get_count_cb,
                                           g_object_ref (task));
 }
 
+/*< private >
+ * valent_message_thread_set_latest_message:
+ * @thread: a `ValentMessageThread`
+ * @message: (nullable): a `ValentMessage`
+ *
+ * Set the latest message of @thread, as loaded by its adapter.
+ */
+void
+valent_message_thread_set_latest_message (ValentMessageThread *thread,
+                                          ValentMessage       *message)
+{
+  g_assert (VALENT_IS_MESSAGE_THREAD (thread));
+  g_assert (message == NULL || VALENT_IS_MESSAGE (message));
+
+  if (g_set_object (&thread->latest_message, message))
+    g_object_notify_by_pspec (G_OBJECT (thread), properties[PROP_LATEST_MESSAGE]);
+}
+
 /*
  * GListModel
  */
@@ -475,7 +1032,7 @@ valent_message_thread_get_n_items (GListModel *model)
   if (self->cancellable == NULL)
     valent_message_thread_load (self);
 
-  return g_sequence_get_length (self->items);
+  return self->n_items;
 }
 
 static gpointer
@@ -483,29 +1040,48 @@ valent_message_thread_get_item (GListModel   *model,
                                 unsigned int  position)
 {
   ValentMessageThread *self = VALENT_MESSAGE_THREAD (model);
-  GSequenceIter *it = NULL;
+  GPtrArray *messages = NULL;
+  unsigned int page, offset;
+
+  if G_UNLIKELY (position >= self->n_items)
+    return NULL;
+
+  page = position / THREAD_PAGE_SIZE;
+  offset = position % THREAD_PAGE_SIZE;
 
-  if (self->last_position_valid)
+  messages = valent_message_thread_lookup_page (self, page);
+  if (messages == NULL)
     {
-      if (position < G_MAXUINT && self->last_position == position + 1)
-        it = g_sequence_iter_prev (self->last_iter);
-      else if (position > 0 && self->last_position == position - 1)
-        it = g_sequence_iter_next (self->last_iter);
-      else if (self->last_position == position)
-        it = self->last_iter;
+      valent_message_thread_load_page (self, page, self->n_items, FALSE);
+      return valent_message_thread_ref_placeholder (self, position);
     }
 
-  if (it == NULL)
-    it = g_sequence_get_iter_at_pos (self->items, position);
+  /* Prefetch the neighbouring page in the direction of travel
+   */
+  if (offset < THREAD_PAGE_PREFETCH && page > 0)
+    {
+      if (!g_hash_table_contains (self->pages, GUINT_TO_POINTER (page - 1)))
+        valent_message_thread_load_page (self, page - 1, self->n_items, FALSE);
+    }
+  else if (offset >= THREAD_PAGE_SIZE - THREAD_PAGE_PREFETCH &&
+           (page + 1) * THREAD_PAGE_SIZE < self->n_items)
+    {
+      if (!g_hash_table_contains (self->pages, GUINT_TO_POINTER (page + 1)))
+        valent_message_thread_load_page (self, page + 1, self->n_items, FALSE);
+    }
 
-  self->last_iter = it;
-  self->last_position = position;
-  self->last_position_valid = TRUE;
+  /* A short page means the count is stale; the placeholder is removed when
+   * the recount emits items-changed
+   */
+  if (offset >= messages->len)
+    {
+      if (!self->loading)
+        valent_message_thread_load (self);
 
-  if (g_sequence_iter_is_end (it))
-    return NULL;
+      return valent_message_thread_ref_placeholder (self, position);
+    }
 
-  return g_object_ref (g_sequence_get (it));
+  return g_object_ref (g_ptr_array_index (messages, offset));
 }
 
 static void
@@ -555,7 +1131,9 @@ valent_message_thread_destroy (ValentObject *object)
   ValentMessageThread *self = VALENT_MESSAGE_THREAD (object);
 
   g_clear_object (&self->get_message_stmt);
+  g_clear_object (&self->get_thread_count_stmt);
   g_clear_object (&self->get_thread_messages_stmt);
+  g_clear_object (&self->get_thread_messages_before_stmt);
   g_clear_pointer (&self->iri_pattern, g_regex_unref);
   g_clear_pointer (&self->iri, g_free);
 
@@ -577,7 +1155,11 @@ valent_message_thread_finalize (GObject *object)
   g_clear_object (&self->latest_message);
   g_clear_pointer (&self->participants, g_strfreev);
   g_clear_object (&self->cancellable);
-  g_clear_pointer (&self->items, g_sequence_free);
+  g_clear_object (&self->last_item);
+  g_clear_pointer (&self->pages, g_hash_table_unref);
+  g_clear_pointer (&self->pages_pending, g_hash_table_unref);
+  g_clear_pointer (&self->placeholders, g_hash_table_unref);
+  g_queue_clear (&self->pages_lru);
 
   G_OBJECT_CLASS (valent_message_thread_parent_class)->finalize (object);
 }
@@ -718,6 +1300,10 @@ valent_message_thread_class_init (ValentMessageThreadClass *klass)
 static void
 valent_message_thread_init (ValentMessageThread *self)
 {
-  self->items = g_sequence_new (g_object_unref);
+  self->pages = g_hash_table_new_full (NULL, NULL, NULL,
+                                       (GDestroyNotify)g_ptr_array_unref);
+  self->pages_pending = g_hash_table_new (NULL, NULL);
+  self->placeholders = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+  g_queue_init (&self->pages_lru);
 }
 
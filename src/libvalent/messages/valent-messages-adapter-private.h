@@ -6,6 +6,7 @@
 #include <libtracker-sparql/tracker-sparql.h>
 
 #include "valent-message.h"
+#include "valent-message-thread.h"
 
 G_BEGIN_DECLS
 
@@ -31,8 +32,10 @@ G_BEGIN_DECLS
 #define CURSOR_MESSAGE_THREAD_PARTICIPANTS (11)
 
 
-ValentMessage * valent_message_from_sparql_cursor (TrackerSparqlCursor *cursor,
-                                                   ValentMessage       *current);
+ValentMessage * valent_message_from_sparql_cursor        (TrackerSparqlCursor *cursor,
+                                                          ValentMessage       *current);
+void            valent_message_thread_set_latest_message (ValentMessageThread *thread,
+                                                          ValentMessage       *message);
 
 G_END_DECLS
 
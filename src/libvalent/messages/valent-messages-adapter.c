@@ -51,10 +51,14 @@ typedef struct
   TrackerSparqlStatement  *get_thread_stmt;
   TrackerSparqlStatement  *get_threads_stmt;
   GRegex                  *iri_pattern;
+  GRegex                  *message_pattern;
   GCancellable            *cancellable;
+  GHashTable              *pending_threads;
+  unsigned int             pending_id;
 
   /* list model */
   GPtrArray               *items;
+  GHashTable              *threads;
 } ValentMessagesAdapterPrivate;
 
 static void   g_list_model_iface_init (GListModelInterface *iface);
@@ -73,6 +77,114 @@ typedef enum
 
 static GParamSpec *properties[PROP_CONNECTION + 1] = { NULL, };
 
+static int64_t
+valent_message_thread_get_date (ValentMessageThread *thread)
+{
+  g_autoptr (ValentMessage) message = NULL;
+
+  g_object_get (thread, "latest-message", &message, NULL);
+
+  return message != NULL ? valent_message_get_date (message) : 0;
+}
+
+/*< private >
+ * valent_messages_adapter_sorted_position:
+ * @self: a `ValentMessagesAdapter`
+ * @date: a UNIX epoch timestamp (ms)
+ *
+ * Find the position for a thread whose latest message is at @date, with the
+ * most recent threads first. A thread is placed before others with an equal
+ * date, since it was the most recently updated.
+ */
+static unsigned int
+valent_messages_adapter_sorted_position (ValentMessagesAdapter *self,
+                                         int64_t                date)
+{
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+  unsigned int lo = 0;
+  unsigned int hi = priv->items->len;
+
+  while (lo < hi)
+    {
+      unsigned int mid = lo + (hi - lo) / 2;
+
+      if (valent_message_thread_get_date (g_ptr_array_index (priv->items, mid)) > date)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+/*
+ * Thread Index
+ *
+ * Threads are indexed by IRI, so that inserting, removing or moving a thread
+ * only touches its own entry. The keys are borrowed from the thread objects,
+ * so an entry must be removed before its thread is released.
+ *
+ * The position of a thread is found on demand, by searching from its sorted
+ * position. A thread may have updated its latest message before the list
+ * moved it, in which case the list is scanned instead.
+ */
+static gboolean
+valent_messages_adapter_lookup (ValentMessagesAdapter *self,
+                                const char            *iri,
+                                unsigned int          *position)
+{
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+  ValentMessageThread *thread = NULL;
+  int64_t date;
+
+  thread = g_hash_table_lookup (priv->threads, iri);
+  if (thread == NULL)
+    return FALSE;
+
+  date = valent_message_thread_get_date (thread);
+  for (unsigned int i = valent_messages_adapter_sorted_position (self, date);
+       i < priv->items->len;
+       i++)
+    {
+      ValentMessageThread *item = g_ptr_array_index (priv->items, i);
+
+      if (item == thread)
+        {
+          *position = i;
+          return TRUE;
+        }
+
+      if (valent_message_thread_get_date (item) != date)
+        break;
+    }
+
+  return g_ptr_array_find (priv->items, thread, position);
+}
+
+static void
+valent_messages_adapter_insert_item (ValentMessagesAdapter *self,
+                                     unsigned int           position,
+                                     ValentMessageThread   *thread)
+{
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+
+  g_ptr_array_insert (priv->items, position, thread);
+  g_hash_table_replace (priv->threads,
+                        (char *)valent_object_get_iri (VALENT_OBJECT (thread)),
+                        thread);
+}
+
+static void
+valent_messages_adapter_remove_item (ValentMessagesAdapter *self,
+                                     unsigned int           position)
+{
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+  ValentObject *thread = g_ptr_array_index (priv->items, position);
+
+  g_hash_table_remove (priv->threads, valent_object_get_iri (thread));
+  g_ptr_array_remove_index (priv->items, position);
+}
+
 static void
 valent_messages_adapter_load_thread_cb (GObject      *object,
                                         GAsyncResult *result,
@@ -80,36 +192,60 @@ valent_messages_adapter_load_thread_cb (GObject      *object,
 {
   ValentMessagesAdapter *self = VALENT_MESSAGES_ADAPTER (object);
   ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
-  g_autoptr (GListModel) list = NULL;
-  unsigned int position;
+  g_autoptr (ValentMessageThread) thread = NULL;
+  const char *iri = g_task_get_task_data (G_TASK (result));
+  unsigned int position, removed;
   g_autoptr (GError) error = NULL;
 
-  list = g_task_propagate_pointer (G_TASK (result), &error);
-  if (list == NULL)
+  thread = g_task_propagate_pointer (G_TASK (result), &error);
+  if (thread == NULL)
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      /* A thread without messages, usually because it is being removed
+       */
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
+          !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+        g_warning ("%s(): %s: %s", G_STRFUNC, iri, error->message);
+
+      return;
+    }
+
+  /* Update an existing thread in place, then move it to keep the list sorted
+   * by date. The thread may have already updated its latest message from the
+   * same notifier event, so whether it moves is decided by its sort position
+   * rather than by comparing the latest messages.
+   */
+  if (valent_messages_adapter_lookup (self, iri, &removed))
+    {
+      ValentMessageThread *current = NULL;
+      g_autoptr (ValentMessage) latest_message = NULL;
+
+      g_object_get (thread, "latest-message", &latest_message, NULL);
+
+      current = g_ptr_array_steal_index (priv->items, removed);
+      valent_message_thread_set_latest_message (current, latest_message);
+      position = valent_messages_adapter_sorted_position (self,
+                                                          valent_message_thread_get_date (current));
+      g_ptr_array_insert (priv->items, position, current);
+
+      if (position == removed)
         {
-          const char *urn = g_task_get_task_data (G_TASK (result));
-          g_warning ("%s(): %s: %s", G_STRFUNC, urn, error->message);
+          g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 1);
+        }
+      else
+        {
+          g_list_model_items_changed (G_LIST_MODEL (self), removed, 1, 0);
+          g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
         }
 
       return;
     }
 
-  position = priv->items->len;
-  g_ptr_array_add (priv->items, g_steal_pointer (&list));
+  position = valent_messages_adapter_sorted_position (self,
+                                                      valent_message_thread_get_date (thread));
+  valent_messages_adapter_insert_item (self, position, g_steal_pointer (&thread));
   g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
 }
 
-static inline gboolean
-valent_messages_adapter_equal_func (gconstpointer a,
-                                    gconstpointer b)
-{
-  const char *iri = valent_object_get_iri ((ValentObject *)a);
-
-  return g_utf8_collate (iri, (const char *)b) == 0;
-}
-
 static void
 valent_messages_adapter_remove_thread (ValentMessagesAdapter *self,
                                        const char            *iri)
@@ -119,10 +255,7 @@ valent_messages_adapter_remove_thread (ValentMessagesAdapter *self,
 
   g_assert (VALENT_IS_MESSAGES_ADAPTER (self));
 
-  if (!g_ptr_array_find_with_equal_func (priv->items,
-                                         iri,
-                                         valent_messages_adapter_equal_func,
-                                         &position))
+  if (!valent_messages_adapter_lookup (self, iri, &position))
     {
       g_warning ("Resource \"%s\" not found in \"%s\"",
                  iri,
@@ -130,7 +263,7 @@ valent_messages_adapter_remove_thread (ValentMessagesAdapter *self,
       return;
     }
 
-  g_ptr_array_remove_index (priv->items, position);
+  valent_messages_adapter_remove_item (self, position);
   g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
 }
 
@@ -143,6 +276,68 @@ valent_messages_adapter_event_is_thread (ValentMessagesAdapter *self,
   return g_regex_match (priv->iri_pattern, iri, G_REGEX_MATCH_DEFAULT, NULL);
 }
 
+static inline gboolean
+valent_messages_adapter_event_is_message (ValentMessagesAdapter *self,
+                                          const char            *iri)
+{
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+
+  return g_regex_match (priv->message_pattern, iri, G_REGEX_MATCH_DEFAULT, NULL);
+}
+
+static gboolean
+valent_messages_adapter_flush_threads (gpointer data)
+{
+  ValentMessagesAdapter *self = VALENT_MESSAGES_ADAPTER (data);
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+  GHashTableIter iter;
+  const char *iri;
+
+  priv->pending_id = 0;
+
+  g_hash_table_iter_init (&iter, priv->pending_threads);
+  while (g_hash_table_iter_next (&iter, (void **)&iri, NULL))
+    {
+      valent_messages_adapter_load_thread (self, iri);
+      g_hash_table_iter_remove (&iter);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+/*< private >
+ * valent_messages_adapter_queue_thread:
+ * @self: a `ValentMessagesAdapter`
+ * @iri: a thread IRI
+ *
+ * Queue the thread for @iri to be (re)loaded.
+ *
+ * Notifier events are coalesced until the main loop is idle, so that a thread
+ * touched by many messages in a sync is only queried once.
+ */
+static void
+valent_messages_adapter_queue_thread (ValentMessagesAdapter *self,
+                                      const char            *iri)
+{
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+
+  g_assert (VALENT_IS_MESSAGES_ADAPTER (self));
+  g_assert (iri != NULL);
+
+  if (!g_hash_table_contains (priv->pending_threads, iri))
+    g_hash_table_add (priv->pending_threads, g_strdup (iri));
+
+  if (priv->pending_id == 0)
+    {
+      priv->pending_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                                          valent_messages_adapter_flush_threads,
+                                          g_object_ref (self),
+                                          g_object_unref);
+      g_source_set_name_by_id (priv->pending_id,
+                               "[valent-messages-adapter] flush threads");
+    }
+}
+
 static void
 on_notifier_event (TrackerNotifier       *notifier,
                    const char            *service,
@@ -150,6 +345,8 @@ on_notifier_event (TrackerNotifier       *notifier,
                    GPtrArray             *events,
                    ValentMessagesAdapter *self)
 {
+  ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
+
   g_assert (VALENT_IS_MESSAGES_ADAPTER (self));
 
   if (g_strcmp0 (VALENT_MESSAGES_GRAPH, graph) != 0)
@@ -160,6 +357,17 @@ on_notifier_event (TrackerNotifier       *notifier,
       TrackerNotifierEvent *event = g_ptr_array_index (events, i);
       const char *urn = tracker_notifier_event_get_urn (event);
 
+      /* Any change to a message may change the summary of its thread
+       */
+      if (valent_messages_adapter_event_is_message (self, urn))
+        {
+          g_autofree char *thread_iri = NULL;
+
+          thread_iri = g_strndup (urn, strrchr (urn, ':') - urn);
+          valent_messages_adapter_queue_thread (self, thread_iri);
+          continue;
+        }
+
       if (!valent_messages_adapter_event_is_thread (self, urn))
         continue;
 
@@ -167,17 +375,18 @@ on_notifier_event (TrackerNotifier       *notifier,
         {
         case TRACKER_NOTIFIER_EVENT_CREATE:
           VALENT_NOTE ("CREATE: %s", urn);
-          valent_messages_adapter_load_thread (self, urn);
+          valent_messages_adapter_queue_thread (self, urn);
           break;
 
         case TRACKER_NOTIFIER_EVENT_DELETE:
           VALENT_NOTE ("DELETE: %s", urn);
+          g_hash_table_remove (priv->pending_threads, urn);
           valent_messages_adapter_remove_thread (self, urn);
           break;
 
         case TRACKER_NOTIFIER_EVENT_UPDATE:
           VALENT_NOTE ("UPDATE: %s", urn);
-          // valent_message_adapter_update_thread (self, urn);
+          valent_messages_adapter_queue_thread (self, urn);
           break;
 
         default:
@@ -196,6 +405,7 @@ valent_messages_adapter_open (ValentMessagesAdapter  *self,
   g_autoptr (GFile) ontology = NULL;
   const char *iri = NULL;
   g_autofree char *iri_pattern = NULL;
+  g_autofree char *message_pattern = NULL;
 
   context = valent_extension_get_context (VALENT_EXTENSION (self));
   file = valent_context_get_cache_file (context, "metadata");
@@ -218,6 +428,12 @@ valent_messages_adapter_open (ValentMessagesAdapter  *self,
                                    G_REGEX_MATCH_DEFAULT,
                                    NULL);
 
+  message_pattern = g_strdup_printf ("^%s:([^:]+):([^:]+)$", iri);
+  priv->message_pattern = g_regex_new (message_pattern,
+                                       G_REGEX_OPTIMIZE,
+                                       G_REGEX_MATCH_DEFAULT,
+                                       NULL);
+
   priv->notifier = tracker_sparql_connection_create_notifier (priv->connection);
   g_signal_connect_object (priv->notifier,
                            "events",
@@ -508,15 +724,19 @@ cursor_get_threads_cb (TrackerSparqlCursor *cursor,
 
   if (tracker_sparql_cursor_next_finish (cursor, result, &error))
     {
-      ValentMessageThread *thread = NULL;
+      g_autoptr (ValentMessageThread) thread = NULL;
+      unsigned int position;
 
+      /* Skip threads already loaded from a notifier event
+       */
       thread = valent_message_thread_from_sparql_cursor (self, cursor);
-      if (thread != NULL)
+      if (thread != NULL &&
+          !valent_messages_adapter_lookup (self,
+                                           valent_object_get_iri (VALENT_OBJECT (thread)),
+                                           &position))
         {
-          unsigned int position;
-
           position = priv->items->len;
-          g_ptr_array_add (priv->items, g_steal_pointer (&thread));
+          valent_messages_adapter_insert_item (self, position, g_steal_pointer (&thread));
           g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
         }
 
@@ -665,6 +885,7 @@ valent_messages_adapter_load_thread (ValentMessagesAdapter *self,
   cancellable = valent_object_ref_cancellable (VALENT_OBJECT (self));
   task = g_task_new (self, cancellable, valent_messages_adapter_load_thread_cb, NULL);
   g_task_set_source_tag (task, valent_messages_adapter_load_thread);
+  g_task_set_task_data (task, g_strdup (iri), g_free);
 
   if (priv->get_thread_stmt == NULL)
     {
@@ -736,6 +957,9 @@ valent_messages_adapter_destroy (ValentObject *object)
   g_clear_object (&priv->get_thread_stmt);
   g_clear_object (&priv->get_threads_stmt);
   g_clear_pointer (&priv->iri_pattern, g_regex_unref);
+  g_clear_pointer (&priv->message_pattern, g_regex_unref);
+  g_clear_handle_id (&priv->pending_id, g_source_remove);
+  g_hash_table_remove_all (priv->pending_threads);
 
   if (priv->notifier != NULL)
     {
@@ -780,6 +1004,8 @@ valent_messages_adapter_finalize (GObject *object)
   ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
 
   g_clear_object (&priv->cancellable);
+  g_clear_pointer (&priv->pending_threads, g_hash_table_unref);
+  g_clear_pointer (&priv->threads, g_hash_table_unref);
   g_clear_pointer (&priv->items, g_ptr_array_unref);
 
   G_OBJECT_CLASS (valent_messages_adapter_parent_class)->finalize (object);
@@ -864,6 +1090,8 @@ valent_messages_adapter_init (ValentMessagesAdapter *self)
   ValentMessagesAdapterPrivate *priv = valent_messages_adapter_get_instance_private (self);
 
   priv->items = g_ptr_array_new_with_free_func (g_object_unref);
+  priv->threads = g_hash_table_new (g_str_hash, g_str_equal);
+  priv->pending_threads = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 /**
@@ -28,10 +28,13 @@
 #define CERTIFICATE_FOOTER "-----END CERTIFICATE-----\n"
 
 #define DEFAULT_BUFFER_SIZE (4096)
+#define DEFAULT_BUFFER_MAX  (1024 * 1024)
+#define BUFFER_SHRINK_USEC  (G_USEC_PER_SEC)
 #define HEADER_SIZE         (19)
 #define PRIMARY_UUID        "a0d0aaf4-1072-4d81-aa35-902a954b1266"
 #define PROTOCOL_MIN        (1)
 #define PROTOCOL_MAX        (1)
+#define INPUT_BUFFER_SIZE   (128 * 1024)
 
 
 struct _ValentBluezMuxer
@@ -39,21 +42,30 @@ struct _ValentBluezMuxer
   ValentObject   parent_instance;
 
   GIOStream     *base_stream;
-  uint16_t       buffer_size;
+  unsigned int   buffer_size;
+  unsigned int   buffer_max;
 
   GHashTable    *states;
   GCancellable  *cancellable;
   unsigned int   protocol_version;
 
-  GThread       *input_thread;
   GInputStream  *input_stream;
   GOutputStream *output_stream;
+
+  /* I/O Thread */
+  GSource       *input_source;
+  GSource       *shrink_source;
+  uint8_t       *input_data;
+  size_t         input_start;
+  size_t         input_end;
+  GPtrArray     *input_flush;
 };
 
 G_DEFINE_FINAL_TYPE (ValentBluezMuxer, valent_bluez_muxer, VALENT_TYPE_OBJECT)
 
 typedef enum {
   PROP_BASE_STREAM = 1,
+  PROP_BUFFER_MAX_SIZE,
   PROP_BUFFER_SIZE,
 } ValentBluezMuxerProperty;
 
@@ -91,6 +103,12 @@ typedef enum
  * @head: data start
  * @tail: data end
  * @count: bytes in the buffer
+ * @size_min: minimum size of the input buffer
+ * @size_max: maximum size of the input buffer
+ * @size_limit: the size the buffer is being shrunk to
+ * @high_water: the most bytes buffered in the current window
+ * @window: monotonic time the current window started
+ * @starved: whether the peer has exhausted the requested bytes
  * @read_free: free space in the input buffer
  * @write_free: amount of bytes that can be written
  *
@@ -99,10 +117,17 @@ typedef enum
  * The @head and @tail offsets refer to the read and write positions,
  * respectively, while @count indicates bytes in the buffer waiting to be read.
  *
- * @read_free is the amount of free space in the buffer for which a
- * %MESSAGE_READ request has not been sent (i.e. @read_free <= @size - @count),
- * while @write_free is the amount of bytes that can be written until another
- * %MESSAGE_READ request is received.
+ * @read_free is the amount of free space in the buffer that has been requested
+ * with %MESSAGE_READ (i.e. @read_free <= @size - @count), while @write_free is
+ * the amount of bytes that can be written until another %MESSAGE_READ request
+ * is received.
+ *
+ * The buffer starts at @size_min and doubles, up to @size_max, when the peer
+ * exhausts the requested bytes while the reader is keeping up. It is halved
+ * again when less than a quarter of it was used in the last window of
+ * %BUFFER_SHRINK_USEC. Bytes already requested can not be revoked, so further
+ * requests are limited to @size_limit until the buffer can be resized, and
+ * the memory is released entirely while the channel is idle.
  */
 typedef struct
 {
@@ -120,9 +145,17 @@ typedef struct
   size_t        tail;
   size_t        count;
 
+  /* Buffer Policy */
+  size_t        size_min;
+  size_t        size_max;
+  size_t        size_limit;
+  size_t        high_water;
+  int64_t       window;
+  unsigned int  starved : 1;
+
   /* Muxer State */
-  uint16_t      read_free;
-  uint16_t      write_free;
+  size_t        read_free;
+  size_t        write_free;
 } ChannelState;
 
 static ChannelState *
@@ -136,8 +169,12 @@ channel_state_new (ValentBluezMuxer *muxer,
   g_mutex_lock (&state->mutex);
   g_cond_init (&state->cond);
   state->uuid = g_strdup (uuid);
-  state->size = muxer->buffer_size;
+  state->size_min = muxer->buffer_size;
+  state->size_max = MAX (muxer->buffer_size, muxer->buffer_max);
+  state->size = state->size_min;
+  state->size_limit = state->size;
   state->buffer = g_malloc0 (state->size);
+  state->window = g_get_monotonic_time ();
   state->stream = g_object_new (VALENT_TYPE_MUX_IO_STREAM,
                                 "muxer", muxer,
                                 "uuid",  uuid,
@@ -190,12 +227,18 @@ channel_state_flush_unlocked (ChannelState  *state,
   return TRUE;
 }
 
+static inline void
+channel_state_hangup_unlocked (ChannelState *state)
+{
+  state->condition &= ~(G_IO_IN | G_IO_OUT);
+  state->condition |= G_IO_HUP;
+}
+
 static inline gboolean
 channel_state_close_unlocked (ChannelState  *state,
                               GError       **error)
 {
-  state->condition &= ~(G_IO_IN | G_IO_OUT);
-  state->condition |= G_IO_HUP;
+  channel_state_hangup_unlocked (state);
 
   return channel_state_flush_unlocked (state, error);
 }
@@ -250,6 +293,106 @@ channel_state_read_unlocked (ChannelState  *state,
   return count;
 }
 
+static inline void
+channel_state_resize_unlocked (ChannelState *state,
+                               size_t        size)
+{
+  uint8_t *buffer;
+  size_t tail_chunk;
+
+  g_assert (size >= state->count + state->read_free);
+
+  /* A released buffer is empty, and is allocated when data arrives
+   */
+  if (state->buffer != NULL)
+    {
+      buffer = g_malloc (size);
+      tail_chunk = MIN (state->size - state->head, state->count);
+      memcpy (buffer, state->buffer + state->head, tail_chunk);
+      memcpy (buffer + tail_chunk, state->buffer, state->count - tail_chunk);
+
+      g_free (state->buffer);
+      state->buffer = buffer;
+    }
+
+  state->size = size;
+  state->size_limit = size;
+  state->head = 0;
+  state->tail = state->count % size;
+  state->high_water = state->count;
+  state->window = g_get_monotonic_time ();
+}
+
+/*
+ * Close the current window, shrinking the buffer if it was mostly unused and
+ * releasing it if nothing was received at all.
+ */
+static inline void
+channel_state_shrink_unlocked (ChannelState *state,
+                               int64_t       now)
+{
+  if (now - state->window < BUFFER_SHRINK_USEC)
+    return;
+
+  if (state->size_limit > state->size_min &&
+      state->high_water < state->size_limit / 4)
+    state->size_limit = MAX (state->size_limit / 2, state->size_min);
+
+  if (state->size_limit < state->size &&
+      state->count + state->read_free <= state->size_limit)
+    channel_state_resize_unlocked (state, state->size_limit);
+
+  if (state->count == 0 && state->high_water == 0)
+    {
+      g_clear_pointer (&state->buffer, g_free);
+      state->head = 0;
+      state->tail = 0;
+    }
+
+  state->high_water = state->count;
+  state->window = now;
+}
+
+/*
+ * Adapt the buffer size to the throughput of the channel, and return the
+ * number of bytes to request from the peer, if any.
+ *
+ * Requests are batched until at least half the buffer is free, so larger
+ * buffers also mean fewer %MESSAGE_READ round trips.
+ */
+static inline size_t
+channel_state_request_unlocked (ChannelState *state)
+{
+  size_t size_request;
+
+  /* Grow if the peer is waiting for a request and the reader is keeping up,
+   * or shrink if the buffer has been mostly unused for a while
+   */
+  if (state->starved && state->count < state->size / 4)
+    {
+      if (state->size < state->size_max)
+        channel_state_resize_unlocked (state, MIN (state->size * 2, state->size_max));
+      else
+        state->size_limit = state->size;
+    }
+  else
+    {
+      channel_state_shrink_unlocked (state, g_get_monotonic_time ());
+    }
+  state->starved = FALSE;
+
+  if (state->count + state->read_free >= state->size_limit)
+    return 0;
+
+  size_request = (state->size_limit - state->count) - state->read_free;
+  if (size_request < state->size_limit / 2)
+    return 0;
+
+  state->read_free += size_request;
+
+  return size_request;
+}
+
 static inline ChannelState *
 channel_state_lookup (ValentBluezMuxer  *self,
                       const char        *uuid,
@@ -341,70 +484,48 @@ unpack_header (const uint8_t *hdr,
 
 /*
  * Receive Helpers
+ *
+ * Every multiplex connection is read by a single I/O thread, shared by all
+ * muxers. Each muxer reads as much as is available into its input buffer,
+ * then dispatches every complete message. Channels are collected in a queue
+ * and signalled once per batch, rather than once per message.
  */
-static inline gboolean
-recv_header (ValentBluezMuxer  *self,
-             MessageType       *type,
-             uint16_t          *size,
-             char              *uuid,
-             GCancellable      *cancellable,
-             GError           **error)
-{
-  uint8_t hdr[HEADER_SIZE] = { 0, };
-  gboolean ret;
-
-  ret = g_input_stream_read_all (self->input_stream,
-                                 hdr,
-                                 sizeof (hdr),
-                                 NULL,
-                                 cancellable,
-                                 error);
-  if (ret)
-    unpack_header (hdr, type, size, uuid);
-
-  return ret;
+static inline void
+flush_queue_add (ValentBluezMuxer *self,
+                 ChannelState     *state)
+{
+  if (!g_ptr_array_find (self->input_flush, state, NULL))
+    g_ptr_array_add (self->input_flush, g_atomic_rc_box_acquire (state));
 }
 
 static inline gboolean
 recv_protocol_version (ValentBluezMuxer  *self,
-                       GCancellable      *cancellable,
+                       const uint8_t     *data,
                        GError           **error)
 {
-  gboolean ret;
-  uint16_t supported_versions[2] = { 0, };
   uint16_t min_version, max_version;
 
-  ret = g_input_stream_read_all (self->input_stream,
-                                 supported_versions,
-                                 sizeof (supported_versions),
-                                 NULL,
-                                 cancellable,
-                                 error);
-  if (ret)
+  min_version = (uint16_t)(data[0] << 8 | data[1]);
+  max_version = (uint16_t)(data[2] << 8 | data[3]);
+  if (min_version > PROTOCOL_MAX)
     {
-      min_version = GUINT16_FROM_BE (supported_versions[0]);
-      max_version = GUINT16_FROM_BE (supported_versions[1]);
-      if (min_version > PROTOCOL_MAX)
-        {
-          g_set_error (error,
-                       G_IO_ERROR,
-                       G_IO_ERROR_NOT_SUPPORTED,
-                       "Protocol version too high (v%u)",
-                       min_version);
-          return FALSE;
-        }
-
-      self->protocol_version = MIN (max_version, PROTOCOL_MAX);
-      VALENT_NOTE ("Using multiplexer protocol v%u", self->protocol_version);
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Protocol version too high (v%u)",
+                   min_version);
+      return FALSE;
     }
 
-  return ret;
+  self->protocol_version = MIN (max_version, PROTOCOL_MAX);
+  VALENT_NOTE ("Using multiplexer protocol v%u", self->protocol_version);
+
+  return TRUE;
 }
 
 static inline gboolean
 recv_open_channel (ValentBluezMuxer  *self,
                    const char        *uuid,
-                   GCancellable      *cancellable,
                    GError           **error)
 {
   gboolean ret = TRUE;
@@ -439,65 +560,57 @@ recv_open_channel (ValentBluezMuxer  *self,
 static inline gboolean
 recv_close_channel (ValentBluezMuxer  *self,
                     const char        *uuid,
-                    GCancellable      *cancellable,
                     GError           **error)
 {
   g_autoptr (ChannelState) state = NULL;
-  gboolean ret;
 
   state = channel_state_lookup (self, uuid, NULL);
   if (state == NULL)
     return TRUE;
 
   g_mutex_lock (&state->mutex);
-  ret = channel_state_close_unlocked (state, error);
+  channel_state_hangup_unlocked (state);
   g_mutex_unlock (&state->mutex);
 
-  return ret;
+  flush_queue_add (self, state);
+
+  return TRUE;
 }
 
 static inline gboolean
 recv_read (ValentBluezMuxer  *self,
            const char        *uuid,
-           GCancellable      *cancellable,
+           const uint8_t     *data,
            GError           **error)
 {
   g_autoptr (ChannelState) state = NULL;
   uint16_t size_request;
-  gboolean ret;
 
   state = channel_state_lookup (self, uuid, error);
   if (state == NULL)
     return FALSE;
 
-  ret = g_input_stream_read_all (self->input_stream,
-                                 &size_request,
-                                 sizeof (size_request),
-                                 NULL,
-                                 cancellable,
-                                 error);
-  if (ret)
-    {
-      g_mutex_lock (&state->mutex);
-      state->write_free += GUINT16_FROM_BE (size_request);
-      state->condition |= G_IO_OUT;
-      ret = channel_state_flush_unlocked (state, error);
-      g_mutex_unlock (&state->mutex);
-    }
+  size_request = (uint16_t)(data[0] << 8 | data[1]);
 
-  return ret;
+  g_mutex_lock (&state->mutex);
+  state->write_free += size_request;
+  state->condition |= G_IO_OUT;
+  g_mutex_unlock (&state->mutex);
+
+  flush_queue_add (self, state);
+
+  return TRUE;
 }
 
 static inline gboolean
 recv_write (ValentBluezMuxer  *self,
             const char        *uuid,
+            const uint8_t     *data,
             uint16_t           size,
-            GCancellable      *cancellable,
             GError           **error)
 {
   g_autoptr (ChannelState) state = NULL;
   size_t tail_free;
-  gboolean ret;
 
   state = channel_state_lookup (self, uuid, error);
   if (state == NULL)
@@ -509,100 +622,281 @@ recv_write (ValentBluezMuxer  *self,
       g_set_error (error,
                    G_IO_ERROR,
                    G_IO_ERROR_MESSAGE_TOO_LARGE,
-                   "Write size (%u) exceeds requested (%u)",
+                   "Write size (%u) exceeds requested (%zu)",
                    size, state->read_free);
       g_mutex_unlock (&state->mutex);
       return FALSE;
     }
 
-  tail_free = MIN (state->size - state->tail, size);
-  ret = g_input_stream_read_all (self->input_stream,
-                                 &state->buffer[state->tail],
-                                 tail_free,
-                                 NULL,
-                                 cancellable,
-                                 error);
-  if (ret && size > tail_free)
-    {
-      ret = g_input_stream_read_all (self->input_stream,
-                                     &state->buffer[0],
-                                     size - tail_free,
-                                     NULL,
-                                     cancellable,
-                                     error);
-    }
+  if G_UNLIKELY (state->buffer == NULL)
+    state->buffer = g_malloc (state->size);
 
-  if (ret)
-    {
-      state->tail = (state->tail + size) % state->size;
-      state->count += size;
-      state->read_free -= size;
-      state->condition |= G_IO_IN;
-      ret = channel_state_flush_unlocked (state, error);
-    }
+  tail_free = MIN (state->size - state->tail, size);
+  memcpy (&state->buffer[state->tail], data, tail_free);
+  if (size > tail_free)
+    memcpy (&state->buffer[0], data + tail_free, size - tail_free);
+
+  state->tail = (state->tail + size) % state->size;
+  state->count += size;
+  state->read_free -= size;
+  state->high_water = MAX (state->high_water, state->count);
+  state->starved = (state->read_free == 0);
+  state->condition |= G_IO_IN;
   g_mutex_unlock (&state->mutex);
 
-  return ret;
+  flush_queue_add (self, state);
+
+  return TRUE;
 }
 
-static gpointer
-valent_bluez_muxer_receive_loop (gpointer data)
+static gboolean
+recv_messages (ValentBluezMuxer  *self,
+               GError           **error)
 {
-  g_autoptr (ValentBluezMuxer) self = VALENT_BLUEZ_MUXER (data);
-  MessageType type;
-  uint16_t size;
-  char uuid[37] = { 0, };
-  g_autoptr (GError) error = NULL;
+  gboolean ret = TRUE;
 
-  while (recv_header (self, &type, &size, uuid, self->cancellable, &error))
+  while (ret && self->input_end - self->input_start >= HEADER_SIZE)
     {
+      const uint8_t *message = &self->input_data[self->input_start];
+      const uint8_t *data = message + HEADER_SIZE;
+      MessageType type;
+      uint16_t size;
+      size_t length;
+      char uuid[37] = { 0, };
+
+      unpack_header (message, &type, &size, uuid);
       switch ((MessageType)type)
         {
         case MESSAGE_PROTOCOL_VERSION:
-          if (!recv_protocol_version (self, self->cancellable, &error))
-            VALENT_GOTO (out);
+          length = 4;
           break;
 
         case MESSAGE_OPEN_CHANNEL:
-          if (!recv_open_channel (self, uuid, self->cancellable, &error))
-            VALENT_GOTO (out);
-          break;
-
         case MESSAGE_CLOSE_CHANNEL:
-          if (!recv_close_channel (self, uuid, self->cancellable, &error))
-            VALENT_GOTO (out);
+          length = 0;
           break;
 
         case MESSAGE_READ:
-          if (!recv_read (self, uuid, self->cancellable, &error))
-            VALENT_GOTO (out);
+          length = 2;
           break;
 
         case MESSAGE_WRITE:
-          if (!recv_write (self, uuid, size, self->cancellable, &error))
-            VALENT_GOTO (out);
+          length = size;
           break;
 
         default:
-          g_set_error (&error,
+          g_set_error (error,
                        G_IO_ERROR,
                        G_IO_ERROR_INVALID_ARGUMENT,
                        "Unknown message type (%u)",
                        type);
-          VALENT_GOTO (out);
+          ret = FALSE;
+          continue;
         }
+
+      /* Wait for the rest of the message
+       */
+      if (self->input_end - self->input_start < HEADER_SIZE + length)
+        break;
+
+      switch ((MessageType)type)
+        {
+        case MESSAGE_PROTOCOL_VERSION:
+          ret = recv_protocol_version (self, data, error);
+          break;
+
+        case MESSAGE_OPEN_CHANNEL:
+          ret = recv_open_channel (self, uuid, error);
+          break;
+
+        case MESSAGE_CLOSE_CHANNEL:
+          ret = recv_close_channel (self, uuid, error);
+          break;
+
+        case MESSAGE_READ:
+          ret = recv_read (self, uuid, data, error);
+          break;
+
+        case MESSAGE_WRITE:
+          ret = recv_write (self, uuid, data, size, error);
+          break;
+        }
+
+      self->input_start += HEADER_SIZE + length;
+    }
+
+  /* Signal each channel once for the batch
+   */
+  for (unsigned int i = 0; i < self->input_flush->len; i++)
+    {
+      ChannelState *state = g_ptr_array_index (self->input_flush, i);
+
+      g_mutex_lock (&state->mutex);
+      if (!channel_state_flush_unlocked (state, ret ? error : NULL))
+        ret = FALSE;
+      g_mutex_unlock (&state->mutex);
+    }
+  g_ptr_array_set_size (self->input_flush, 0);
+
+  return ret;
+}
+
+static gboolean
+valent_bluez_muxer_input_cb (GPollableInputStream *stream,
+                             gpointer              user_data)
+{
+  ValentBluezMuxer *self = VALENT_BLUEZ_MUXER (user_data);
+  gssize n_read;
+  g_autoptr (GError) error = NULL;
+
+  /* Move any partial message to the start of the buffer; a complete message
+   * is always smaller than the buffer
+   */
+  if (self->input_start > 0)
+    {
+      memmove (self->input_data,
+               &self->input_data[self->input_start],
+               self->input_end - self->input_start);
+      self->input_end -= self->input_start;
+      self->input_start = 0;
+    }
+
+  n_read = g_pollable_input_stream_read_nonblocking (stream,
+                                                     &self->input_data[self->input_end],
+                                                     INPUT_BUFFER_SIZE - self->input_end,
+                                                     self->cancellable,
+                                                     &error);
+  if (n_read > 0)
+    {
+      self->input_end += n_read;
+      if (recv_messages (self, &error))
+        return G_SOURCE_CONTINUE;
+    }
+  else if (n_read == 0)
+    {
+      g_set_error_literal (&error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_CONNECTION_CLOSED,
+                           "Connection closed");
+    }
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+    {
+      return G_SOURCE_CONTINUE;
     }
 
-out:
   if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
       g_debug ("%s(): %s", G_STRFUNC, error->message);
       valent_bluez_muxer_close (self, NULL, NULL);
     }
 
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer
+valent_bluez_muxer_io_thread (gpointer data)
+{
+  GMainContext *context = (GMainContext *)data;
+
+  g_main_context_push_thread_default (context);
+  while (TRUE)
+    g_main_context_iteration (context, TRUE);
+
   return NULL;
 }
 
+/*
+ * The I/O context shared by all muxers. Like the GDBus worker thread, it is
+ * started on first use and lives for the rest of the process.
+ */
+static GMainContext *
+valent_bluez_muxer_get_io_context (void)
+{
+  static GMainContext *io_context = NULL;
+
+  if (g_once_init_enter_pointer (&io_context))
+    {
+      GMainContext *context = g_main_context_new ();
+      GThread *thread = NULL;
+
+      thread = g_thread_new ("valent-bluez-muxer",
+                             valent_bluez_muxer_io_thread,
+                             g_main_context_ref (context));
+      g_thread_unref (thread);
+
+      g_once_init_leave_pointer (&io_context, context);
+    }
+
+  return io_context;
+}
+
+/*
+ * Buffers are otherwise only resized when the channel is read from, so check
+ * idle channels periodically.
+ */
+static gboolean
+valent_bluez_muxer_shrink_cb (gpointer data)
+{
+  ValentBluezMuxer *self = VALENT_BLUEZ_MUXER (data);
+  GHashTableIter iter;
+  ChannelState *state;
+  int64_t now;
+
+  now = g_get_monotonic_time ();
+
+  valent_object_lock (VALENT_OBJECT (self));
+  g_hash_table_iter_init (&iter, self->states);
+  while (g_hash_table_iter_next (&iter, NULL, (void **)&state))
+    {
+      g_mutex_lock (&state->mutex);
+      channel_state_shrink_unlocked (state, now);
+      g_mutex_unlock (&state->mutex);
+    }
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+valent_bluez_muxer_start (ValentBluezMuxer  *self,
+                          GError           **error)
+{
+  gboolean ret = TRUE;
+
+  valent_object_lock (VALENT_OBJECT (self));
+  if (!G_IS_POLLABLE_INPUT_STREAM (self->input_stream) ||
+      !g_pollable_input_stream_can_poll (G_POLLABLE_INPUT_STREAM (self->input_stream)))
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_NOT_SUPPORTED,
+                           "Base stream is not pollable");
+      ret = FALSE;
+    }
+  else if (self->input_source == NULL)
+    {
+      self->input_source = g_pollable_input_stream_create_source (G_POLLABLE_INPUT_STREAM (self->input_stream),
+                                                                  self->cancellable);
+      g_source_set_callback (self->input_source,
+                             G_SOURCE_FUNC (valent_bluez_muxer_input_cb),
+                             g_object_ref (self),
+                             g_object_unref);
+      g_source_set_static_name (self->input_source, "[valent-bluez-muxer]");
+      g_source_attach (self->input_source, valent_bluez_muxer_get_io_context ());
+
+      self->shrink_source = g_timeout_source_new (BUFFER_SHRINK_USEC / 1000);
+      g_source_set_callback (self->shrink_source,
+                             G_SOURCE_FUNC (valent_bluez_muxer_shrink_cb),
+                             g_object_ref (self),
+                             g_object_unref);
+      g_source_set_static_name (self->shrink_source, "[valent-bluez-muxer] shrink");
+      g_source_attach (self->shrink_source, valent_bluez_muxer_get_io_context ());
+    }
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  return ret;
+}
+
 static inline gboolean
 send_protocol_version (ValentBluezMuxer  *self,
                        GCancellable      *cancellable,
@@ -662,24 +956,39 @@ send_close_channel (ValentBluezMuxer  *self,
                                     error);
 }
 
+/*
+ * A %MESSAGE_READ request is limited to %G_MAXUINT16 bytes, so larger requests
+ * are split into several messages and sent in a single write.
+ */
 static inline gboolean
 send_read (ValentBluezMuxer  *self,
            const char        *uuid,
-           uint16_t           size_request,
+           size_t             size_request,
            GCancellable      *cancellable,
            GError           **error)
 {
-  uint8_t message[HEADER_SIZE + 2] = { 0, };
+  g_autofree uint8_t *message = NULL;
+  size_t n_messages;
+
+  n_messages = (size_request + G_MAXUINT16 - 1) / G_MAXUINT16;
+  message = g_new0 (uint8_t, n_messages * (HEADER_SIZE + 2));
 
-  /* Pack the request big-endian
+  /* Pack the requests big-endian
    */
-  pack_header (message, MESSAGE_READ, 2, uuid);
-  message[HEADER_SIZE + 0] = (size_request >> 8) & 0xff;
-  message[HEADER_SIZE + 1] = size_request & 0xff;
+  for (size_t i = 0; i < n_messages; i++)
+    {
+      uint8_t *hdr = message + i * (HEADER_SIZE + 2);
+      uint16_t size = MIN (size_request, G_MAXUINT16);
+
+      pack_header (hdr, MESSAGE_READ, 2, uuid);
+      hdr[HEADER_SIZE + 0] = (size >> 8) & 0xff;
+      hdr[HEADER_SIZE + 1] = size & 0xff;
+      size_request -= size;
+    }
 
   return g_output_stream_write_all (self->output_stream,
-                                    &message,
-                                    sizeof (message),
+                                    message,
+                                    n_messages * (HEADER_SIZE + 2),
                                     NULL,
                                     cancellable,
                                     error);
@@ -758,6 +1067,10 @@ valent_bluez_muxer_finalize (GObject *object)
   g_clear_object (&self->base_stream);
   g_clear_object (&self->cancellable);
   g_clear_pointer (&self->states, g_hash_table_unref);
+  g_clear_pointer (&self->input_source, g_source_unref);
+  g_clear_pointer (&self->shrink_source, g_source_unref);
+  g_clear_pointer (&self->input_data, g_free);
+  g_clear_pointer (&self->input_flush, g_ptr_array_unref);
   valent_object_unlock (VALENT_OBJECT (self));
 
   G_OBJECT_CLASS (valent_bluez_muxer_parent_class)->finalize (object);
@@ -777,8 +1090,16 @@ valent_bluez_muxer_get_property (GObject    *object,
       g_value_set_object (value, self->base_stream);
       break;
 
+    case PROP_BUFFER_MAX_SIZE:
+      valent_object_lock (VALENT_OBJECT (self));
+      g_value_set_uint (value, self->buffer_max);
+      valent_object_unlock (VALENT_OBJECT (self));
+      break;
+
     case PROP_BUFFER_SIZE:
+      valent_object_lock (VALENT_OBJECT (self));
       g_value_set_uint (value, self->buffer_size);
+      valent_object_unlock (VALENT_OBJECT (self));
       break;
 
     default:
@@ -786,6 +1107,26 @@ valent_bluez_muxer_get_property (GObject    *object,
     }
 }
 
+static void
+valent_bluez_muxer_set_buffer_policy (ValentBluezMuxer *self,
+                                      unsigned int     *field,
+                                      unsigned int      value,
+                                      GParamSpec       *pspec)
+{
+  gboolean changed = FALSE;
+
+  valent_object_lock (VALENT_OBJECT (self));
+  if (*field != value)
+    {
+      *field = value;
+      changed = TRUE;
+    }
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  if (changed)
+    g_object_notify_by_pspec (G_OBJECT (self), pspec);
+}
+
 static void
 valent_bluez_muxer_set_property (GObject      *object,
                                  guint         prop_id,
@@ -800,8 +1141,18 @@ valent_bluez_muxer_set_property (GObject      *object,
       self->base_stream = g_value_dup_object (value);
       break;
 
+    case PROP_BUFFER_MAX_SIZE:
+      valent_bluez_muxer_set_buffer_policy (self,
+                                            &self->buffer_max,
+                                            g_value_get_uint (value),
+                                            pspec);
+      break;
+
     case PROP_BUFFER_SIZE:
-      self->buffer_size = g_value_get_uint (value);
+      valent_bluez_muxer_set_buffer_policy (self,
+                                            &self->buffer_size,
+                                            g_value_get_uint (value),
+                                            pspec);
       break;
 
     default:
@@ -835,17 +1186,38 @@ valent_bluez_muxer_class_init (ValentBluezMuxerClass *klass)
                           G_PARAM_EXPLICIT_NOTIFY |
                           G_PARAM_STATIC_STRINGS));
 
+  /**
+   * ValentBluezMuxer:buffer-max-size:
+   *
+   * Maximum size of the input buffer for each multiplex channel.
+   *
+   * Changes only apply to channels opened afterwards. If this is less than
+   * [property@Valent.BluezMuxer:buffer-size], the buffer has a fixed size.
+   */
+  properties [PROP_BUFFER_MAX_SIZE] =
+    g_param_spec_uint ("buffer-max-size", NULL, NULL,
+                       1024, DEFAULT_BUFFER_MAX * 16,
+                       DEFAULT_BUFFER_MAX,
+                       (G_PARAM_READWRITE |
+                        G_PARAM_CONSTRUCT |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
   /**
    * ValentBluezMuxer:buffer-size:
    *
-   * Size of the input buffer allocated to each multiplex channel.
+   * Initial size of the input buffer for each multiplex channel.
+   *
+   * Each buffer grows with the throughput of its channel, up to
+   * [property@Valent.BluezMuxer:buffer-max-size], and shrinks back towards
+   * this size when idle. Changes only apply to channels opened afterwards.
    */
   properties [PROP_BUFFER_SIZE] =
     g_param_spec_uint ("buffer-size", NULL, NULL,
-                       1024, G_MAXUINT16,
+                       1024, DEFAULT_BUFFER_MAX * 16,
                        DEFAULT_BUFFER_SIZE,
                        (G_PARAM_READWRITE |
-                        G_PARAM_CONSTRUCT_ONLY |
+                        G_PARAM_CONSTRUCT |
                         G_PARAM_EXPLICIT_NOTIFY |
                         G_PARAM_STATIC_STRINGS));
 
@@ -862,6 +1234,8 @@ valent_bluez_muxer_init (ValentBluezMuxer *self)
                                         g_str_equal,
                                         NULL,
                                         channel_state_unref);
+  self->input_data = g_malloc (INPUT_BUFFER_SIZE);
+  self->input_flush = g_ptr_array_new_with_free_func (channel_state_unref);
   valent_object_unlock (VALENT_OBJECT (self));
 }
 
@@ -881,6 +1255,7 @@ typedef struct
   GIOStream      *connection;
   JsonNode       *identity;
   JsonNode       *peer_identity;
+  GBytes         *unread;
   HandshakeFlags  flags;
 } HandshakeData;
 
@@ -892,6 +1267,7 @@ handshake_data_free (gpointer user_data)
   g_clear_object (&data->connection);
   g_clear_pointer (&data->identity, json_node_unref);
   g_clear_pointer (&data->peer_identity, json_node_unref);
+  g_clear_pointer (&data->unread, g_bytes_unref);
   g_free (data);
 }
 
@@ -959,6 +1335,10 @@ handshake_task_complete (GTask *task)
                           "peer-identity",    data->peer_identity,
                           "muxer",            self,
                           NULL);
+
+  if (data->unread != NULL)
+    valent_channel_push_input (channel, data->unread);
+
   g_task_return_pointer (task, g_object_ref (channel), g_object_unref);
 }
 
@@ -972,7 +1352,10 @@ handshake_read_identity_cb (GInputStream *stream,
   g_autoptr (JsonNode) secure_identity = NULL;
   GError *error = NULL;
 
-  secure_identity = valent_packet_from_stream_finish (stream, result, &error);
+  secure_identity = valent_packet_from_stream_full_finish (stream,
+                                                           result,
+                                                           &data->unread,
+                                                           &error);
   if (secure_identity == NULL)
     {
       if ((data->flags & HANDSHAKE_FAILED) == 0)
@@ -1036,11 +1419,7 @@ handshake_protocol_task_cb (GObject      *object,
       return;
     }
 
-  self->input_thread = g_thread_try_new ("valent-bluez-muxer",
-                                         valent_bluez_muxer_receive_loop,
-                                         g_object_ref (self),
-                                         &error);
-  if (self->input_thread == NULL)
+  if (!valent_bluez_muxer_start (self, &error))
     {
       g_task_return_error (task, g_steal_pointer (&error));
       return;
@@ -1052,11 +1431,12 @@ handshake_protocol_task_cb (GObject      *object,
                            cancellable,
                            (GAsyncReadyCallback)handshake_write_identity_cb,
                            g_object_ref (task));
-  valent_packet_from_stream (g_io_stream_get_input_stream (data->connection),
-                             IDENTITY_BUFFER_MAX,
-                             cancellable,
-                             (GAsyncReadyCallback)handshake_read_identity_cb,
-                             g_object_ref (task));
+  valent_packet_from_stream_full (g_io_stream_get_input_stream (data->connection),
+                                  IDENTITY_BUFFER_MAX,
+                                  0,
+                                  cancellable,
+                                  (GAsyncReadyCallback)handshake_read_identity_cb,
+                                  g_object_ref (task));
 }
 
 static void
@@ -1068,7 +1448,7 @@ handshake_protocol_task (GTask        *task,
   ValentBluezMuxer *self = VALENT_BLUEZ_MUXER (source_object);
   ChannelState *state = (ChannelState *)task_data;
   g_autoptr (GIOStream) ret = NULL;
-  uint16_t size_request;
+  size_t size_request;
   GError *error = NULL;
 
   g_mutex_lock (&state->mutex);
@@ -1197,20 +1577,28 @@ valent_bluez_muxer_close (ValentBluezMuxer  *muxer,
   g_assert (VALENT_IS_BLUEZ_MUXER (muxer));
 
   valent_object_lock (VALENT_OBJECT (muxer));
-  ret = g_io_stream_close (muxer->base_stream, cancellable, error);
-  if (muxer->input_thread != NULL && muxer->input_thread != g_thread_self ())
+  g_cancellable_cancel (muxer->cancellable);
+  if (muxer->input_source != NULL)
     {
-      g_cancellable_cancel (muxer->cancellable);
-      g_thread_join (g_steal_pointer (&muxer->input_thread));
+      g_source_destroy (muxer->input_source);
+      g_clear_pointer (&muxer->input_source, g_source_unref);
+    }
 
-      g_hash_table_iter_init (&iter, muxer->states);
-      while (g_hash_table_iter_next (&iter, NULL, (void **)&state))
-        {
-          g_mutex_lock (&state->mutex);
-          channel_state_close_unlocked (state, NULL);
-          g_mutex_unlock (&state->mutex);
-          g_hash_table_iter_remove (&iter);
-        }
+  if (muxer->shrink_source != NULL)
+    {
+      g_source_destroy (muxer->shrink_source);
+      g_clear_pointer (&muxer->shrink_source, g_source_unref);
+    }
+
+  ret = g_io_stream_close (muxer->base_stream, cancellable, error);
+
+  g_hash_table_iter_init (&iter, muxer->states);
+  while (g_hash_table_iter_next (&iter, NULL, (void **)&state))
+    {
+      g_mutex_lock (&state->mutex);
+      channel_state_close_unlocked (state, NULL);
+      g_mutex_unlock (&state->mutex);
+      g_hash_table_iter_remove (&iter);
     }
   valent_object_unlock (VALENT_OBJECT (muxer));
 
@@ -1249,7 +1637,7 @@ valent_bluez_muxer_channel_accept (ValentBluezMuxer  *muxer,
       state = channel_state_lookup (muxer, uuid, NULL);
       if (state != NULL)
         {
-          uint16_t size_request;
+          size_t size_request;
 
           g_mutex_lock (&state->mutex);
           state->read_free += state->size;
@@ -1374,7 +1762,7 @@ valent_bluez_muxer_channel_open (ValentBluezMuxer  *muxer,
                                  GError           **error)
 {
   g_autoptr (ChannelState) state = NULL;
-  uint16_t size_request;
+  size_t size_request;
   GIOStream *ret = NULL;
 
   g_assert (VALENT_IS_BLUEZ_MUXER (muxer));
@@ -1447,7 +1835,7 @@ valent_bluez_muxer_channel_read (ValentBluezMuxer  *muxer,
 {
   g_autoptr (ChannelState) state = NULL;
   gssize read;
-  uint16_t size_request = 0;
+  size_t size_request = 0;
 
   g_assert (VALENT_IS_BLUEZ_MUXER (muxer));
   g_assert (g_uuid_string_is_valid (uuid));
@@ -1496,11 +1884,7 @@ valent_bluez_muxer_channel_read (ValentBluezMuxer  *muxer,
       return read;
     }
 
-  size_request = (state->size - state->count) - state->read_free;
-  if ((double)size_request < state->size * 0.5)
-    size_request = 0;
-  else
-    state->read_free += size_request;
+  size_request = channel_state_request_unlocked (state);
   g_mutex_unlock (&state->mutex);
 
   /* Any failure sending a multiplex message closes the connection,
@@ -1601,7 +1985,7 @@ valent_bluez_muxer_channel_write (ValentBluezMuxer  *muxer,
       return -1;
     }
 
-  written = MIN (count, state->write_free);
+  written = MIN (count, MIN (state->write_free, G_MAXUINT16));
   state->write_free -= written;
   if (state->write_free == 0)
     state->condition &= ~G_IO_OUT;
@@ -1799,3 +2183,35 @@ valent_bluez_muxer_condition_check (ValentBluezMuxer *muxer,
   return ret;
 }
 
+
+/**
+ * valent_bluez_muxer_channel_get_buffer_size:
+ * @muxer: a `ValentBluezMuxer`
+ * @uuid: a channel UUID
+ *
+ * Get the number of bytes allocated for the input buffer of @uuid, which is
+ * zero while the buffer is released.
+ *
+ * Returns: the size of the input buffer
+ */
+size_t
+valent_bluez_muxer_channel_get_buffer_size (ValentBluezMuxer *muxer,
+                                            const char       *uuid)
+{
+  g_autoptr (ChannelState) state = NULL;
+  size_t ret = 0;
+
+  g_assert (VALENT_IS_BLUEZ_MUXER (muxer));
+  g_assert (g_uuid_string_is_valid (uuid));
+
+  state = channel_state_lookup (muxer, uuid, NULL);
+  if (state == NULL)
+    return 0;
+
+  g_mutex_lock (&state->mutex);
+  if (state->buffer != NULL)
+    ret = state->size;
+  g_mutex_unlock (&state->mutex);
+
+  return ret;
+}
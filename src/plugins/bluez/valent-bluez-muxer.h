@@ -58,5 +58,7 @@ GSource          * valent_bluez_muxer_create_source    (ValentBluezMuxer     *mu
 GIOCondition       valent_bluez_muxer_condition_check  (ValentBluezMuxer     *muxer,
                                                         const char           *uuid,
                                                         GIOCondition          condition);
+size_t             valent_bluez_muxer_channel_get_buffer_size (ValentBluezMuxer *muxer,
+                                                               const char       *uuid);
 
 G_END_DECLS
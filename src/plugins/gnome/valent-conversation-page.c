@@ -149,6 +149,21 @@ message_list_header_func (GtkListBoxRow *row,
     }
 }
 
+/*< private >
+ * message_is_placeholder:
+ * @message: a `ValentMessage`
+ *
+ * Check if @message is a placeholder for a message that hasn't loaded yet,
+ * which is replaced by the thread once it has.
+ *
+ * Returns: %TRUE if @message is a placeholder
+ */
+static inline gboolean
+message_is_placeholder (ValentMessage *message)
+{
+  return valent_object_get_iri (VALENT_OBJECT (message)) == NULL;
+}
+
 /*< private >
  * valent_conversation_page_insert_message:
  * @conversation: a `ValentConversationPage`
@@ -177,6 +192,16 @@ valent_conversation_page_insert_message (ValentConversationPage *self,
                       "selectable",  FALSE,
                       NULL);
 
+  /* Placeholders hold their position in the list, but stay hidden until
+   * they are replaced
+   */
+  if (message_is_placeholder (message))
+    {
+      gtk_widget_set_visible (GTK_WIDGET (row), FALSE);
+      gtk_list_box_insert (self->message_list, GTK_WIDGET (row), position);
+      return GTK_WIDGET (row);
+    }
+
   medium = valent_message_get_sender (message);
   if (medium != NULL && *medium != '\0')
     {
@@ -544,12 +569,18 @@ on_thread_items_changed (GListModel            *model,
       for (unsigned int i = 0; i < added; i++)
         {
           g_autoptr (ValentMessage) message = NULL;
+          gboolean is_new;
 
+          /* Replacing a placeholder doesn't make the message new
+           */
           message = g_list_model_get_item (self->thread, position + i);
+          is_new = position >= position_bottom &&
+                   removed == 0 &&
+                   !message_is_placeholder (message);
 
           /* If this is new message, check if it matches an outbox row.
            */
-          if (position >= position_bottom)
+          if (is_new)
             valent_conversation_page_clear_outbox (self, message);
 
           valent_conversation_page_insert_message (self,
@@ -558,7 +589,7 @@ on_thread_items_changed (GListModel            *model,
 
           /* If this is new message, announce it for AT devices.
            */
-          if (position >= position_bottom)
+          if (is_new)
             valent_conversation_page_announce_message (self, message);
         }
     }
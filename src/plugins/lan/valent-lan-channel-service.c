@@ -17,6 +17,15 @@
 
 #define HANDSHAKE_TIMEOUT_MS (1000)
 #define IDENTITY_BUFFER_MAX  (8192)
+#define TRANSFER_PORTS_N     (VALENT_LAN_TRANSFER_PORT_MAX - VALENT_LAN_TRANSFER_PORT_MIN + 1)
+
+G_STATIC_ASSERT (TRANSFER_PORTS_N <= 32);
+
+#define DISCOVERY_BACKOFF_MIN_MS (1000)
+#define DISCOVERY_BACKOFF_MAX_MS (60000)
+#define DISCOVERY_BURST          (5)
+#define DISCOVERY_REFILL_MS      (1000)
+#define DISCOVERY_TABLE_MAX      (256)
 
 #if (VALENT_SANITIZE_ADDRESS || VALENT_SANITIZE_THREAD)
 #undef HANDSHAKE_TIMEOUT_MS
@@ -39,6 +48,21 @@ struct _ValentLanChannelService
   GSocket              *udp_socket4;
   GSocket              *udp_socket6;
   GHashTable           *channels;
+  GBytes               *identity_bytes;
+  GPtrArray            *announce_queue[2];
+  GSource              *announce_source[2];
+
+  /* Auxiliary connections */
+  GSocketService       *transfer_listener;
+  uint32_t              transfer_bound;
+  uint32_t              transfer_busy;
+  GTask                *transfer_tasks[TRANSFER_PORTS_N];
+
+  /* Discovery */
+  GHashTable           *discovery_peers;
+  GHashTable           *discovery_buckets;
+  uint64_t              discovery_accepted;
+  uint64_t              discovery_suppressed;
 };
 
 static void   g_initable_iface_init (GInitableIface *iface);
@@ -48,6 +72,8 @@ G_DEFINE_FINAL_TYPE_WITH_CODE (ValentLanChannelService, valent_lan_channel_servi
 
 typedef enum {
   PROP_BROADCAST_ADDRESS = 1,
+  PROP_DISCOVERY_ACCEPTED,
+  PROP_DISCOVERY_SUPPRESSED,
   PROP_PORT,
 } ValentLanChannelServiceProperty;
 
@@ -91,6 +117,266 @@ on_channel_destroyed (ValentLanChannelService *self,
   g_hash_table_remove (self->channels, device_id);
 }
 
+/*
+ * Discovery
+ *
+ * Each UDP identity packet may start an outgoing handshake, so broadcasts are
+ * filtered before one is spawned. Broadcasts are suppressed if the device is
+ * already connected at the same address, if a handshake for the device is
+ * already running, or if a previous handshake failed and the device is backing
+ * off. Each source address is also limited by a token bucket.
+ *
+ * The device ID of a broadcast is unauthenticated, so handshake state is keyed
+ * by source address and device ID; otherwise any host could put a device into
+ * backoff by broadcasting its ID. Both tables are bounded, evicting the least
+ * recently updated entry if no entry is idle.
+ */
+typedef struct
+{
+  int64_t       updated;
+  gboolean      in_flight;
+  unsigned int  failures;
+  int64_t       retry_after;
+} DiscoveryPeer;
+
+typedef struct
+{
+  int64_t       updated;
+  double        tokens;
+} DiscoveryBucket;
+
+G_STATIC_ASSERT (G_STRUCT_OFFSET (DiscoveryPeer, updated) == 0);
+G_STATIC_ASSERT (G_STRUCT_OFFSET (DiscoveryBucket, updated) == 0);
+
+static inline char *
+discovery_peer_key (const char *device_id,
+                    const char *host)
+{
+  return g_strdup_printf ("%s|%s", host, device_id);
+}
+
+static gboolean
+discovery_bucket_take (DiscoveryBucket *bucket,
+                       int64_t          now)
+{
+  double elapsed_ms = (double)(now - bucket->updated) / 1000.0;
+
+  bucket->tokens = MIN (bucket->tokens + (elapsed_ms / DISCOVERY_REFILL_MS),
+                        DISCOVERY_BURST);
+  bucket->updated = now;
+
+  if (bucket->tokens < 1.0)
+    return FALSE;
+
+  bucket->tokens -= 1.0;
+  return TRUE;
+}
+
+static gboolean
+discovery_bucket_is_idle (gpointer key,
+                          gpointer value,
+                          gpointer user_data)
+{
+  DiscoveryBucket *bucket = (DiscoveryBucket *)value;
+  int64_t now = *(int64_t *)user_data;
+
+  return (now - bucket->updated) / 1000 >= DISCOVERY_BURST * DISCOVERY_REFILL_MS;
+}
+
+static gboolean
+discovery_peer_is_idle (gpointer key,
+                        gpointer value,
+                        gpointer user_data)
+{
+  DiscoveryPeer *peer = (DiscoveryPeer *)value;
+  int64_t now = *(int64_t *)user_data;
+
+  return !peer->in_flight && peer->retry_after <= now;
+}
+
+static void
+discovery_table_reserve (GHashTable *table,
+                         GHRFunc     is_idle,
+                         int64_t     now)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  gpointer oldest_key = NULL;
+  int64_t oldest = G_MAXINT64;
+
+  if (g_hash_table_size (table) < DISCOVERY_TABLE_MAX)
+    return;
+
+  g_hash_table_foreach_remove (table, is_idle, &now);
+  if (g_hash_table_size (table) < DISCOVERY_TABLE_MAX)
+    return;
+
+  /* Each entry type begins with the time it was last updated
+   */
+  g_hash_table_iter_init (&iter, table);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      int64_t updated = *(int64_t *)value;
+
+      if (updated < oldest)
+        {
+          oldest = updated;
+          oldest_key = key;
+        }
+    }
+
+  if (oldest_key != NULL)
+    g_hash_table_remove (table, oldest_key);
+}
+
+/*< private >
+ * valent_lan_channel_service_discovery_allow:
+ * @self: a `ValentLanChannelService`
+ * @device_id: the ID of the broadcasting device
+ * @host: the source address of the broadcast
+ *
+ * Decide whether a broadcast from @device_id at @host should start an outgoing
+ * handshake. If %TRUE is returned, the device is marked as in-flight until
+ * valent_lan_channel_service_discovery_done() is called.
+ *
+ * Returns: %TRUE if the handshake should proceed, or %FALSE if suppressed
+ */
+static gboolean
+valent_lan_channel_service_discovery_allow (ValentLanChannelService *self,
+                                            const char              *device_id,
+                                            const char              *host)
+{
+  ValentChannel *channel = NULL;
+  DiscoveryBucket *bucket = NULL;
+  DiscoveryPeer *peer = NULL;
+  g_autofree char *key = NULL;
+  int64_t now = g_get_monotonic_time ();
+
+  g_assert (VALENT_IS_MAIN_THREAD ());
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (self));
+  g_assert (device_id != NULL && host != NULL);
+
+  /* A device that restarted or moved to a new address must be allowed to
+   * reconnect, so only a matching address counts as connected.
+   */
+  channel = g_hash_table_lookup (self->channels, device_id);
+  if (channel != NULL)
+    {
+      g_autofree char *channel_host = NULL;
+
+      g_object_get (channel, "host", &channel_host, NULL);
+      if (g_strcmp0 (channel_host, host) == 0)
+        {
+          VALENT_NOTE ("%s: already connected", device_id);
+          goto suppress;
+        }
+    }
+
+  key = discovery_peer_key (device_id, host);
+  peer = g_hash_table_lookup (self->discovery_peers, key);
+  if (peer != NULL)
+    peer->updated = now;
+
+  if (peer != NULL && peer->in_flight)
+    {
+      VALENT_NOTE ("%s: handshake in progress", device_id);
+      goto suppress;
+    }
+
+  if (peer != NULL && peer->retry_after > now)
+    {
+      VALENT_NOTE ("%s: backing off after %u failures", device_id, peer->failures);
+      goto suppress;
+    }
+
+  bucket = g_hash_table_lookup (self->discovery_buckets, host);
+  if (bucket == NULL)
+    {
+      discovery_table_reserve (self->discovery_buckets,
+                               discovery_bucket_is_idle,
+                               now);
+
+      bucket = g_new0 (DiscoveryBucket, 1);
+      bucket->tokens = DISCOVERY_BURST;
+      bucket->updated = now;
+      g_hash_table_insert (self->discovery_buckets, g_strdup (host), bucket);
+    }
+
+  if (!discovery_bucket_take (bucket, now))
+    {
+      VALENT_NOTE ("%s: rate limited", host);
+      goto suppress;
+    }
+
+  if (peer == NULL)
+    {
+      discovery_table_reserve (self->discovery_peers,
+                               discovery_peer_is_idle,
+                               now);
+
+      peer = g_new0 (DiscoveryPeer, 1);
+      peer->updated = now;
+      g_hash_table_insert (self->discovery_peers, g_steal_pointer (&key), peer);
+    }
+
+  peer->in_flight = TRUE;
+  self->discovery_accepted++;
+
+  return TRUE;
+
+suppress:
+  self->discovery_suppressed++;
+
+  return FALSE;
+}
+
+/*< private >
+ * valent_lan_channel_service_discovery_done:
+ * @self: a `ValentLanChannelService`
+ * @device_id: the ID of the broadcasting device
+ * @host: the source address of the broadcast
+ * @success: whether the handshake succeeded
+ *
+ * Clear the in-flight state of @device_id at @host. If the handshake failed,
+ * broadcasts from @host claiming @device_id will be ignored for an
+ * exponentially increasing interval.
+ */
+static void
+valent_lan_channel_service_discovery_done (ValentLanChannelService *self,
+                                           const char              *device_id,
+                                           const char              *host,
+                                           gboolean                 success)
+{
+  DiscoveryPeer *peer = NULL;
+  g_autofree char *key = NULL;
+  int64_t backoff_ms;
+
+  g_assert (VALENT_IS_MAIN_THREAD ());
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (self));
+  g_assert (device_id != NULL && host != NULL);
+
+  if (self->discovery_peers == NULL)
+    return;
+
+  key = discovery_peer_key (device_id, host);
+  if (success)
+    {
+      g_hash_table_remove (self->discovery_peers, key);
+      return;
+    }
+
+  peer = g_hash_table_lookup (self->discovery_peers, key);
+  if (peer == NULL)
+    return;
+
+  backoff_ms = DISCOVERY_BACKOFF_MIN_MS << MIN (peer->failures, 6);
+  backoff_ms = MIN (backoff_ms, DISCOVERY_BACKOFF_MAX_MS);
+
+  peer->in_flight = FALSE;
+  peer->failures++;
+  peer->retry_after = g_get_monotonic_time () + (backoff_ms * 1000);
+}
+
 /*
  * Connection Handshake
  *
@@ -110,6 +396,8 @@ typedef struct
   unsigned long         cancellable_id;
   GCancellable         *task_cancellable;
   GSource              *timeout;
+  char                 *discovery_id;
+  gboolean              success;
 } HandshakeData;
 
 static void
@@ -168,6 +456,15 @@ handshake_data_free (gpointer user_data)
 {
   HandshakeData *data = (HandshakeData *)user_data;
 
+  if (data->discovery_id != NULL)
+    {
+      valent_lan_channel_service_discovery_done (VALENT_LAN_CHANNEL_SERVICE (data->service),
+                                                 data->discovery_id,
+                                                 data->host,
+                                                 data->success);
+      g_clear_pointer (&data->discovery_id, g_free);
+    }
+
   if (data->cancellable != NULL)
     {
       g_cancellable_disconnect (data->cancellable, data->cancellable_id);
@@ -234,6 +531,7 @@ handshake_fiber (gpointer user_data)
   g_autoptr (GIOStream) connection = NULL;
   g_autoptr (JsonNode) identity = NULL;
   g_autoptr (GTlsCertificate) certificate = NULL;
+  g_autoptr (GByteArray) unread = NULL;
   GTlsCertificate *cert = NULL;
   GTlsCertificate *peer_cert = NULL;
   const char *device_id = NULL;
@@ -260,13 +558,27 @@ handshake_fiber (gpointer user_data)
       const char *target_device_id = NULL;
       int64_t target_protocol_version = 0;
 
+      unread = g_byte_array_new ();
       peer_identity = dex_await_boxed (valent_packet_from_stream_future (g_io_stream_get_input_stream (data->connection),
                                                                          IDENTITY_BUFFER_MAX,
+                                                                         unread,
                                                                          cancellable),
                                        &error);
       if (peer_identity == NULL)
         goto fail;
 
+      /* The remote device is the TLS server, so it should not send anything
+       * else until the local device starts the TLS handshake.
+       */
+      if (unread->len > 0)
+        {
+          g_set_error_literal (&error,
+                               G_IO_ERROR,
+                               G_IO_ERROR_INVALID_DATA,
+                               "Unexpected data following identity packet");
+          goto fail;
+        }
+
       /* When accepting a TCP connection, the identity packet may indicate its
        * intended target, allowing the local device to mitigate amplification
        * attacks from a spoofed UDP address.
@@ -301,6 +613,7 @@ handshake_fiber (gpointer user_data)
     }
   else
     {
+      g_autoptr (JsonNode) target_identity = NULL;
       JsonObject *body;
       gboolean success;
       const char *target_device_id = NULL;
@@ -315,23 +628,21 @@ handshake_fiber (gpointer user_data)
 
       /* When responding to a UDP broadcast, mark the identity packet for its
        * intended target, allowing the remote device to abort if the broadcast
-       * address was spoofed.
+       * address was spoofed. The shared identity is serialized concurrently
+       * for announcements, so a copy is marked.
        */
       valent_packet_get_string (data->peer_identity, "deviceId", &target_device_id);
       valent_packet_get_int (data->peer_identity, "protocolVersion", &target_protocol_version);
 
-      body = valent_packet_get_body (identity);
+      target_identity = json_node_copy (identity);
+      body = valent_packet_get_body (target_identity);
       json_object_set_string_member (body, "targetDeviceId", target_device_id);
       json_object_set_int_member (body, "targetProtocolVersion", target_protocol_version);
 
       success = dex_await (valent_packet_to_stream_future (g_io_stream_get_output_stream (data->connection),
-                                                           identity,
+                                                           target_identity,
                                                            cancellable),
                            &error);
-      // TODO: operate on a deep-copy instead?
-      json_object_remove_member (body, "targetDeviceId");
-      json_object_remove_member (body, "targetProtocolVersion");
-
       if (!success)
         goto fail;
     }
@@ -406,8 +717,11 @@ handshake_fiber (gpointer user_data)
       send = valent_packet_to_stream_future (g_io_stream_get_output_stream (data->connection),
                                              identity,
                                              cancellable);
+      if (unread == NULL)
+        unread = g_byte_array_new ();
       recv = valent_packet_from_stream_future (g_io_stream_get_input_stream (data->connection),
                                                IDENTITY_BUFFER_MAX,
+                                               unread,
                                                cancellable);
       if (!dex_await (dex_future_all (send, dex_ref (recv), NULL), &error))
         goto fail;
@@ -475,8 +789,22 @@ handshake_fiber (gpointer user_data)
                           "peer-identity",    data->peer_identity,
                           "host",             data->host,
                           "port",             data->port,
+                          "service",          service,
                           NULL);
+
+  /* Any data following the secure identity belongs to the channel
+   */
+  if (unread != NULL && unread->len > 0)
+    {
+      g_autoptr (GBytes) bytes = NULL;
+
+      bytes = g_byte_array_free_to_bytes (g_steal_pointer (&unread));
+      valent_channel_push_input (channel, bytes);
+    }
+
   valent_channel_service_channel (service, channel);
+  data->success = TRUE;
+
   return dex_future_new_for_boolean (TRUE);
 
 fail:
@@ -522,6 +850,238 @@ on_incoming_connection (ValentChannelService *service,
   return TRUE;
 }
 
+/*
+ * Auxiliary Connections
+ *
+ * Transfer ports are bound on demand and kept open for the lifetime of the
+ * service. Each bound port is reserved by at most one waiting transfer, which
+ * receives the next connection accepted on that port.
+ */
+typedef struct
+{
+  unsigned int  index;
+  unsigned long cancelled_id;
+} TransferData;
+
+static gboolean
+valent_lan_channel_service_transfer_release (ValentLanChannelService *self,
+                                             GTask                   *task)
+{
+  TransferData *data = g_task_get_task_data (task);
+  gboolean ret = FALSE;
+
+  valent_object_lock (VALENT_OBJECT (self));
+  if (self->transfer_tasks[data->index] == task)
+    {
+      self->transfer_tasks[data->index] = NULL;
+      self->transfer_busy &= ~(1U << data->index);
+      ret = TRUE;
+    }
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  if (ret)
+    g_object_unref (task);
+
+  return ret;
+}
+
+static void
+on_transfer_cancelled (GCancellable *cancellable,
+                       GTask        *task)
+{
+  ValentLanChannelService *self = g_task_get_source_object (task);
+
+  if (valent_lan_channel_service_transfer_release (self, task))
+    g_task_return_error_if_cancelled (task);
+}
+
+static gboolean
+on_transfer_connection (ValentLanChannelService *self,
+                        GSocketConnection       *connection,
+                        GObject                 *source_object,
+                        GSocketService          *listener)
+{
+  g_autoptr (GSocketAddress) s_addr = NULL;
+  g_autoptr (GTask) task = NULL;
+  TransferData *data = NULL;
+  unsigned int index;
+  uint16_t port;
+
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (self));
+
+  s_addr = g_socket_connection_get_local_address (connection, NULL);
+  if (s_addr == NULL)
+    return TRUE;
+
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (s_addr));
+  if (port < VALENT_LAN_TRANSFER_PORT_MIN || port > VALENT_LAN_TRANSFER_PORT_MAX)
+    return TRUE;
+
+  index = port - VALENT_LAN_TRANSFER_PORT_MIN;
+
+  valent_object_lock (VALENT_OBJECT (self));
+  task = g_steal_pointer (&self->transfer_tasks[index]);
+  self->transfer_busy &= ~(1U << index);
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  /* The connection is dropped if no transfer is waiting on the port
+   */
+  if (task == NULL)
+    {
+      g_debug ("%s(): unexpected connection on port %u", G_STRFUNC, port);
+      return TRUE;
+    }
+
+  data = g_task_get_task_data (task);
+  g_cancellable_disconnect (g_task_get_cancellable (task), data->cancelled_id);
+  g_task_return_pointer (task, g_object_ref (connection), g_object_unref);
+
+  return TRUE;
+}
+
+static uint32_t
+valent_lan_channel_service_transfer_bind_unlocked (ValentLanChannelService  *self,
+                                                   GError                  **error)
+{
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (self));
+
+  for (unsigned int i = 0; i < TRANSFER_PORTS_N; i++)
+    {
+      if (self->transfer_bound & (1U << i))
+        continue;
+
+      if (g_socket_listener_add_inet_port (G_SOCKET_LISTENER (self->transfer_listener),
+                                           VALENT_LAN_TRANSFER_PORT_MIN + i,
+                                           NULL,
+                                           NULL))
+        {
+          self->transfer_bound |= (1U << i);
+          return (1U << i);
+        }
+    }
+
+  g_set_error (error,
+               G_IO_ERROR,
+               G_IO_ERROR_ADDRESS_IN_USE,
+               "No transfer port available between %u-%u",
+               VALENT_LAN_TRANSFER_PORT_MIN,
+               VALENT_LAN_TRANSFER_PORT_MAX);
+  return 0;
+}
+
+/**
+ * valent_lan_channel_service_accept_transfer:
+ * @service: a `ValentLanChannelService`
+ * @cancellable: (nullable): a `GCancellable`
+ * @callback: (scope async): a `GAsyncReadyCallback`
+ * @user_data: user supplied data
+ *
+ * Reserve a transfer port and wait for an auxiliary connection on it.
+ *
+ * The returned port should be sent to the remote device in the payload
+ * information of a packet. If no port could be reserved or @cancellable is
+ * cancelled, this function returns `0` and @callback is invoked with an error.
+ *
+ * Call [method@Valent.LanChannelService.accept_transfer_finish] to get the
+ * result.
+ *
+ * Returns: the reserved port, or `0` on failure
+ */
+uint16_t
+valent_lan_channel_service_accept_transfer (ValentLanChannelService *service,
+                                            GCancellable            *cancellable,
+                                            GAsyncReadyCallback      callback,
+                                            gpointer                 user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  TransferData *data = NULL;
+  uint32_t available = 0;
+  GError *error = NULL;
+
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (service));
+  g_assert (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (service, cancellable, callback, user_data);
+  g_task_set_source_tag (task, valent_lan_channel_service_accept_transfer);
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+    {
+      g_task_return_error (task, error);
+      return 0;
+    }
+
+  valent_object_lock (VALENT_OBJECT (service));
+  if (service->transfer_listener == NULL)
+    {
+      g_set_error_literal (&error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_CLOSED,
+                           "Service is closed");
+    }
+  else
+    {
+      available = service->transfer_bound & ~service->transfer_busy;
+      if (available == 0)
+        available = valent_lan_channel_service_transfer_bind_unlocked (service, &error);
+    }
+
+  if (available != 0)
+    {
+      data = g_new0 (TransferData, 1);
+      data->index = g_bit_nth_lsf (available, -1);
+      g_task_set_task_data (task, data, g_free);
+
+      service->transfer_busy |= (1U << data->index);
+      service->transfer_tasks[data->index] = g_object_ref (task);
+    }
+  valent_object_unlock (VALENT_OBJECT (service));
+
+  if (data == NULL)
+    {
+      g_task_return_error (task, error);
+      return 0;
+    }
+
+  if (cancellable != NULL)
+    {
+      data->cancelled_id = g_cancellable_connect (cancellable,
+                                                  G_CALLBACK (on_transfer_cancelled),
+                                                  g_object_ref (task),
+                                                  g_object_unref);
+
+      /* If cancelled since the check above, the handler has released the
+       * port and the task will be returned with an error.
+       */
+      if (g_cancellable_is_cancelled (cancellable))
+        return 0;
+    }
+
+  return VALENT_LAN_TRANSFER_PORT_MIN + data->index;
+}
+
+/**
+ * valent_lan_channel_service_accept_transfer_finish:
+ * @service: a `ValentLanChannelService`
+ * @result: a `GAsyncResult`
+ * @error: (nullable): a `GError`
+ *
+ * Finish an operation started by
+ * [method@Valent.LanChannelService.accept_transfer].
+ *
+ * Returns: (transfer full): a `GSocketConnection`, or %NULL with @error set
+ */
+GSocketConnection *
+valent_lan_channel_service_accept_transfer_finish (ValentLanChannelService  *service,
+                                                   GAsyncResult             *result,
+                                                   GError                  **error)
+{
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (service));
+  g_assert (g_task_is_valid (result, service));
+  g_assert (error == NULL || *error == NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /*
  * Outgoing Connections
  */
@@ -537,6 +1097,7 @@ valent_lan_channel_service_socket_recv (GSocket      *socket,
   char buffer[IDENTITY_BUFFER_MAX + 1] = { 0, };
   g_autoptr (GSocketAddress) incoming = NULL;
   GInetAddress *addr = NULL;
+  g_autofree char *host = NULL;
   g_autoptr (JsonNode) peer_identity = NULL;
   const char *device_id;
   g_autofree char *local_id = NULL;
@@ -624,10 +1185,17 @@ valent_lan_channel_service_socket_recv (GSocket      *socket,
       VALENT_RETURN (G_SOURCE_CONTINUE);
     }
 
+  host = g_inet_address_to_string (addr);
+  if (!valent_lan_channel_service_discovery_allow (VALENT_LAN_CHANNEL_SERVICE (service),
+                                                   device_id,
+                                                   host))
+    VALENT_RETURN (G_SOURCE_CONTINUE);
+
   data = handshake_data_new (service);
   data->peer_identity = json_node_ref (peer_identity);
-  data->host = g_inet_address_to_string (addr);
+  data->host = g_steal_pointer (&host);
   data->port = (uint16_t)port;
+  data->discovery_id = g_strdup (device_id);
 
   handshake = dex_scheduler_spawn (dex_scheduler_get_thread_default (),
                                    0, /* stack size */
@@ -639,43 +1207,100 @@ valent_lan_channel_service_socket_recv (GSocket      *socket,
   VALENT_RETURN (G_SOURCE_CONTINUE);
 }
 
+/*< private >
+ * valent_lan_channel_service_ref_identity_bytes:
+ * @self: a `ValentLanChannelService`
+ *
+ * Get the serialized identity packet for UDP announcements.
+ *
+ * The bytes are shared by all announcements, until the identity is rebuilt
+ * or changed.
+ *
+ * Returns: (transfer full): the serialized identity
+ */
+static GBytes *
+valent_lan_channel_service_ref_identity_bytes (ValentLanChannelService *self)
+{
+  GBytes *ret = NULL;
+
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (self));
+
+  valent_object_lock (VALENT_OBJECT (self));
+  if (self->identity_bytes == NULL)
+    {
+      g_autoptr (JsonNode) identity = NULL;
+      g_autoptr (JsonNode) snapshot = NULL;
+      char *identity_json = NULL;
+      size_t identity_len;
+
+      /* Serialize a copy, in case the shared identity is being modified
+       */
+      identity = valent_channel_service_ref_identity (VALENT_CHANNEL_SERVICE (self));
+      snapshot = json_node_copy (identity);
+      identity_json = valent_packet_serialize (snapshot, &identity_len);
+      self->identity_bytes = g_bytes_new_take (identity_json, identity_len);
+    }
+  ret = g_bytes_ref (self->identity_bytes);
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  return ret;
+}
+
+static void
+on_identity_changed (ValentLanChannelService *self,
+                     GParamSpec              *pspec,
+                     gpointer                 user_data)
+{
+  /* Queued announcements are kept, to be sent with the new identity
+   */
+  valent_object_lock (VALENT_OBJECT (self));
+  g_clear_pointer (&self->identity_bytes, g_bytes_unref);
+  valent_object_unlock (VALENT_OBJECT (self));
+}
+
+/*
+ * Announcements
+ *
+ * Unicast announcements are queued per socket and flushed in batches when the
+ * socket is writable, so that announcing to many addresses costs one wakeup
+ * and a few system calls, rather than one of each per address.
+ */
 static gboolean
-valent_lan_channel_service_socket_send (GSocket      *socket,
-                                        GIOCondition  condition,
-                                        gpointer      user_data)
+valent_lan_channel_service_socket_flush (GSocket      *socket,
+                                         GIOCondition  condition,
+                                         gpointer      user_data)
 {
-  GSocketAddress *address = G_SOCKET_ADDRESS (user_data);
-  GBytes *bytes = NULL;
-  gssize written;
+  ValentLanChannelService *self = VALENT_LAN_CHANNEL_SERVICE (user_data);
+  g_autoptr (GBytes) identity_bytes = NULL;
+  unsigned int index;
+  unsigned int sent;
   g_autoptr (GError) error = NULL;
 
   VALENT_ENTRY;
 
   g_assert (G_IS_SOCKET (socket));
-  g_assert (G_IS_SOCKET_ADDRESS (address));
-
-  bytes = g_object_get_data (G_OBJECT (address), "valent-lan-broadcast");
-  written = g_socket_send_to (socket,
-                              address,
-                              g_bytes_get_data (bytes, NULL),
-                              g_bytes_get_size (bytes),
-                              NULL,
-                              &error);
+  g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (self));
 
-  /* Partial writes are ignored
-   */
-  if (written == -1)
+  index = (socket == self->udp_socket6) ? 0 : 1;
+  if (valent_object_in_destruction (VALENT_OBJECT (self)))
     {
-      g_autofree char *host = NULL;
+      g_ptr_array_set_size (self->announce_queue[index], 0);
+      g_clear_pointer (&self->announce_source[index], g_source_unref);
+      VALENT_RETURN (G_SOURCE_REMOVE);
+    }
 
-      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
-        VALENT_RETURN (G_SOURCE_CONTINUE);
+  identity_bytes = valent_lan_channel_service_ref_identity_bytes (self);
+  sent = valent_lan_socket_send_batch (socket,
+                                       self->announce_queue[index],
+                                       0,
+                                       identity_bytes,
+                                       &error);
+  g_ptr_array_remove_range (self->announce_queue[index], 0, sent);
 
-      host = g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (address));
-      g_warning ("%s(): failed to announce to \"%s\": %s",
-                 G_STRFUNC, host, error->message);
-    }
+  if (self->announce_queue[index]->len > 0)
+    VALENT_RETURN (G_SOURCE_CONTINUE);
 
+  g_clear_pointer (&self->announce_source[index], g_source_unref);
   VALENT_RETURN (G_SOURCE_REMOVE);
 }
 
@@ -683,9 +1308,11 @@ static gboolean
 valent_lan_channel_service_socket_queue (ValentLanChannelService *self,
                                          GSocketAddress          *address)
 {
-  g_autoptr (GSocket) socket = NULL;
+  GSocket *socket = NULL;
   GSocketFamily family = G_SOCKET_FAMILY_INVALID;
+  unsigned int index;
 
+  g_assert (VALENT_IS_MAIN_THREAD ());
   g_assert (VALENT_IS_LAN_CHANNEL_SERVICE (self));
   g_assert (G_IS_SOCKET_ADDRESS (address));
 
@@ -696,44 +1323,37 @@ valent_lan_channel_service_socket_queue (ValentLanChannelService *self,
   if ((self->udp_socket6 != NULL && family == G_SOCKET_FAMILY_IPV6) ||
       (self->udp_socket6 != NULL && g_socket_speaks_ipv4 (self->udp_socket6)))
     {
-      socket = g_object_ref (self->udp_socket6);
+      socket = self->udp_socket6;
+      index = 0;
     }
   else if (self->udp_socket4 != NULL && family == G_SOCKET_FAMILY_IPV4)
     {
-      socket = g_object_ref (self->udp_socket4);
+      socket = self->udp_socket4;
+      index = 1;
+    }
+  else
+    {
+      return FALSE;
     }
 
-  if (socket != NULL)
+  g_ptr_array_add (self->announce_queue[index], g_object_ref (address));
+
+  if (self->announce_source[index] == NULL)
     {
-      g_autoptr (GSource) source = NULL;
-      g_autoptr (JsonNode) identity = NULL;
-      g_autoptr (GBytes) identity_bytes = NULL;
       g_autoptr (GCancellable) cancellable = NULL;
-      char *identity_json = NULL;
-      size_t identity_len;
-
-      /* Embed the serialized identity as private data
-       */
-      identity = valent_channel_service_ref_identity (VALENT_CHANNEL_SERVICE (self));
-      identity_json = valent_packet_serialize (identity, &identity_len);
-      identity_bytes = g_bytes_new_take (identity_json, identity_len);
-      g_object_set_data_full (G_OBJECT (address),
-                              "valent-lan-broadcast",
-                              g_bytes_ref (identity_bytes),
-                              (GDestroyNotify)g_bytes_unref);
 
       cancellable = valent_object_ref_cancellable (VALENT_OBJECT (self));
-      source = g_socket_create_source (socket, G_IO_OUT, cancellable);
-      g_source_set_callback (source,
-                             G_SOURCE_FUNC (valent_lan_channel_service_socket_send),
-                             g_object_ref (address),
+      self->announce_source[index] = g_socket_create_source (socket,
+                                                             G_IO_OUT,
+                                                             cancellable);
+      g_source_set_callback (self->announce_source[index],
+                             G_SOURCE_FUNC (valent_lan_channel_service_socket_flush),
+                             g_object_ref (self),
                              g_object_unref);
-      g_source_attach (source, NULL);
-
-      return TRUE;
+      g_source_attach (self->announce_source[index], NULL);
     }
 
-  return FALSE;
+  return TRUE;
 }
 
 static void
@@ -837,6 +1457,15 @@ valent_lan_channel_service_tcp_setup (ValentLanChannelService  *self,
       self->tcp_port++;
     }
 
+  /* Transfer ports are bound on demand, by the first payload to need one
+   */
+  self->transfer_listener = g_socket_service_new ();
+  g_signal_connect_object (self->transfer_listener,
+                           "incoming",
+                           G_CALLBACK (on_transfer_connection),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   /* Rebuild the identity packet to populate the `tcpPort` field
    */
   valent_channel_service_build_identity (VALENT_CHANNEL_SERVICE (self));
@@ -1000,6 +1629,10 @@ valent_lan_channel_service_build_identity (ValentChannelService *service)
       body = valent_packet_get_body (identity);
       json_object_set_int_member (body, "tcpPort", self->tcp_port);
     }
+
+  /* Drop the serialized identity, to be regenerated by the next announcement
+   */
+  g_clear_pointer (&self->identity_bytes, g_bytes_unref);
 }
 
 static void
@@ -1139,6 +1772,16 @@ valent_lan_channel_service_destroy (ValentObject *object)
       g_clear_object (&self->dnssd);
     }
 
+  for (size_t i = 0; i < G_N_ELEMENTS (self->announce_source); i++)
+    {
+      if (self->announce_source[i] != NULL)
+        {
+          g_source_destroy (self->announce_source[i]);
+          g_clear_pointer (&self->announce_source[i], g_source_unref);
+        }
+      g_ptr_array_set_size (self->announce_queue[i], 0);
+    }
+
   g_clear_object (&self->udp_socket4);
   g_clear_object (&self->udp_socket6);
 
@@ -1149,6 +1792,40 @@ valent_lan_channel_service_destroy (ValentObject *object)
       g_clear_object (&self->listener);
     }
 
+  if (self->transfer_listener != NULL)
+    {
+      g_autoptr (GSocketService) transfer_listener = NULL;
+      GTask *transfer_tasks[TRANSFER_PORTS_N] = { NULL, };
+
+      valent_object_lock (VALENT_OBJECT (self));
+      transfer_listener = g_steal_pointer (&self->transfer_listener);
+      for (unsigned int i = 0; i < TRANSFER_PORTS_N; i++)
+        transfer_tasks[i] = g_steal_pointer (&self->transfer_tasks[i]);
+      self->transfer_bound = 0;
+      self->transfer_busy = 0;
+      valent_object_unlock (VALENT_OBJECT (self));
+
+      g_socket_service_stop (transfer_listener);
+      g_socket_listener_close (G_SOCKET_LISTENER (transfer_listener));
+
+      for (unsigned int i = 0; i < TRANSFER_PORTS_N; i++)
+        {
+          g_autoptr (GTask) task = g_steal_pointer (&transfer_tasks[i]);
+          TransferData *data;
+
+          if (task == NULL)
+            continue;
+
+          data = g_task_get_task_data (task);
+          g_cancellable_disconnect (g_task_get_cancellable (task),
+                                    data->cancelled_id);
+          g_task_return_new_error (task,
+                                   G_IO_ERROR,
+                                   G_IO_ERROR_CLOSED,
+                                   "Service is closed");
+        }
+    }
+
   VALENT_OBJECT_CLASS (valent_lan_channel_service_parent_class)->destroy (object);
 }
 
@@ -1162,6 +1839,11 @@ valent_lan_channel_service_finalize (GObject *object)
 
   g_clear_pointer (&self->broadcast_address, g_free);
   g_clear_pointer (&self->channels, g_hash_table_unref);
+  g_clear_pointer (&self->identity_bytes, g_bytes_unref);
+  g_clear_pointer (&self->announce_queue[0], g_ptr_array_unref);
+  g_clear_pointer (&self->announce_queue[1], g_ptr_array_unref);
+  g_clear_pointer (&self->discovery_peers, g_hash_table_unref);
+  g_clear_pointer (&self->discovery_buckets, g_hash_table_unref);
 
   G_OBJECT_CLASS (valent_lan_channel_service_parent_class)->finalize (object);
 }
@@ -1180,6 +1862,14 @@ valent_lan_channel_service_get_property (GObject    *object,
       g_value_set_string (value, self->broadcast_address);
       break;
 
+    case PROP_DISCOVERY_ACCEPTED:
+      g_value_set_uint64 (value, self->discovery_accepted);
+      break;
+
+    case PROP_DISCOVERY_SUPPRESSED:
+      g_value_set_uint64 (value, self->discovery_suppressed);
+      break;
+
     case PROP_PORT:
       g_value_set_uint (value, self->port);
       break;
@@ -1207,6 +1897,8 @@ valent_lan_channel_service_set_property (GObject      *object,
       self->port = g_value_get_uint (value);
       break;
 
+    case PROP_DISCOVERY_ACCEPTED:
+    case PROP_DISCOVERY_SUPPRESSED:
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -1244,6 +1936,37 @@ valent_lan_channel_service_class_init (ValentLanChannelServiceClass *klass)
                           G_PARAM_EXPLICIT_NOTIFY |
                           G_PARAM_STATIC_STRINGS));
 
+  /**
+   * ValentLanChannelService:discovery-accepted:
+   *
+   * The number of UDP broadcasts that started an outgoing handshake.
+   *
+   * This property is for instrumentation and is not notified.
+   */
+  properties [PROP_DISCOVERY_ACCEPTED] =
+    g_param_spec_uint64 ("discovery-accepted", NULL, NULL,
+                         0, G_MAXUINT64,
+                         0,
+                         (G_PARAM_READABLE |
+                          G_PARAM_EXPLICIT_NOTIFY |
+                          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * ValentLanChannelService:discovery-suppressed:
+   *
+   * The number of UDP broadcasts ignored because the device was connected,
+   * already handshaking, backing off or rate limited.
+   *
+   * This property is for instrumentation and is not notified.
+   */
+  properties [PROP_DISCOVERY_SUPPRESSED] =
+    g_param_spec_uint64 ("discovery-suppressed", NULL, NULL,
+                         0, G_MAXUINT64,
+                         0,
+                         (G_PARAM_READABLE |
+                          G_PARAM_EXPLICIT_NOTIFY |
+                          G_PARAM_STATIC_STRINGS));
+
   /**
    * ValentLanChannelService:port:
    *
@@ -1273,5 +1996,19 @@ valent_lan_channel_service_init (ValentLanChannelService *self)
                                           g_free,
                                           g_object_unref);
   self->monitor = g_network_monitor_get_default ();
+  self->announce_queue[0] = g_ptr_array_new_with_free_func (g_object_unref);
+  self->announce_queue[1] = g_ptr_array_new_with_free_func (g_object_unref);
+  g_signal_connect (self,
+                    "notify::identity",
+                    G_CALLBACK (on_identity_changed),
+                    NULL);
+  self->discovery_peers = g_hash_table_new_full (g_str_hash,
+                                                 g_str_equal,
+                                                 g_free,
+                                                 g_free);
+  self->discovery_buckets = g_hash_table_new_full (g_str_hash,
+                                                   g_str_equal,
+                                                   g_free,
+                                                   g_free);
 }
 
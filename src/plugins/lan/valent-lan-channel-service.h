@@ -11,5 +11,13 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE (ValentLanChannelService, valent_lan_channel_service, VALENT, LAN_CHANNEL_SERVICE, ValentChannelService)
 
+uint16_t            valent_lan_channel_service_accept_transfer        (ValentLanChannelService  *service,
+                                                                       GCancellable             *cancellable,
+                                                                       GAsyncReadyCallback       callback,
+                                                                       gpointer                  user_data);
+GSocketConnection * valent_lan_channel_service_accept_transfer_finish (ValentLanChannelService  *service,
+                                                                       GAsyncResult             *result,
+                                                                       GError                  **error);
+
 G_END_DECLS
 
@@ -10,10 +10,26 @@
 #include <json-glib/json-glib.h>
 #include <valent.h>
 
+#include "valent-lan-channel-service.h"
+#include "valent-lan-payload-stream.h"
 #include "valent-lan-utils.h"
 
 #include "valent-lan-channel.h"
 
+#define PAYLOAD_SOCKETS_MAX (4)
+
+typedef enum
+{
+  PAYLOAD_DOWNLOAD,
+  PAYLOAD_UPLOAD,
+  N_PAYLOAD_DIRECTIONS
+} PayloadDirection;
+
+typedef struct
+{
+  unsigned int  active;
+  GQueue        pending;
+} PayloadPool;
 
 struct _ValentLanChannel
 {
@@ -21,6 +37,11 @@ struct _ValentLanChannel
 
   char          *host;
   uint16_t       port;
+  GWeakRef       service;
+
+  /* auxiliary connections */
+  PayloadPool     payload_pool[N_PAYLOAD_DIRECTIONS];
+  GTlsConnection *payload_session;
 };
 
 G_DEFINE_FINAL_TYPE (ValentLanChannel, valent_lan_channel, VALENT_TYPE_CHANNEL)
@@ -28,9 +49,289 @@ G_DEFINE_FINAL_TYPE (ValentLanChannel, valent_lan_channel, VALENT_TYPE_CHANNEL)
 typedef enum {
   PROP_HOST = 1,
   PROP_PORT,
+  PROP_SERVICE,
 } ValentLanChannelProperty;
 
-static GParamSpec *properties[PROP_PORT + 1] = { NULL, };
+static GParamSpec *properties[PROP_SERVICE + 1] = { NULL, };
+
+
+/*
+ * Payload Pool
+ *
+ * Auxiliary connections are limited to %PAYLOAD_SOCKETS_MAX open sockets in
+ * each direction, so that a burst of transfers can not exhaust the transfer
+ * port range or file descriptors. A slot is held until the returned stream is
+ * closed, while further operations wait in a FIFO queue until they are started
+ * or cancelled.
+ *
+ * Uploads and downloads are limited separately, since an upload can not
+ * complete until the peer opens a download.
+ */
+static void   valent_lan_channel_download_start (GTask *task);
+static void   valent_lan_channel_upload_start   (GTask *task);
+static void   valent_lan_channel_upload         (ValentChannel       *channel,
+                                                 JsonNode            *packet,
+                                                 GCancellable        *cancellable,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data);
+
+static inline PayloadDirection
+payload_direction (GTask *task)
+{
+  return g_task_get_source_tag (task) == valent_lan_channel_upload
+    ? PAYLOAD_UPLOAD
+    : PAYLOAD_DOWNLOAD;
+}
+
+#define PAYLOAD_CANCELLED_KEY "valent-lan-payload-cancelled"
+
+static void
+payload_pool_disconnect (GTask *task)
+{
+  gulong handler_id;
+
+  handler_id = GPOINTER_TO_SIZE (g_object_steal_data (G_OBJECT (task),
+                                                      PAYLOAD_CANCELLED_KEY));
+  g_cancellable_disconnect (g_task_get_cancellable (task), handler_id);
+}
+
+static gboolean
+payload_pool_cancel_cb (gpointer data)
+{
+  GTask *task = G_TASK (data);
+
+  payload_pool_disconnect (task);
+  g_task_return_error_if_cancelled (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_payload_cancelled (GCancellable *cancellable,
+                      GTask        *task)
+{
+  ValentLanChannel *self = g_task_get_source_object (task);
+  PayloadPool *pool = &self->payload_pool[payload_direction (task)];
+  g_autoptr (GSource) source = NULL;
+  gboolean removed = FALSE;
+
+  valent_object_lock (VALENT_OBJECT (self));
+  removed = g_queue_remove (&pool->pending, task);
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  if (!removed)
+    return;
+
+  /* The handler can not be disconnected during emission, so the task is
+   * returned from its own context, holding the reference from the queue.
+   */
+  source = g_idle_source_new ();
+  g_source_set_priority (source, g_task_get_priority (task));
+  g_source_set_callback (source, payload_pool_cancel_cb, task, g_object_unref);
+  g_source_set_static_name (source, "[valent-lan-channel] payload cancelled");
+  g_source_attach (source, g_task_get_context (task));
+}
+
+static gboolean
+payload_pool_start_cb (gpointer data)
+{
+  GTask *task = G_TASK (data);
+
+  payload_pool_disconnect (task);
+
+  if (payload_direction (task) == PAYLOAD_UPLOAD)
+    valent_lan_channel_upload_start (task);
+  else
+    valent_lan_channel_download_start (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+payload_pool_acquire (ValentLanChannel *self,
+                      GTask            *task)
+{
+  PayloadPool *pool = &self->payload_pool[payload_direction (task)];
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  gboolean ready = FALSE;
+
+  g_assert (VALENT_IS_LAN_CHANNEL (self));
+  g_assert (G_IS_TASK (task));
+
+  valent_object_lock (VALENT_OBJECT (self));
+  if (pool->active < PAYLOAD_SOCKETS_MAX)
+    {
+      pool->active++;
+      ready = TRUE;
+    }
+  else
+    {
+      g_queue_push_tail (&pool->pending, g_object_ref (task));
+
+      /* If @cancellable is already cancelled, the handler is invoked
+       * immediately and the object lock is recursive.
+       */
+      if (cancellable != NULL)
+        {
+          gulong handler_id;
+
+          handler_id = g_cancellable_connect (cancellable,
+                                              G_CALLBACK (on_payload_cancelled),
+                                              task,
+                                              NULL);
+          g_object_set_data (G_OBJECT (task),
+                             PAYLOAD_CANCELLED_KEY,
+                             GSIZE_TO_POINTER (handler_id));
+        }
+    }
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  if (ready)
+    payload_pool_start_cb (g_object_ref (task));
+}
+
+static void
+payload_pool_release (ValentLanChannel *self,
+                      PayloadDirection  direction)
+{
+  PayloadPool *pool = &self->payload_pool[direction];
+  GTask *next = NULL;
+
+  g_assert (VALENT_IS_LAN_CHANNEL (self));
+
+  /* The slot is handed directly to the next pending operation, which is
+   * started in its own context since this may be called from any thread.
+   */
+  valent_object_lock (VALENT_OBJECT (self));
+  next = g_queue_pop_head (&pool->pending);
+  if (next == NULL)
+    pool->active--;
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  if (next != NULL)
+    {
+      g_main_context_invoke_full (g_task_get_context (next),
+                                  g_task_get_priority (next),
+                                  payload_pool_start_cb,
+                                  g_steal_pointer (&next),
+                                  NULL);
+    }
+}
+
+static void   valent_lan_channel_save_session (ValentLanChannel *self,
+                                               GTlsConnection   *connection);
+
+typedef struct
+{
+  GTask     *task;
+  GIOStream *connection;
+} PayloadSlot;
+
+static void
+payload_slot_free (gpointer data)
+{
+  PayloadSlot *slot = (PayloadSlot *)data;
+  ValentLanChannel *self = g_task_get_source_object (slot->task);
+
+  /* TLS 1.3 session tickets are sent after the handshake, so the session
+   * state is saved once the payload has been transferred.
+   */
+  if (G_IS_TLS_CLIENT_CONNECTION (slot->connection))
+    valent_lan_channel_save_session (self, G_TLS_CONNECTION (slot->connection));
+
+  payload_pool_release (self, payload_direction (slot->task));
+  g_clear_object (&slot->connection);
+  g_clear_object (&slot->task);
+  g_free (slot);
+}
+
+/*< private >
+ * payload_task_return_stream:
+ * @task: a `GTask`
+ * @stream: (transfer full) (nullable): a `GIOStream`
+ * @error: (transfer full) (nullable): a `GError`
+ *
+ * Complete a payload operation, transferring its pool slot to @stream. The
+ * slot is released when the returned stream is closed. If @stream is %NULL,
+ * the slot is released and @error is returned instead.
+ */
+static void
+payload_task_return_stream (GTask     *task,
+                            GIOStream *stream,
+                            GError    *error)
+{
+  g_assert (G_IS_TASK (task));
+  g_assert ((stream == NULL) != (error == NULL));
+
+  if (stream != NULL)
+    {
+      PayloadSlot *slot;
+
+      slot = g_new0 (PayloadSlot, 1);
+      slot->task = g_object_ref (task);
+      slot->connection = stream;
+      g_task_return_pointer (task,
+                             valent_lan_payload_stream_new (stream,
+                                                            payload_slot_free,
+                                                            slot),
+                             g_object_unref);
+    }
+  else
+    {
+      payload_pool_release (g_task_get_source_object (task),
+                            payload_direction (task));
+      g_task_return_error (task, error);
+    }
+}
+
+/*< private >
+ * valent_lan_channel_save_session:
+ * @self: a `ValentLanChannel`
+ * @connection: a `GTlsClientConnection`
+ *
+ * Copy the session state of @connection, to be resumed by the next download.
+ *
+ * This should be called after the payload has been read, since a TLS 1.3
+ * server sends session tickets after the handshake has completed.
+ *
+ * The state is held by a detached connection, so that the socket of
+ * @connection is not kept open by the cache.
+ */
+static void
+valent_lan_channel_save_session (ValentLanChannel *self,
+                                 GTlsConnection   *connection)
+{
+  g_autoptr (GTlsConnection) session = NULL;
+  g_autoptr (GIOStream) base_stream = NULL;
+  g_autoptr (GInputStream) input = NULL;
+  g_autoptr (GOutputStream) output = NULL;
+  GTlsBackend *backend;
+
+  g_assert (VALENT_IS_LAN_CHANNEL (self));
+  g_assert (G_IS_TLS_CLIENT_CONNECTION (connection));
+
+  input = g_memory_input_stream_new ();
+  output = g_memory_output_stream_new_resizable ();
+  base_stream = g_simple_io_stream_new (input, output);
+
+  backend = g_tls_backend_get_default ();
+  session = g_initable_new (g_tls_backend_get_client_connection_type (backend),
+                            NULL,
+                            NULL,
+                            "base-io-stream",  base_stream,
+                            "certificate",     g_tls_connection_get_certificate (connection),
+                            "server-identity", NULL,
+                            NULL);
+  if (session == NULL)
+    return;
+
+  g_tls_client_connection_copy_session_state (G_TLS_CLIENT_CONNECTION (session),
+                                              G_TLS_CLIENT_CONNECTION (connection));
+
+  valent_object_lock (VALENT_OBJECT (self));
+  g_set_object (&self->payload_session, session);
+  valent_object_unlock (VALENT_OBJECT (self));
+}
 
 
 /*
@@ -42,17 +343,25 @@ valent_lan_connection_handshake_cb (GSocketConnection *connection,
                                     gpointer           user_data)
 {
   g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
-  g_autoptr (GIOStream) ret = NULL;
+  ValentLanChannel *self = g_task_get_source_object (task);
+  GIOStream *ret = NULL;
   GError *error = NULL;
 
   ret = valent_lan_connection_handshake_finish (connection, result, &error);
-  if (ret == NULL)
+  if (ret != NULL && G_IS_TLS_CLIENT_CONNECTION (ret))
     {
-      g_task_return_error (task, g_steal_pointer (&error));
-      return;
+      gboolean resumed = FALSE;
+
+      /* GLib 2.86 reports whether a handshake resumed a session
+       */
+      if (g_object_class_find_property (G_OBJECT_GET_CLASS (ret), "session-resumed"))
+        g_object_get (ret, "session-resumed", &resumed, NULL);
+
+      if (resumed)
+        g_debug ("%s(): resumed TLS session for \"%s\"", G_STRFUNC, self->host);
     }
 
-  g_task_return_pointer (task, g_steal_pointer (&ret), g_object_unref);
+  payload_task_return_stream (task, ret, error);
 }
 
 static void
@@ -61,17 +370,19 @@ g_socket_client_connect_to_host_cb (GSocketClient *client,
                                     gpointer       user_data)
 {
   g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
-  ValentChannel *channel = g_task_get_source_object (task);
+  ValentLanChannel *self = g_task_get_source_object (task);
+  ValentChannel *channel = VALENT_CHANNEL (self);
   GCancellable *cancellable = g_task_get_cancellable (task);
   g_autoptr (GSocketConnection) connection = NULL;
   g_autoptr (GTlsCertificate) certificate = NULL;
   g_autoptr (GTlsCertificate) peer_certificate = NULL;
+  g_autoptr (GTlsConnection) session = NULL;
   GError *error = NULL;
 
   connection = g_socket_client_connect_to_host_finish (client, result, &error);
   if (connection == NULL)
     {
-      g_task_return_error (task, g_steal_pointer (&error));
+      payload_task_return_stream (task, NULL, g_steal_pointer (&error));
       return;
     }
 
@@ -80,12 +391,47 @@ g_socket_client_connect_to_host_cb (GSocketClient *client,
    */
   certificate = valent_channel_ref_certificate (channel);
   peer_certificate = valent_channel_ref_peer_certificate (channel);
-  valent_lan_connection_handshake_async (connection,
-                                         certificate,
-                                         peer_certificate,
-                                         TRUE, /* is_client */
+
+  valent_object_lock (VALENT_OBJECT (self));
+  if (self->payload_session != NULL)
+    session = g_object_ref (self->payload_session);
+  valent_object_unlock (VALENT_OBJECT (self));
+
+  valent_lan_connection_handshake_resume_async (connection,
+                                                certificate,
+                                                peer_certificate,
+                                                session,
+                                                cancellable,
+                                                (GAsyncReadyCallback)valent_lan_connection_handshake_cb,
+                                                g_object_ref (task));
+}
+
+static void
+valent_lan_channel_download_start (GTask *task)
+{
+  g_autoptr (GTask) owned = task;
+  ValentLanChannel *self = g_task_get_source_object (task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  uint16_t port = GPOINTER_TO_UINT (g_task_get_task_data (task));
+  g_autoptr (GSocketClient) client = NULL;
+  GError *error = NULL;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+    {
+      payload_task_return_stream (task, NULL, error);
+      return;
+    }
+
+  /* Open a connection to the host at the expected port
+   */
+  client = g_object_new (G_TYPE_SOCKET_CLIENT,
+                         "enable-proxy", FALSE,
+                         NULL);
+  g_socket_client_connect_to_host_async (client,
+                                         self->host,
+                                         port,
                                          cancellable,
-                                         (GAsyncReadyCallback)valent_lan_connection_handshake_cb,
+                                         (GAsyncReadyCallback)g_socket_client_connect_to_host_cb,
                                          g_object_ref (task));
 }
 
@@ -101,7 +447,6 @@ valent_lan_channel_download (ValentChannel       *channel,
   JsonObject *info;
   int64_t port;
   goffset size;
-  g_autoptr (GSocketClient) client = NULL;
   GError *error = NULL;
 
   g_assert (VALENT_IS_CHANNEL (channel));
@@ -132,39 +477,18 @@ valent_lan_channel_download (ValentChannel       *channel,
       return;
     }
 
-  /* Open a connection to the host at the expected port
-   */
-  client = g_object_new (G_TYPE_SOCKET_CLIENT,
-                         "enable-proxy", FALSE,
-                         NULL);
-  g_socket_client_connect_to_host_async (client,
-                                         self->host,
-                                         (uint16_t)port,
-                                         cancellable,
-                                         (GAsyncReadyCallback)g_socket_client_connect_to_host_cb,
-                                         g_object_ref (task));
+  g_task_set_task_data (task, GUINT_TO_POINTER ((uint16_t)port), NULL);
+  payload_pool_acquire (self, task);
 }
 
 static void
-g_socket_listener_accept_cb (GSocketListener *listener,
-                             GAsyncResult    *result,
-                             gpointer         user_data)
+valent_lan_channel_upload_handshake (GTask             *task,
+                                     GSocketConnection *connection)
 {
-  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
   ValentChannel *channel = g_task_get_source_object (task);
   GCancellable *cancellable = g_task_get_cancellable (task);
-  g_autoptr (GSocketConnection) connection = NULL;
   g_autoptr (GTlsCertificate) certificate = NULL;
   g_autoptr (GTlsCertificate) peer_certificate = NULL;
-  GError *error = NULL;
-
-  connection = g_socket_listener_accept_finish (listener, result, NULL, &error);
-  g_socket_listener_close (listener);
-  if (connection == NULL)
-    {
-      g_task_return_error (task, g_steal_pointer (&error));
-      return;
-    }
 
   /* NOTE: When negotiating an auxiliary connection, a KDE Connect device
    *       acts as the TLS client when opening TCP connections.
@@ -181,53 +505,129 @@ g_socket_listener_accept_cb (GSocketListener *listener,
 }
 
 static void
-valent_lan_channel_upload (ValentChannel       *channel,
-                           JsonNode            *packet,
-                           GCancellable        *cancellable,
-                           GAsyncReadyCallback  callback,
-                           gpointer             user_data)
+valent_lan_channel_service_accept_transfer_cb (ValentLanChannelService *service,
+                                               GAsyncResult            *result,
+                                               gpointer                 user_data)
 {
-  g_autoptr (GTask) task = NULL;
+  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
+  g_autoptr (GSocketConnection) connection = NULL;
+  GError *error = NULL;
+
+  connection = valent_lan_channel_service_accept_transfer_finish (service,
+                                                                  result,
+                                                                  &error);
+  if (connection == NULL)
+    {
+      payload_task_return_stream (task, NULL, g_steal_pointer (&error));
+      return;
+    }
+
+  valent_lan_channel_upload_handshake (task, connection);
+}
+
+static void
+g_socket_listener_accept_cb (GSocketListener *listener,
+                             GAsyncResult    *result,
+                             gpointer         user_data)
+{
+  g_autoptr (GTask) task = G_TASK (g_steal_pointer (&user_data));
+  g_autoptr (GSocketConnection) connection = NULL;
+  GError *error = NULL;
+
+  connection = g_socket_listener_accept_finish (listener, result, NULL, &error);
+  g_socket_listener_close (listener);
+  if (connection == NULL)
+    {
+      payload_task_return_stream (task, NULL, g_steal_pointer (&error));
+      return;
+    }
+
+  valent_lan_channel_upload_handshake (task, connection);
+}
+
+static void
+valent_lan_channel_upload_start (GTask *task)
+{
+  g_autoptr (GTask) owned = task;
+  ValentLanChannel *self = g_task_get_source_object (task);
+  ValentChannel *channel = VALENT_CHANNEL (self);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  JsonNode *packet = g_task_get_task_data (task);
+  g_autoptr (ValentLanChannelService) service = NULL;
   g_autoptr (GSocketListener) listener = NULL;
   uint16_t port = VALENT_LAN_TRANSFER_PORT_MIN;
   JsonObject *info;
   GError *error = NULL;
 
-  g_assert (VALENT_IS_CHANNEL (channel));
-  g_assert (VALENT_IS_PACKET (packet));
-  g_assert (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-
-  task = g_task_new (channel, cancellable, callback, user_data);
-  g_task_set_source_tag (task, valent_lan_channel_upload);
+  if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+    {
+      payload_task_return_stream (task, NULL, error);
+      return;
+    }
 
-  /* Find an open port and prepare the payload information
+  /* Reserve a port from the service's transfer listener, if possible, or find
+   * an open port for a one-time listener.
    */
-  listener = g_socket_listener_new ();
-  while (!g_socket_listener_add_inet_port (listener, port, NULL, &error))
+  service = g_weak_ref_get (&self->service);
+  if (service != NULL)
+    {
+      port = valent_lan_channel_service_accept_transfer (service,
+                                                         cancellable,
+                                                         (GAsyncReadyCallback)valent_lan_channel_service_accept_transfer_cb,
+                                                         g_object_ref (task));
+      if (port == 0)
+        return;
+    }
+  else
     {
-      if (port >= VALENT_LAN_TRANSFER_PORT_MAX)
+      listener = g_socket_listener_new ();
+      while (!g_socket_listener_add_inet_port (listener, port, NULL, &error))
         {
-          g_task_return_error (task, g_steal_pointer (&error));
-          return;
+          if (port >= VALENT_LAN_TRANSFER_PORT_MAX)
+            {
+              payload_task_return_stream (task, NULL, g_steal_pointer (&error));
+              return;
+            }
+
+          port++;
+          g_clear_error (&error);
         }
 
-      port++;
-      g_clear_error (&error);
+      g_socket_listener_accept_async (listener,
+                                      cancellable,
+                                      (GAsyncReadyCallback)g_socket_listener_accept_cb,
+                                      g_object_ref (task));
     }
 
+  /* Send the payload information and wait for the incoming connection
+   */
   info = json_object_new();
   json_object_set_int_member (info, "port", (int64_t)port);
   valent_packet_set_payload_info (packet, info);
-
-  /* Listen for the incoming connection and queue the packet
-   */
-  g_socket_listener_accept_async (listener,
-                                  cancellable,
-                                  (GAsyncReadyCallback)g_socket_listener_accept_cb,
-                                  g_object_ref (task));
   valent_channel_write_packet (channel, packet, cancellable, NULL, NULL);
 }
 
+static void
+valent_lan_channel_upload (ValentChannel       *channel,
+                           JsonNode            *packet,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+  g_autoptr (GTask) task = NULL;
+
+  g_assert (VALENT_IS_CHANNEL (channel));
+  g_assert (VALENT_IS_PACKET (packet));
+  g_assert (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (channel, cancellable, callback, user_data);
+  g_task_set_source_tag (task, valent_lan_channel_upload);
+  g_task_set_task_data (task,
+                        json_node_ref (packet),
+                        (GDestroyNotify)json_node_unref);
+  payload_pool_acquire (VALENT_LAN_CHANNEL (channel), task);
+}
+
 /*
  * GObject
  */
@@ -237,6 +637,11 @@ valent_lan_channel_finalize (GObject *object)
   ValentLanChannel *self = VALENT_LAN_CHANNEL (object);
 
   g_clear_pointer (&self->host, g_free);
+  g_weak_ref_clear (&self->service);
+  g_clear_object (&self->payload_session);
+
+  for (size_t i = 0; i < N_PAYLOAD_DIRECTIONS; i++)
+    g_queue_clear_full (&self->payload_pool[i].pending, g_object_unref);
 
   G_OBJECT_CLASS (valent_lan_channel_parent_class)->finalize (object);
 }
@@ -259,6 +664,10 @@ valent_lan_channel_get_property (GObject    *object,
       g_value_set_uint (value, self->port);
       break;
 
+    case PROP_SERVICE:
+      g_value_take_object (value, g_weak_ref_get (&self->service));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -282,6 +691,10 @@ valent_lan_channel_set_property (GObject      *object,
       self->port = g_value_get_uint (value);
       break;
 
+    case PROP_SERVICE:
+      g_weak_ref_set (&self->service, g_value_get_object (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -329,11 +742,31 @@ valent_lan_channel_class_init (ValentLanChannelClass *klass)
                         G_PARAM_EXPLICIT_NOTIFY |
                         G_PARAM_STATIC_STRINGS));
 
+  /**
+   * ValentLanChannel:service: (nullable)
+   *
+   * The service that created the channel.
+   *
+   * If set, uploads reserve a port from the service's transfer listener,
+   * instead of binding a new listener for each payload.
+   */
+  properties [PROP_SERVICE] =
+    g_param_spec_object ("service", NULL, NULL,
+                         VALENT_TYPE_LAN_CHANNEL_SERVICE,
+                         (G_PARAM_READWRITE |
+                          G_PARAM_CONSTRUCT_ONLY |
+                          G_PARAM_EXPLICIT_NOTIFY |
+                          G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_properties (object_class, G_N_ELEMENTS (properties), properties);
 }
 
 static void
 valent_lan_channel_init (ValentLanChannel *self)
 {
+  g_weak_ref_init (&self->service, NULL);
+
+  for (size_t i = 0; i < N_PAYLOAD_DIRECTIONS; i++)
+    g_queue_init (&self->payload_pool[i].pending);
 }
 
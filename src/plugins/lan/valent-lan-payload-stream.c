@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Andy Holmes <andrew.g.r.holmes@gmail.com>
+
+#define G_LOG_DOMAIN "valent-lan-payload-stream"
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "valent-lan-payload-stream.h"
+
+
+/*< private >
+ * PayloadState:
+ * @ref_count: the reference count
+ * @closed: whether @closed_func has been invoked
+ * @base_stream: the wrapped `GIOStream`
+ * @closed_func: a `GDestroyNotify` for @closed_data
+ * @closed_data: user supplied data
+ *
+ * State shared by the input and output streams of a payload stream.
+ *
+ * The @closed_func is invoked exactly once, when either stream is closed or
+ * when both are finalized, whichever comes first.
+ */
+typedef struct
+{
+  gatomicrefcount  ref_count;
+  int              closed;
+  GIOStream       *base_stream;
+  GDestroyNotify   closed_func;
+  gpointer         closed_data;
+} PayloadState;
+
+static PayloadState *
+payload_state_ref (PayloadState *state)
+{
+  g_atomic_ref_count_inc (&state->ref_count);
+
+  return state;
+}
+
+static void
+payload_state_closed (PayloadState *state)
+{
+  if (!g_atomic_int_exchange (&state->closed, TRUE))
+    g_clear_pointer (&state->closed_data, state->closed_func);
+}
+
+static void
+payload_state_unref (PayloadState *state)
+{
+  if (g_atomic_ref_count_dec (&state->ref_count))
+    {
+      payload_state_closed (state);
+      g_clear_object (&state->base_stream);
+      g_free (state);
+    }
+}
+
+
+/*
+ * ValentLanPayloadInputStream
+ */
+#define VALENT_TYPE_LAN_PAYLOAD_INPUT_STREAM (valent_lan_payload_input_stream_get_type())
+G_DECLARE_FINAL_TYPE (ValentLanPayloadInputStream, valent_lan_payload_input_stream, VALENT, LAN_PAYLOAD_INPUT_STREAM, GFilterInputStream)
+
+struct _ValentLanPayloadInputStream
+{
+  GFilterInputStream  parent_instance;
+
+  PayloadState       *state;
+};
+
+static void   g_pollable_input_stream_iface_init (GPollableInputStreamInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (ValentLanPayloadInputStream, valent_lan_payload_input_stream, G_TYPE_FILTER_INPUT_STREAM,
+                               G_IMPLEMENT_INTERFACE (G_TYPE_POLLABLE_INPUT_STREAM, g_pollable_input_stream_iface_init))
+
+static gboolean
+valent_lan_payload_input_stream_can_poll (GPollableInputStream *pollable)
+{
+  GInputStream *base_stream;
+
+  base_stream = g_filter_input_stream_get_base_stream (G_FILTER_INPUT_STREAM (pollable));
+
+  return G_IS_POLLABLE_INPUT_STREAM (base_stream) &&
+         g_pollable_input_stream_can_poll (G_POLLABLE_INPUT_STREAM (base_stream));
+}
+
+static GSource *
+valent_lan_payload_input_stream_create_source (GPollableInputStream *pollable,
+                                               GCancellable         *cancellable)
+{
+  GInputStream *base_stream;
+  g_autoptr (GSource) base_source = NULL;
+
+  base_stream = g_filter_input_stream_get_base_stream (G_FILTER_INPUT_STREAM (pollable));
+  base_source = g_pollable_input_stream_create_source (G_POLLABLE_INPUT_STREAM (base_stream),
+                                                       NULL);
+
+  return g_pollable_source_new_full (pollable, base_source, cancellable);
+}
+
+static gboolean
+valent_lan_payload_input_stream_is_readable (GPollableInputStream *pollable)
+{
+  GInputStream *base_stream;
+
+  base_stream = g_filter_input_stream_get_base_stream (G_FILTER_INPUT_STREAM (pollable));
+
+  return g_pollable_input_stream_is_readable (G_POLLABLE_INPUT_STREAM (base_stream));
+}
+
+static gssize
+valent_lan_payload_input_stream_read_nonblocking (GPollableInputStream  *pollable,
+                                                  void                  *buffer,
+                                                  size_t                 count,
+                                                  GError               **error)
+{
+  GInputStream *base_stream;
+
+  base_stream = g_filter_input_stream_get_base_stream (G_FILTER_INPUT_STREAM (pollable));
+
+  return g_pollable_input_stream_read_nonblocking (G_POLLABLE_INPUT_STREAM (base_stream),
+                                                   buffer,
+                                                   count,
+                                                   NULL,
+                                                   error);
+}
+
+static void
+g_pollable_input_stream_iface_init (GPollableInputStreamInterface *iface)
+{
+  iface->can_poll = valent_lan_payload_input_stream_can_poll;
+  iface->create_source = valent_lan_payload_input_stream_create_source;
+  iface->is_readable = valent_lan_payload_input_stream_is_readable;
+  iface->read_nonblocking = valent_lan_payload_input_stream_read_nonblocking;
+}
+
+static gboolean
+valent_lan_payload_input_stream_close (GInputStream  *stream,
+                                       GCancellable  *cancellable,
+                                       GError       **error)
+{
+  ValentLanPayloadInputStream *self = VALENT_LAN_PAYLOAD_INPUT_STREAM (stream);
+  gboolean ret;
+
+  ret = G_INPUT_STREAM_CLASS (valent_lan_payload_input_stream_parent_class)->close_fn (stream,
+                                                                                        cancellable,
+                                                                                        error);
+  payload_state_closed (self->state);
+
+  return ret;
+}
+
+static void
+valent_lan_payload_input_stream_finalize (GObject *object)
+{
+  ValentLanPayloadInputStream *self = VALENT_LAN_PAYLOAD_INPUT_STREAM (object);
+
+  g_clear_pointer (&self->state, payload_state_unref);
+
+  G_OBJECT_CLASS (valent_lan_payload_input_stream_parent_class)->finalize (object);
+}
+
+static void
+valent_lan_payload_input_stream_class_init (ValentLanPayloadInputStreamClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS (klass);
+
+  object_class->finalize = valent_lan_payload_input_stream_finalize;
+
+  stream_class->close_fn = valent_lan_payload_input_stream_close;
+}
+
+static void
+valent_lan_payload_input_stream_init (ValentLanPayloadInputStream *self)
+{
+}
+
+
+/*
+ * ValentLanPayloadOutputStream
+ */
+#define VALENT_TYPE_LAN_PAYLOAD_OUTPUT_STREAM (valent_lan_payload_output_stream_get_type())
+G_DECLARE_FINAL_TYPE (ValentLanPayloadOutputStream, valent_lan_payload_output_stream, VALENT, LAN_PAYLOAD_OUTPUT_STREAM, GFilterOutputStream)
+
+struct _ValentLanPayloadOutputStream
+{
+  GFilterOutputStream  parent_instance;
+
+  PayloadState        *state;
+};
+
+static void   g_pollable_output_stream_iface_init (GPollableOutputStreamInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (ValentLanPayloadOutputStream, valent_lan_payload_output_stream, G_TYPE_FILTER_OUTPUT_STREAM,
+                               G_IMPLEMENT_INTERFACE (G_TYPE_POLLABLE_OUTPUT_STREAM, g_pollable_output_stream_iface_init))
+
+static gboolean
+valent_lan_payload_output_stream_can_poll (GPollableOutputStream *pollable)
+{
+  GOutputStream *base_stream;
+
+  base_stream = g_filter_output_stream_get_base_stream (G_FILTER_OUTPUT_STREAM (pollable));
+
+  return G_IS_POLLABLE_OUTPUT_STREAM (base_stream) &&
+         g_pollable_output_stream_can_poll (G_POLLABLE_OUTPUT_STREAM (base_stream));
+}
+
+static GSource *
+valent_lan_payload_output_stream_create_source (GPollableOutputStream *pollable,
+                                                GCancellable          *cancellable)
+{
+  GOutputStream *base_stream;
+  g_autoptr (GSource) base_source = NULL;
+
+  base_stream = g_filter_output_stream_get_base_stream (G_FILTER_OUTPUT_STREAM (pollable));
+  base_source = g_pollable_output_stream_create_source (G_POLLABLE_OUTPUT_STREAM (base_stream),
+                                                        NULL);
+
+  return g_pollable_source_new_full (pollable, base_source, cancellable);
+}
+
+static gboolean
+valent_lan_payload_output_stream_is_writable (GPollableOutputStream *pollable)
+{
+  GOutputStream *base_stream;
+
+  base_stream = g_filter_output_stream_get_base_stream (G_FILTER_OUTPUT_STREAM (pollable));
+
+  return g_pollable_output_stream_is_writable (G_POLLABLE_OUTPUT_STREAM (base_stream));
+}
+
+static gssize
+valent_lan_payload_output_stream_write_nonblocking (GPollableOutputStream  *pollable,
+                                                    const void             *buffer,
+                                                    size_t                  count,
+                                                    GError                **error)
+{
+  GOutputStream *base_stream;
+
+  base_stream = g_filter_output_stream_get_base_stream (G_FILTER_OUTPUT_STREAM (pollable));
+
+  return g_pollable_output_stream_write_nonblocking (G_POLLABLE_OUTPUT_STREAM (base_stream),
+                                                     buffer,
+                                                     count,
+                                                     NULL,
+                                                     error);
+}
+
+static void
+g_pollable_output_stream_iface_init (GPollableOutputStreamInterface *iface)
+{
+  iface->can_poll = valent_lan_payload_output_stream_can_poll;
+  iface->create_source = valent_lan_payload_output_stream_create_source;
+  iface->is_writable = valent_lan_payload_output_stream_is_writable;
+  iface->write_nonblocking = valent_lan_payload_output_stream_write_nonblocking;
+}
+
+static gboolean
+valent_lan_payload_output_stream_close (GOutputStream  *stream,
+                                        GCancellable   *cancellable,
+                                        GError        **error)
+{
+  ValentLanPayloadOutputStream *self = VALENT_LAN_PAYLOAD_OUTPUT_STREAM (stream);
+  gboolean ret;
+
+  ret = G_OUTPUT_STREAM_CLASS (valent_lan_payload_output_stream_parent_class)->close_fn (stream,
+                                                                                          cancellable,
+                                                                                          error);
+  payload_state_closed (self->state);
+
+  return ret;
+}
+
+static void
+valent_lan_payload_output_stream_finalize (GObject *object)
+{
+  ValentLanPayloadOutputStream *self = VALENT_LAN_PAYLOAD_OUTPUT_STREAM (object);
+
+  g_clear_pointer (&self->state, payload_state_unref);
+
+  G_OBJECT_CLASS (valent_lan_payload_output_stream_parent_class)->finalize (object);
+}
+
+static void
+valent_lan_payload_output_stream_class_init (ValentLanPayloadOutputStreamClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GOutputStreamClass *stream_class = G_OUTPUT_STREAM_CLASS (klass);
+
+  object_class->finalize = valent_lan_payload_output_stream_finalize;
+
+  stream_class->close_fn = valent_lan_payload_output_stream_close;
+}
+
+static void
+valent_lan_payload_output_stream_init (ValentLanPayloadOutputStream *self)
+{
+}
+
+
+/**
+ * valent_lan_payload_stream_new:
+ * @base_stream: a `GIOStream`
+ * @closed_func: (scope notified): a `GDestroyNotify`
+ * @closed_data: user supplied data
+ *
+ * Wrap @base_stream, so that @closed_func is invoked as soon as the input or
+ * output stream is closed, rather than when @base_stream is finalized.
+ *
+ * Payload transfers are unidirectional, so consumers typically close only the
+ * stream they used (e.g. with %G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE). If neither
+ * stream is closed, @closed_func is invoked when both are finalized.
+ *
+ * Returns: (transfer full): a new `GIOStream`
+ */
+GIOStream *
+valent_lan_payload_stream_new (GIOStream      *base_stream,
+                               GDestroyNotify  closed_func,
+                               gpointer        closed_data)
+{
+  PayloadState *state;
+  g_autoptr (ValentLanPayloadInputStream) input_stream = NULL;
+  g_autoptr (ValentLanPayloadOutputStream) output_stream = NULL;
+
+  g_assert (G_IS_IO_STREAM (base_stream));
+  g_assert (closed_func != NULL);
+
+  state = g_new0 (PayloadState, 1);
+  g_atomic_ref_count_init (&state->ref_count);
+  state->base_stream = g_object_ref (base_stream);
+  state->closed_func = closed_func;
+  state->closed_data = closed_data;
+
+  input_stream = g_object_new (VALENT_TYPE_LAN_PAYLOAD_INPUT_STREAM,
+                               "base-stream", g_io_stream_get_input_stream (base_stream),
+                               NULL);
+  input_stream->state = payload_state_ref (state);
+
+  output_stream = g_object_new (VALENT_TYPE_LAN_PAYLOAD_OUTPUT_STREAM,
+                                "base-stream", g_io_stream_get_output_stream (base_stream),
+                                NULL);
+  output_stream->state = g_steal_pointer (&state);
+
+  return g_simple_io_stream_new (G_INPUT_STREAM (input_stream),
+                                 G_OUTPUT_STREAM (output_stream));
+}
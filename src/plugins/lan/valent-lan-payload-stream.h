@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Andy Holmes <andrew.g.r.holmes@gmail.com>
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+GIOStream * valent_lan_payload_stream_new (GIOStream      *base_stream,
+                                           GDestroyNotify  closed_func,
+                                           gpointer        closed_data);
+
+G_END_DECLS
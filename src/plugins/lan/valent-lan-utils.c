@@ -26,6 +26,35 @@ valent_lan_connection_accept_certificate_cb (GTlsConnection       *connection,
   return TRUE;
 }
 
+/* A certificate identical to the trusted certificate needs no signature
+ * verification, but must still be within its validity period.
+ */
+static GTlsCertificateFlags
+valent_lan_certificate_verify (GTlsCertificate *peer_certificate,
+                               GTlsCertificate *ca_certificate)
+{
+  g_autoptr (GDateTime) now = NULL;
+  g_autoptr (GDateTime) not_before = NULL;
+  g_autoptr (GDateTime) not_after = NULL;
+  GTlsCertificateFlags errors = G_TLS_CERTIFICATE_NO_FLAGS;
+
+  if (ca_certificate == peer_certificate ||
+      !g_tls_certificate_is_same (ca_certificate, peer_certificate))
+    return g_tls_certificate_verify (peer_certificate, NULL, ca_certificate);
+
+  now = g_date_time_new_now_utc ();
+  not_before = g_tls_certificate_get_not_valid_before (peer_certificate);
+  not_after = g_tls_certificate_get_not_valid_after (peer_certificate);
+
+  if (not_before != NULL && g_date_time_compare (now, not_before) < 0)
+    errors |= G_TLS_CERTIFICATE_NOT_ACTIVATED;
+
+  if (not_after != NULL && g_date_time_compare (now, not_after) > 0)
+    errors |= G_TLS_CERTIFICATE_EXPIRED;
+
+  return errors;
+}
+
 /**
  * valent_lan_connection_handshake:
  * @connection: a `GSocketConnection`
@@ -137,30 +166,19 @@ valent_lan_connection_handshake (GSocketConnection  *connection,
       return NULL;
     }
 
-  /* If @trusted is not provided, try to find a certificate in a device
-   * config directory. If neither are found, the certificate is verified
-   * as self-signed before being accepted per the trust-on-first-use policy.
-   *
-   * TODO: this should be handled by a managed cache object
+  /* If @trusted is not provided, look up the certificate of a paired device.
+   * If neither are found, the certificate is verified as self-signed before
+   * being accepted per the trust-on-first-use policy.
    */
   if (trusted != NULL)
-    {
-      ca_certificate = g_object_ref (trusted);
-    }
+    ca_certificate = g_object_ref (trusted);
   else
-    {
-      g_autofree char *trusted_path = NULL;
-
-      trusted_path = g_build_filename (g_get_user_config_dir(), PACKAGE_NAME,
-                                       "device", peer_common_name,
-                                       "certificate.pem",
-                                       NULL);
-      ca_certificate = g_tls_certificate_new_from_file (trusted_path, NULL);
-      if (ca_certificate == NULL)
-        ca_certificate = g_object_ref (peer_certificate);
-    }
+    ca_certificate = valent_certificate_ref_trusted (peer_common_name);
+
+  if (ca_certificate == NULL)
+    ca_certificate = g_object_ref (peer_certificate);
 
-  errors = g_tls_certificate_verify (peer_certificate, NULL, ca_certificate);
+  errors = valent_lan_certificate_verify (peer_certificate, ca_certificate);
   if (errors != G_TLS_CERTIFICATE_NO_FLAGS)
     {
       g_autofree char *errors_str = NULL;
@@ -206,6 +224,15 @@ g_tls_connection_handshake_cb (GTlsConnection *connection,
    * handshake, to sanitize queries to the filesystem for a trusted certificate.
    */
   peer_certificate = g_tls_connection_get_peer_certificate (connection);
+  if (peer_certificate == NULL)
+    {
+      g_task_return_new_error (task,
+                               G_TLS_ERROR,
+                               G_TLS_ERROR_HANDSHAKE,
+                               "Peer failed to present a certificate");
+      return;
+    }
+
   peer_common_name = valent_certificate_get_common_name (peer_certificate);
   if (!valent_device_validate_id (peer_common_name))
     {
@@ -217,31 +244,20 @@ g_tls_connection_handshake_cb (GTlsConnection *connection,
       return;
     }
 
-  /* If @trusted is not provided, try to find a certificate in a device
-   * config directory. If neither are found, the certificate is verified
-   * as self-signed before being accepted per the trust-on-first-use policy.
-   *
-   * TODO: this should be handled by a managed cache object
-   */
   trusted = g_task_get_task_data (task);
+  /* If @trusted is not provided, look up the certificate of a paired device.
+   * If neither are found, the certificate is verified as self-signed before
+   * being accepted per the trust-on-first-use policy.
+   */
   if (trusted != NULL)
-    {
-      ca_certificate = g_object_ref (trusted);
-    }
+    ca_certificate = g_object_ref (trusted);
   else
-    {
-      g_autofree char *trusted_path = NULL;
-
-      trusted_path = g_build_filename (g_get_user_config_dir(), PACKAGE_NAME,
-                                       "device", peer_common_name,
-                                       "certificate.pem",
-                                       NULL);
-      ca_certificate = g_tls_certificate_new_from_file (trusted_path, NULL);
-      if (ca_certificate == NULL)
-        ca_certificate = g_object_ref (peer_certificate);
-    }
+    ca_certificate = valent_certificate_ref_trusted (peer_common_name);
+
+  if (ca_certificate == NULL)
+    ca_certificate = g_object_ref (peer_certificate);
 
-  errors = g_tls_certificate_verify (peer_certificate, NULL, ca_certificate);
+  errors = valent_lan_certificate_verify (peer_certificate, ca_certificate);
   if (errors != G_TLS_CERTIFICATE_NO_FLAGS)
     {
       g_autofree char *errors_str = NULL;
@@ -264,36 +280,15 @@ g_tls_connection_handshake_cb (GTlsConnection *connection,
   g_task_return_pointer (task, g_object_ref (connection), g_object_unref);
 }
 
-/**
- * valent_lan_connection_handshake_async:
- * @connection: a `GSocketConnection`
- * @certificate: a `GTlsCertificate`
- * @trusted: (nullable): a `GTlsCertificate`
- * @is_client: %TRUE for client connection, or %FALSE for a server connection
- * @cancellable: (nullable): a `GCancellable`
- * @callback: (scope async): a `GAsyncReadyCallback`
- * @user_data: user supplied data
- *
- * Wrap @connection in a [class@Gio.TlsConnection] and perform the handshake.
- *
- * If @trusted is not %NULL, the remote device will be expected to handshake
- * use the same certificate, otherwise trusted devices will be searched for
- * a certificate. If the device is unknown, the certificate will be verified
- * as self-signed and accepted on a trust-on-first-use basis.
- *
- * If @is_client is %TRUE, this will create a [class@Gio.TlsClientConnection],
- * otherwise a [class@Gio.TlsServerConnection].
- *
- * Call [func@Valent.lan_connection_handshake_finish] to get the result.
- */
-void
-valent_lan_connection_handshake_async (GSocketConnection   *connection,
-                                       GTlsCertificate     *certificate,
-                                       GTlsCertificate     *trusted,
-                                       gboolean             is_client,
-                                       GCancellable        *cancellable,
-                                       GAsyncReadyCallback  callback,
-                                       gpointer             user_data)
+static void
+valent_lan_connection_handshake_internal (GSocketConnection   *connection,
+                                          GTlsCertificate     *certificate,
+                                          GTlsCertificate     *trusted,
+                                          gboolean             is_client,
+                                          GTlsConnection      *session,
+                                          GCancellable        *cancellable,
+                                          GAsyncReadyCallback  callback,
+                                          gpointer             user_data)
 {
   GTlsBackend *backend;
   g_autoptr (GTask) task = NULL;
@@ -303,6 +298,7 @@ valent_lan_connection_handshake_async (GSocketConnection   *connection,
   g_assert (G_IS_SOCKET_CONNECTION (connection));
   g_assert (G_IS_TLS_CERTIFICATE (certificate));
   g_assert (trusted == NULL || G_IS_TLS_CERTIFICATE (trusted));
+  g_assert (session == NULL || (is_client && G_IS_TLS_CLIENT_CONNECTION (session)));
   g_assert (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
   task = g_task_new (connection, cancellable, callback, user_data);
@@ -356,6 +352,15 @@ valent_lan_connection_handshake_async (GSocketConnection   *connection,
       return;
     }
 
+  /* Resume the session of a previous auxiliary connection, if possible, to
+   * skip the key exchange and certificate exchange for each payload.
+   */
+  if (session != NULL)
+    {
+      g_tls_client_connection_copy_session_state (G_TLS_CLIENT_CONNECTION (ret),
+                                                  G_TLS_CLIENT_CONNECTION (session));
+    }
+
   g_signal_connect (G_TLS_CONNECTION (ret),
                     "accept-certificate",
                     G_CALLBACK (valent_lan_connection_accept_certificate_cb),
@@ -367,6 +372,95 @@ valent_lan_connection_handshake_async (GSocketConnection   *connection,
                                     g_object_ref (task));
 }
 
+/**
+ * valent_lan_connection_handshake_async:
+ * @connection: a `GSocketConnection`
+ * @certificate: a `GTlsCertificate`
+ * @trusted: (nullable): a `GTlsCertificate`
+ * @is_client: %TRUE for client connection, or %FALSE for a server connection
+ * @cancellable: (nullable): a `GCancellable`
+ * @callback: (scope async): a `GAsyncReadyCallback`
+ * @user_data: user supplied data
+ *
+ * Wrap @connection in a [class@Gio.TlsConnection] and perform the handshake.
+ *
+ * If @trusted is not %NULL, the remote device will be expected to handshake
+ * use the same certificate, otherwise trusted devices will be searched for
+ * a certificate. If the device is unknown, the certificate will be verified
+ * as self-signed and accepted on a trust-on-first-use basis.
+ *
+ * If @is_client is %TRUE, this will create a [class@Gio.TlsClientConnection],
+ * otherwise a [class@Gio.TlsServerConnection].
+ *
+ * Call [func@Valent.lan_connection_handshake_finish] to get the result.
+ */
+void
+valent_lan_connection_handshake_async (GSocketConnection   *connection,
+                                       GTlsCertificate     *certificate,
+                                       GTlsCertificate     *trusted,
+                                       gboolean             is_client,
+                                       GCancellable        *cancellable,
+                                       GAsyncReadyCallback  callback,
+                                       gpointer             user_data)
+{
+  g_assert (G_IS_SOCKET_CONNECTION (connection));
+  g_assert (G_IS_TLS_CERTIFICATE (certificate));
+  g_assert (trusted == NULL || G_IS_TLS_CERTIFICATE (trusted));
+  g_assert (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  valent_lan_connection_handshake_internal (connection,
+                                            certificate,
+                                            trusted,
+                                            is_client,
+                                            NULL,
+                                            cancellable,
+                                            callback,
+                                            user_data);
+}
+
+/**
+ * valent_lan_connection_handshake_resume_async:
+ * @connection: a `GSocketConnection`
+ * @certificate: a `GTlsCertificate`
+ * @trusted: (nullable): a `GTlsCertificate`
+ * @session: (nullable): a `GTlsClientConnection`
+ * @cancellable: (nullable): a `GCancellable`
+ * @callback: (scope async): a `GAsyncReadyCallback`
+ * @user_data: user supplied data
+ *
+ * Like [func@Valent.lan_connection_handshake_async], but as a TLS client
+ * attempting to resume the session state of @session.
+ *
+ * If the server refuses to resume the session, a full handshake is performed
+ * and the peer certificate is verified as usual.
+ *
+ * Call [func@Valent.lan_connection_handshake_finish] to get the result.
+ */
+void
+valent_lan_connection_handshake_resume_async (GSocketConnection   *connection,
+                                              GTlsCertificate     *certificate,
+                                              GTlsCertificate     *trusted,
+                                              GTlsConnection      *session,
+                                              GCancellable        *cancellable,
+                                              GAsyncReadyCallback  callback,
+                                              gpointer             user_data)
+{
+  g_assert (G_IS_SOCKET_CONNECTION (connection));
+  g_assert (G_IS_TLS_CERTIFICATE (certificate));
+  g_assert (trusted == NULL || G_IS_TLS_CERTIFICATE (trusted));
+  g_assert (session == NULL || G_IS_TLS_CLIENT_CONNECTION (session));
+  g_assert (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  valent_lan_connection_handshake_internal (connection,
+                                            certificate,
+                                            trusted,
+                                            TRUE, /* is_client */
+                                            session,
+                                            cancellable,
+                                            callback,
+                                            user_data);
+}
+
 /**
  * valent_lan_connection_handshake_finish:
  * @connection: a `GSocketConnection`
@@ -430,47 +524,80 @@ valent_lan_connection_handshake_future (GSocketConnection *connection,
   return DEX_FUTURE (g_steal_pointer (&promise));
 }
 
+typedef struct
+{
+  DexPromise *promise;
+  GByteArray *unread;
+} PacketReadData;
+
 static void
 valent_packet_from_stream_cb (GInputStream *stream,
                               GAsyncResult *result,
                               gpointer      user_data)
 {
-  g_autoptr (DexPromise) promise = DEX_PROMISE (g_steal_pointer (&user_data));
+  PacketReadData *data = (PacketReadData *)user_data;
+  g_autoptr (DexPromise) promise = g_steal_pointer (&data->promise);
+  g_autoptr (GByteArray) unread = g_steal_pointer (&data->unread);
+  g_autoptr (GBytes) bytes = NULL;
   g_autoptr (GError) error = NULL;
   JsonNode *node = NULL;
 
-  node = valent_packet_from_stream_finish (stream, result, &error);
+  g_free (data);
+
+  node = valent_packet_from_stream_full_finish (stream, result, &bytes, &error);
   if (node == NULL)
-    dex_promise_reject (promise, g_steal_pointer (&error));
-  else
-    dex_promise_resolve_boxed (promise, JSON_TYPE_NODE, node);
+    {
+      dex_promise_reject (promise, g_steal_pointer (&error));
+      return;
+    }
+
+  if (bytes != NULL && unread != NULL)
+    {
+      g_byte_array_append (unread,
+                           g_bytes_get_data (bytes, NULL),
+                           g_bytes_get_size (bytes));
+    }
+
+  dex_promise_resolve_boxed (promise, JSON_TYPE_NODE, node);
 }
 
 /**
  * valent_packet_from_stream_future:
  * @stream: a `GInputStream`
  * @max_len: the maximum number bytes to read, or `-1` for no limit
+ * @unread: (nullable): a `GByteArray`
  * @cancellable: (nullable): a `GCancellable`
  *
- * A convenience function for writing a KDE Connect packet to an output stream.
+ * A convenience function for reading a KDE Connect packet from an input stream.
+ *
+ * If @unread is not %NULL, @stream will be read in chunks and any data
+ * following the packet will be appended to @unread. Otherwise the stream will
+ * not be read past the end of the packet.
  *
  * Returns: (transfer full): a `DexFuture` for the operation
  */
 DexFuture *
 valent_packet_from_stream_future (GInputStream *stream,
                                   gssize        max_len,
+                                  GByteArray   *unread,
                                   GCancellable *cancellable)
 {
   DexPromise *promise = dex_promise_new_cancellable ();
+  PacketReadData *data = NULL;
 
   g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
   g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 
-  valent_packet_from_stream (stream,
-                             max_len,
-                             cancellable,
-                             (GAsyncReadyCallback)valent_packet_from_stream_cb,
-                             dex_ref (promise));
+  data = g_new0 (PacketReadData, 1);
+  data->promise = dex_ref (promise);
+  data->unread = (unread != NULL) ? g_byte_array_ref (unread) : NULL;
+
+  valent_packet_from_stream_full (stream,
+                                  max_len,
+                                  (unread != NULL) ? 0 : 1,
+                                  cancellable,
+                                  (GAsyncReadyCallback)valent_packet_from_stream_cb,
+                                  data);
   return DEX_FUTURE (g_steal_pointer (&promise));
 }
 
@@ -517,3 +644,94 @@ valent_packet_to_stream_future (GOutputStream *stream,
   return DEX_FUTURE (g_steal_pointer (&promise));
 }
 
+
+#define SOCKET_BATCH_MAX (64)
+
+/**
+ * valent_lan_socket_send_batch:
+ * @socket: a non-blocking UDP `GSocket`
+ * @targets: (element-type GSocketAddress): a list of destinations
+ * @offset: the index of the first destination in @targets
+ * @bytes: the datagram to send
+ * @error: (nullable): a `GError`
+ *
+ * Send @bytes to each address in @targets, starting at @offset, with as few
+ * system calls as possible.
+ *
+ * Datagrams are sent in batches with [method@Gio.Socket.send_messages]. If
+ * sending to a destination fails, a warning is logged for that destination and
+ * the batch continues with the next one.
+ *
+ * If the socket would block, this function returns early with @error set to
+ * %G_IO_ERROR_WOULD_BLOCK and the caller should try again when @socket is
+ * writable, starting at the returned index.
+ *
+ * Returns: the index of the first unsent destination in @targets
+ */
+unsigned int
+valent_lan_socket_send_batch (GSocket     *socket,
+                              GPtrArray   *targets,
+                              unsigned int offset,
+                              GBytes      *bytes,
+                              GError     **error)
+{
+  GOutputVector vector;
+  GOutputMessage messages[SOCKET_BATCH_MAX];
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), offset);
+  g_return_val_if_fail (targets != NULL, offset);
+  g_return_val_if_fail (bytes != NULL, offset);
+  g_return_val_if_fail (error == NULL || *error == NULL, offset);
+
+  vector.buffer = g_bytes_get_data (bytes, &vector.size);
+
+  while (offset < targets->len)
+    {
+      unsigned int n_messages = MIN (targets->len - offset, SOCKET_BATCH_MAX);
+      int n_sent;
+      g_autoptr (GError) local_error = NULL;
+
+      for (unsigned int i = 0; i < n_messages; i++)
+        {
+          messages[i] = (GOutputMessage){
+            .address = g_ptr_array_index (targets, offset + i),
+            .vectors = &vector,
+            .num_vectors = 1,
+          };
+        }
+
+      n_sent = g_socket_send_messages (socket,
+                                       messages,
+                                       n_messages,
+                                       0,    /* flags */
+                                       NULL, /* cancellable */
+                                       &local_error);
+      if (n_sent > 0)
+        {
+          offset += (unsigned int)n_sent;
+          continue;
+        }
+
+      if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+        {
+          g_propagate_error (error, g_steal_pointer (&local_error));
+          break;
+        }
+
+      /* An error applies to the first message in the batch, so it is
+       * reported and skipped before continuing with the rest.
+       */
+      if (local_error != NULL)
+        {
+          g_autofree char *host = NULL;
+
+          host = g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (messages[0].address));
+          g_warning ("%s(): failed to announce to \"%s\": %s",
+                     G_STRFUNC, host, local_error->message);
+        }
+
+      offset++;
+    }
+
+  return offset;
+}
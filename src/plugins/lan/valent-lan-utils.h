@@ -67,6 +67,14 @@ void        valent_lan_connection_handshake_async  (GSocketConnection    *connec
                                                     GCancellable         *cancellable,
                                                     GAsyncReadyCallback   callback,
                                                     gpointer              user_data);
+void        valent_lan_connection_handshake_resume_async
+                                                   (GSocketConnection    *connection,
+                                                    GTlsCertificate      *certificate,
+                                                    GTlsCertificate      *trusted,
+                                                    GTlsConnection       *session,
+                                                    GCancellable         *cancellable,
+                                                    GAsyncReadyCallback   callback,
+                                                    gpointer              user_data);
 GIOStream * valent_lan_connection_handshake_finish (GSocketConnection    *connection,
                                                     GAsyncResult         *result,
                                                     GError              **error);
@@ -77,10 +85,16 @@ DexFuture * valent_lan_connection_handshake_future (GSocketConnection    *connec
                                                     GCancellable         *cancellable);
 DexFuture * valent_packet_from_stream_future       (GInputStream         *stream,
                                                     gssize                max_len,
+                                                    GByteArray           *unread,
                                                     GCancellable         *cancellable);
 DexFuture * valent_packet_to_stream_future         (GOutputStream        *stream,
                                                     JsonNode             *packet,
                                                     GCancellable         *cancellable);
+unsigned int valent_lan_socket_send_batch          (GSocket              *socket,
+                                                    GPtrArray            *targets,
+                                                    unsigned int          offset,
+                                                    GBytes               *bytes,
+                                                    GError              **error);
 
 G_END_DECLS
 
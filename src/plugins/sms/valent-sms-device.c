@@ -15,6 +15,24 @@
 
 #define GET_TIMESTAMP_RQ  "/ca/andyholmes/Valent/sparql/get-timestamp.rq"
 
+/* Incoming messages are queued and committed in batches of whole packets, up
+ * to INGEST_BATCH_MAX messages, with at most INGEST_IN_FLIGHT_MAX batches
+ * executing at once. While more than INGEST_QUEUE_MAX messages are waiting,
+ * further conversation requests are deferred until half the queue drains.
+ */
+#define INGEST_BATCH_MAX     (1000)
+#define INGEST_IN_FLIGHT_MAX (2)
+#define INGEST_QUEUE_MAX     (10000)
+
+/* The progress of each conversation being synced is kept in a key file, so an
+ * interrupted sync can resume where it left off. Each thread ID has a group
+ * with the date of the newest message when the sync started, the date of the
+ * next page to request, and the date of the newest message already in the
+ * graph. The file is only written while the ingest queue is idle, so it never
+ * claims messages that have not been committed.
+ */
+#define SYNC_STATE_FILE      "sync-state.ini"
+
 struct _ValentSmsDevice
 {
   ValentMessagesAdapter    parent_instance;
@@ -26,6 +44,24 @@ struct _ValentSmsDevice
   GCancellable            *cancellable;
   GPtrArray               *message_requests;
   GQueue                   attachment_requests;
+
+  /* sync */
+  GQueue                   sync_queue;
+  unsigned int             sync_requests;
+  GKeyFile                *sync_state;
+  gboolean                 sync_state_dirty;
+  gboolean                 sync_state_saving;
+
+  /* ingest */
+  GQueue                   ingest_queue;
+  unsigned int             ingest_queued;
+  unsigned int             ingest_in_flight;
+  unsigned int             ingest_committed;
+  unsigned int             ingest_period;
+  unsigned int             ingest_failed;
+  int64_t                  ingest_started;
+  int64_t                  ingest_finished;
+  unsigned int             ingest_id;
 };
 
 static void   attachment_request_next                 (ValentSmsDevice *self);
@@ -37,6 +73,12 @@ static void   valent_sms_device_request_attachment    (ValentSmsDevice *self,
                                                        int64_t          thread_id,
                                                        const char      *unique_identifier);
 static void   message_request_free                    (gpointer         data);
+static void   message_requests_resume                 (ValentSmsDevice *self);
+static void   message_requests_schedule               (ValentSmsDevice *self);
+static void   sync_state_load                         (ValentSmsDevice *self);
+static void   sync_state_save                         (ValentSmsDevice *self);
+static void   valent_sms_device_set_sync_requests     (ValentSmsDevice *self,
+                                                       unsigned int     sync_requests);
 static void   valent_sms_device_request_conversation  (ValentSmsDevice *self,
                                                        int64_t          thread_id,
                                                        int64_t          range_start_timestamp,
@@ -44,6 +86,12 @@ static void   valent_sms_device_request_conversation  (ValentSmsDevice *self,
 
 G_DEFINE_FINAL_TYPE (ValentSmsDevice, valent_sms_device, VALENT_TYPE_MESSAGES_ADAPTER)
 
+typedef enum {
+  PROP_SYNC_REQUESTS = 1,
+} ValentSmsDeviceProperty;
+
+static GParamSpec *properties[PROP_SYNC_REQUESTS + 1] = { NULL, };
+
 
 typedef struct
 {
@@ -513,24 +561,10 @@ valent_message_resource_from_json (ValentSmsDevice *self,
 }
 
 static void
-execute_add_messages_cb (TrackerBatch *batch,
-                         GAsyncResult *result,
-                         gpointer      user_data)
-{
-  g_autoptr (GError) error = NULL;
-
-  if (!tracker_batch_execute_finish (batch, result, &error) &&
-      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-    {
-      g_warning ("%s(): %s", G_STRFUNC, error->message);
-    }
-}
-
-static void
-valent_sms_device_add_json (ValentSmsDevice *self,
-                            JsonNode        *messages)
+valent_sms_device_batch_add_json (ValentSmsDevice *self,
+                                  TrackerBatch    *batch,
+                                  JsonNode        *messages)
 {
-  g_autoptr (TrackerBatch) batch = NULL;
   g_autoptr (TrackerResource) thread = NULL;
   const char *base_urn = NULL;
   g_autofree char *thread_urn = NULL;
@@ -541,13 +575,11 @@ valent_sms_device_add_json (ValentSmsDevice *self,
   unsigned int n_messages;
 
   g_assert (VALENT_IS_SMS_DEVICE (self));
+  g_assert (TRACKER_IS_BATCH (batch));
   g_assert (JSON_NODE_HOLDS_ARRAY (messages));
 
-  batch = tracker_sparql_connection_create_batch (self->connection);
-
   messages_ = json_node_get_array (messages);
   n_messages = json_array_get_length (messages_);
-  g_return_if_fail (n_messages > 0);
 
   first_message = json_node_get_object (json_array_get_element (messages_, 0));
   node = json_object_get_member (first_message, "thread_id");
@@ -574,11 +606,380 @@ valent_sms_device_add_json (ValentSmsDevice *self,
       if (resource != NULL)
         tracker_batch_add_resource (batch, VALENT_MESSAGES_GRAPH, resource);
     }
+}
 
-  tracker_batch_execute_async (batch,
-                               self->cancellable,
-                               (GAsyncReadyCallback) execute_add_messages_cb,
-                               NULL);
+static void   valent_sms_device_ingest_next (ValentSmsDevice *self);
+
+static void
+execute_add_messages_cb (TrackerBatch *batch,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+  g_autoptr (ValentSmsDevice) self = VALENT_SMS_DEVICE (user_data);
+  unsigned int n_messages = 0;
+  g_autoptr (GError) error = NULL;
+
+  n_messages = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (batch),
+                                                    "valent-sms-batch-size"));
+  self->ingest_in_flight -= 1;
+
+  if (tracker_batch_execute_finish (batch, result, &error))
+    {
+      self->ingest_committed += n_messages;
+      self->ingest_period += n_messages;
+    }
+  else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_warning ("%s(): %s", G_STRFUNC, error->message);
+      self->ingest_failed += 1;
+    }
+
+  VALENT_NOTE ("committed %u of %u messages (%u queued, %u in flight)",
+               error == NULL ? n_messages : 0,
+               n_messages,
+               self->ingest_queued,
+               self->ingest_in_flight);
+
+  valent_sms_device_ingest_next (self);
+}
+
+static void
+valent_sms_device_ingest_next (ValentSmsDevice *self)
+{
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+
+  while (self->ingest_in_flight < INGEST_IN_FLIGHT_MAX &&
+         !g_queue_is_empty (&self->ingest_queue))
+    {
+      g_autoptr (TrackerBatch) batch = NULL;
+      g_autoptr (GCancellable) destroy = NULL;
+      unsigned int n_batched = 0;
+
+      /* Merge whole packets into the batch; an oversized packet is committed
+       * on its own rather than split.
+       */
+      batch = tracker_sparql_connection_create_batch (self->connection);
+      while (!g_queue_is_empty (&self->ingest_queue))
+        {
+          JsonNode *next = g_queue_peek_head (&self->ingest_queue);
+          g_autoptr (JsonNode) messages = NULL;
+          unsigned int n_messages;
+
+          n_messages = json_array_get_length (json_node_get_array (next));
+          if (n_batched > 0 && n_batched + n_messages > INGEST_BATCH_MAX)
+            break;
+
+          messages = g_queue_pop_head (&self->ingest_queue);
+          valent_sms_device_batch_add_json (self, batch, messages);
+          n_batched += n_messages;
+        }
+
+      self->ingest_queued -= n_batched;
+      self->ingest_in_flight += 1;
+
+      /* Messages already received are committed even if the device
+       * disconnects, so only cancel if the adapter is destroyed.
+       */
+      destroy = valent_object_ref_cancellable (VALENT_OBJECT (self));
+      g_object_set_data (G_OBJECT (batch),
+                         "valent-sms-batch-size",
+                         GUINT_TO_POINTER (n_batched));
+      tracker_batch_execute_async (batch,
+                                   destroy,
+                                   (GAsyncReadyCallback) execute_add_messages_cb,
+                                   g_object_ref (self));
+    }
+
+  if (self->ingest_queued < INGEST_QUEUE_MAX / 2)
+    message_requests_resume (self);
+
+  if (self->ingest_in_flight == 0 && self->ingest_finished == 0)
+    {
+      double rate = 0.0;
+
+      self->ingest_finished = g_get_monotonic_time ();
+      if (self->ingest_finished > self->ingest_started)
+        {
+          rate = self->ingest_period /
+                 ((self->ingest_finished - self->ingest_started) / (double)G_USEC_PER_SEC);
+        }
+
+      g_debug ("%s(): imported %u messages (%.0f/s)",
+               G_STRFUNC,
+               self->ingest_period,
+               rate);
+
+      /* If every batch succeeded, each received page is now in the graph.
+       * Otherwise roll back to the last saved state, so the ranges in the
+       * failed batches are requested again by the next sync.
+       */
+      if (self->ingest_failed == 0)
+        {
+          sync_state_save (self);
+        }
+      else
+        {
+          g_warning ("%s(): %u batches failed; discarding sync state",
+                     G_STRFUNC,
+                     self->ingest_failed);
+          sync_state_load (self);
+        }
+    }
+}
+
+static gboolean
+valent_sms_device_ingest_idle (gpointer data)
+{
+  ValentSmsDevice *self = VALENT_SMS_DEVICE (data);
+
+  self->ingest_id = 0;
+  valent_sms_device_ingest_next (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static inline gboolean
+valent_sms_device_ingest_is_full (ValentSmsDevice *self)
+{
+  return self->ingest_queued >= INGEST_QUEUE_MAX;
+}
+
+/*< private >
+ * valent_sms_device_add_json:
+ * @self: a `ValentSmsDevice`
+ * @messages: a JSON array of messages in the same thread
+ *
+ * Queue @messages to be added to the graph.
+ *
+ * The queue is flushed when the main loop is idle, so packets received in the
+ * same iteration, or while a batch is executing, are merged into the next
+ * batch.
+ */
+static void
+valent_sms_device_add_json (ValentSmsDevice *self,
+                            JsonNode        *messages)
+{
+  unsigned int n_messages;
+
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+  g_assert (JSON_NODE_HOLDS_ARRAY (messages));
+
+  n_messages = json_array_get_length (json_node_get_array (messages));
+  if (n_messages == 0)
+    return;
+
+  /* Start a new progress period if the pipeline was idle
+   */
+  if (self->ingest_finished != 0 || self->ingest_started == 0)
+    {
+      self->ingest_started = g_get_monotonic_time ();
+      self->ingest_finished = 0;
+      self->ingest_period = 0;
+      self->ingest_failed = 0;
+    }
+
+  g_queue_push_tail (&self->ingest_queue, json_node_ref (messages));
+  self->ingest_queued += n_messages;
+
+  if (self->ingest_id == 0)
+    {
+      self->ingest_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                                         valent_sms_device_ingest_idle,
+                                         g_object_ref (self),
+                                         g_object_unref);
+      g_source_set_name_by_id (self->ingest_id, "[valent-sms-device] ingest");
+    }
+}
+
+/*< private >
+ * valent_sms_device_get_ingest_progress:
+ * @self: a `ValentSmsDevice`
+ * @n_queued: (out) (optional): the number of messages waiting to be committed
+ * @n_committed: (out) (optional): the total number of messages committed
+ * @rate: (out) (optional): the number of messages committed per second
+ *
+ * Get the progress of the message import. The rate is measured over the
+ * current (or most recent) period of activity, which begins when a message is
+ * queued and ends when no batches remain.
+ */
+void
+valent_sms_device_get_ingest_progress (ValentSmsDevice *self,
+                                       unsigned int    *n_queued,
+                                       unsigned int    *n_committed,
+                                       double          *rate)
+{
+  int64_t elapsed = 0;
+
+  g_return_if_fail (VALENT_IS_SMS_DEVICE (self));
+
+  if (self->ingest_started != 0)
+    {
+      if (self->ingest_finished != 0)
+        elapsed = self->ingest_finished - self->ingest_started;
+      else
+        elapsed = g_get_monotonic_time () - self->ingest_started;
+    }
+
+  if (n_queued != NULL)
+    *n_queued = self->ingest_queued;
+
+  if (n_committed != NULL)
+    *n_committed = self->ingest_committed;
+
+  if (rate != NULL)
+    {
+      *rate = elapsed > 0
+            ? self->ingest_period / (elapsed / (double)G_USEC_PER_SEC)
+            : 0.0;
+    }
+}
+
+/*
+ * Sync State
+ */
+static void
+sync_state_load (ValentSmsDevice *self)
+{
+  ValentContext *context = NULL;
+  g_autoptr (GFile) file = NULL;
+  g_autoptr (GError) error = NULL;
+
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+
+  context = valent_extension_get_context (VALENT_EXTENSION (self));
+  file = valent_context_get_data_file (context, SYNC_STATE_FILE);
+
+  g_clear_pointer (&self->sync_state, g_key_file_unref);
+  self->sync_state = g_key_file_new ();
+  self->sync_state_dirty = FALSE;
+  if (!g_key_file_load_from_file (self->sync_state,
+                                  g_file_peek_path (file),
+                                  G_KEY_FILE_NONE,
+                                  &error) &&
+      !g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+    {
+      g_warning ("%s(): %s", G_STRFUNC, error->message);
+    }
+}
+
+static void
+sync_state_save_cb (GFile        *file,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  g_autoptr (ValentSmsDevice) self = VALENT_SMS_DEVICE (user_data);
+  g_autoptr (GError) error = NULL;
+
+  if (!g_file_replace_contents_finish (file, result, NULL, &error))
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
+      g_warning ("%s(): %s", G_STRFUNC, error->message);
+    }
+
+  /* Changes made during the write are only safe to save once the ingest
+   * queue is idle again, with no failed batches
+   */
+  self->sync_state_saving = FALSE;
+  if (self->ingest_in_flight == 0 &&
+      self->ingest_failed == 0 &&
+      g_queue_is_empty (&self->ingest_queue))
+    sync_state_save (self);
+}
+
+/*< private >
+ * sync_state_save:
+ * @self: a `ValentSmsDevice`
+ *
+ * Write the sync state to disk, if it has changed. This should only be called
+ * when the ingest queue is idle, and writes are serialized.
+ */
+static void
+sync_state_save (ValentSmsDevice *self)
+{
+  ValentContext *context = NULL;
+  g_autoptr (GFile) file = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GCancellable) destroy = NULL;
+  char *data = NULL;
+  size_t len = 0;
+
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+
+  if (!self->sync_state_dirty || self->sync_state_saving)
+    return;
+
+  context = valent_extension_get_context (VALENT_EXTENSION (self));
+  file = valent_context_get_data_file (context, SYNC_STATE_FILE);
+  data = g_key_file_to_data (self->sync_state, &len, NULL);
+  bytes = g_bytes_new_take (data, len);
+
+  self->sync_state_dirty = FALSE;
+  self->sync_state_saving = TRUE;
+
+  destroy = valent_object_ref_cancellable (VALENT_OBJECT (self));
+  g_file_replace_contents_bytes_async (file,
+                                       bytes,
+                                       NULL,
+                                       FALSE,
+                                       G_FILE_CREATE_REPLACE_DESTINATION,
+                                       destroy,
+                                       (GAsyncReadyCallback) sync_state_save_cb,
+                                       g_object_ref (self));
+}
+
+static gboolean
+sync_state_lookup (ValentSmsDevice *self,
+                   int64_t          thread_id,
+                   int64_t         *newest_date,
+                   int64_t         *cursor_date,
+                   int64_t         *oldest_date)
+{
+  g_autofree char *group = NULL;
+
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+
+  group = g_strdup_printf ("%"PRId64, thread_id);
+  if (!g_key_file_has_group (self->sync_state, group))
+    return FALSE;
+
+  *newest_date = g_key_file_get_int64 (self->sync_state, group, "newest", NULL);
+  *cursor_date = g_key_file_get_int64 (self->sync_state, group, "cursor", NULL);
+  *oldest_date = g_key_file_get_int64 (self->sync_state, group, "oldest", NULL);
+
+  return TRUE;
+}
+
+static void
+sync_state_update (ValentSmsDevice *self,
+                   int64_t          thread_id,
+                   int64_t          newest_date,
+                   int64_t          cursor_date,
+                   int64_t          oldest_date)
+{
+  g_autofree char *group = NULL;
+
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+
+  group = g_strdup_printf ("%"PRId64, thread_id);
+  g_key_file_set_int64 (self->sync_state, group, "newest", newest_date);
+  g_key_file_set_int64 (self->sync_state, group, "cursor", cursor_date);
+  g_key_file_set_int64 (self->sync_state, group, "oldest", oldest_date);
+  self->sync_state_dirty = TRUE;
+}
+
+static void
+sync_state_remove (ValentSmsDevice *self,
+                   int64_t          thread_id)
+{
+  g_autofree char *group = NULL;
+
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+
+  group = g_strdup_printf ("%"PRId64, thread_id);
+  if (g_key_file_remove_group (self->sync_state, group, NULL))
+    self->sync_state_dirty = TRUE;
 }
 
 static void
@@ -860,6 +1261,12 @@ on_device_state_changed (ValentDevice    *device,
     {
       g_cancellable_cancel (self->cancellable);
       g_clear_object (&self->cancellable);
+
+      /* Progress is kept in the sync state, so the requests are resumed after
+       * the next `kdeconnect.sms.request_conversations`
+       */
+      g_ptr_array_set_size (self->message_requests, 0);
+      g_queue_clear_full (&self->sync_queue, message_request_free);
     }
 }
 
@@ -882,6 +1289,8 @@ valent_sms_device_constructed (GObject *object)
 
   g_object_get (self, "connection",  &self->connection, NULL);
   g_assert (TRACKER_IS_SPARQL_CONNECTION (self->connection));
+
+  sync_state_load (self);
 }
 
 static void
@@ -890,7 +1299,10 @@ valent_sms_device_finalize (GObject *object)
   ValentSmsDevice *self = VALENT_SMS_DEVICE (object);
 
   g_queue_clear_full (&self->attachment_requests, attachment_request_free);
+  g_queue_clear_full (&self->ingest_queue, (GDestroyNotify)json_node_unref);
+  g_queue_clear_full (&self->sync_queue, message_request_free);
   g_clear_pointer (&self->message_requests, g_ptr_array_unref);
+  g_clear_pointer (&self->sync_state, g_key_file_unref);
   g_clear_object (&self->cancellable);
   g_clear_object (&self->connection);
   g_clear_object (&self->get_timestamp_stmt);
@@ -898,6 +1310,44 @@ valent_sms_device_finalize (GObject *object)
   G_OBJECT_CLASS (valent_sms_device_parent_class)->finalize (object);
 }
 
+static void
+valent_sms_device_get_property (GObject    *object,
+                                guint       prop_id,
+                                GValue     *value,
+                                GParamSpec *pspec)
+{
+  ValentSmsDevice *self = VALENT_SMS_DEVICE (object);
+
+  switch ((ValentSmsDeviceProperty)prop_id)
+    {
+    case PROP_SYNC_REQUESTS:
+      g_value_set_uint (value, self->sync_requests);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+valent_sms_device_set_property (GObject      *object,
+                                guint         prop_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+  ValentSmsDevice *self = VALENT_SMS_DEVICE (object);
+
+  switch ((ValentSmsDeviceProperty)prop_id)
+    {
+    case PROP_SYNC_REQUESTS:
+      valent_sms_device_set_sync_requests (self, g_value_get_uint (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
 static void
 valent_sms_device_class_init (ValentSmsDeviceClass *klass)
 {
@@ -906,14 +1356,34 @@ valent_sms_device_class_init (ValentSmsDeviceClass *klass)
 
   object_class->constructed = valent_sms_device_constructed;
   object_class->finalize = valent_sms_device_finalize;
+  object_class->get_property = valent_sms_device_get_property;
+  object_class->set_property = valent_sms_device_set_property;
 
   adapter_class->send_message = valent_sms_device_send_message;
+
+  /**
+   * ValentSmsDevice:sync-requests:
+   *
+   * The maximum number of conversations to request at once, while syncing.
+   */
+  properties [PROP_SYNC_REQUESTS] =
+    g_param_spec_uint ("sync-requests", NULL, NULL,
+                       1, 16,
+                       4,
+                       (G_PARAM_READWRITE |
+                        G_PARAM_CONSTRUCT |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, G_N_ELEMENTS (properties), properties);
 }
 
 static void
 valent_sms_device_init (ValentSmsDevice *self)
 {
   g_queue_init (&self->attachment_requests);
+  g_queue_init (&self->ingest_queue);
+  g_queue_init (&self->sync_queue);
   self->message_requests = g_ptr_array_new_with_free_func (message_request_free);
 }
 
@@ -1056,12 +1526,15 @@ valent_sms_device_get_timestamp_finish (ValentSmsDevice  *store,
 
 typedef struct
 {
-  ValentSmsDevice *self;
   JsonNode *pending;
   int64_t thread_id;
   int64_t start_date;
   int64_t end_date;
   int64_t max_results;
+  int64_t newest_date;
+  int64_t resume_date;
+  int64_t resume_cursor;
+  gboolean deferred;
 } MessageRequest;
 
 #define DEFAULT_MESSAGE_REQUEST (100)
@@ -1077,6 +1550,132 @@ message_request_free (gpointer data)
   g_free (request);
 }
 
+/*< private >
+ * message_request_advance:
+ * @request: a `MessageRequest`
+ * @date: the date of the next page
+ *
+ * Move the cursor of @request to @date, skipping over any range already
+ * received by an interrupted sync.
+ *
+ * Returns: %TRUE if there are more messages to request
+ */
+static gboolean
+message_request_advance (MessageRequest *request,
+                         int64_t         date)
+{
+  request->end_date = date;
+
+  if (request->resume_date > 0 &&
+      request->end_date <= request->resume_date &&
+      request->end_date > request->resume_cursor)
+    {
+      request->end_date = request->resume_cursor;
+    }
+
+  return request->start_date < request->end_date;
+}
+
+/*< private >
+ * message_request_send:
+ * @self: a `ValentSmsDevice`
+ * @request: a `MessageRequest`
+ *
+ * Request the next page for @request, unless the ingest queue is full, in
+ * which case it is sent by message_requests_resume() once the queue drains.
+ */
+static void
+message_request_send (ValentSmsDevice *self,
+                      MessageRequest  *request)
+{
+  request->deferred = valent_sms_device_ingest_is_full (self);
+  if (request->deferred)
+    return;
+
+  valent_sms_device_request_conversation (self,
+                                          request->thread_id,
+                                          request->end_date,
+                                          request->max_results);
+}
+
+/*< private >
+ * message_request_start:
+ * @self: a `ValentSmsDevice`
+ * @request: (transfer full): a `MessageRequest`
+ *
+ * Make @request active, recording it in the sync state and requesting the
+ * first page.
+ */
+static void
+message_request_start (ValentSmsDevice *self,
+                       MessageRequest  *request)
+{
+  if (request->pending != NULL)
+    {
+      valent_sms_device_add_json (self, request->pending);
+      g_clear_pointer (&request->pending, json_node_unref);
+    }
+
+  sync_state_update (self,
+                     request->thread_id,
+                     request->newest_date,
+                     request->end_date,
+                     request->start_date);
+  message_request_send (self, request);
+  g_ptr_array_add (self->message_requests, request);
+}
+
+/*< private >
+ * message_request_finish:
+ * @self: a `ValentSmsDevice`
+ * @index_: the index of the request
+ *
+ * Remove a completed request and its sync state, then start the next waiting
+ * request.
+ */
+static void
+message_request_finish (ValentSmsDevice *self,
+                        unsigned int     index_)
+{
+  MessageRequest *request = g_ptr_array_index (self->message_requests, index_);
+
+  VALENT_NOTE ("finished thread %"PRId64" (%u waiting)",
+               request->thread_id,
+               self->sync_queue.length);
+
+  sync_state_remove (self, request->thread_id);
+  g_ptr_array_remove_index (self->message_requests, index_);
+  message_requests_schedule (self);
+}
+
+static void
+message_requests_schedule (ValentSmsDevice *self)
+{
+  if (self->cancellable == NULL)
+    return;
+
+  while (self->message_requests->len < self->sync_requests &&
+         !g_queue_is_empty (&self->sync_queue))
+    {
+      message_request_start (self, g_queue_pop_head (&self->sync_queue));
+    }
+}
+
+static void
+message_requests_resume (ValentSmsDevice *self)
+{
+  if (self->cancellable == NULL)
+    return;
+
+  for (unsigned int i = 0; i < self->message_requests->len; i++)
+    {
+      MessageRequest *request = g_ptr_array_index (self->message_requests, i);
+
+      if (request->deferred)
+        message_request_send (self, request);
+    }
+}
+
 static gboolean
 find_message_request (gconstpointer a,
                       gconstpointer b)
@@ -1084,6 +1683,35 @@ find_message_request (gconstpointer a,
   return ((MessageRequest *)a)->thread_id == *((int64_t *)b);
 }
 
+static MessageRequest *
+find_waiting_request (ValentSmsDevice *self,
+                      int64_t          thread_id)
+{
+  for (const GList *iter = self->sync_queue.head; iter; iter = iter->next)
+    {
+      MessageRequest *request = iter->data;
+
+      if (request->thread_id == thread_id)
+        return request;
+    }
+
+  return NULL;
+}
+
+static void
+valent_sms_device_set_sync_requests (ValentSmsDevice *self,
+                                     unsigned int     sync_requests)
+{
+  g_assert (VALENT_IS_SMS_DEVICE (self));
+
+  if (self->sync_requests == sync_requests)
+    return;
+
+  self->sync_requests = sync_requests;
+  message_requests_schedule (self);
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SYNC_REQUESTS]);
+}
+
 static void
 find_message_range (JsonArray    *messages,
                     int64_t      *out_thread_id,
@@ -1123,6 +1751,7 @@ valent_sms_device_get_timestamp_cb (ValentSmsDevice *self,
 {
   g_autoptr (MessageRequest) request = g_steal_pointer (&user_data);
   int64_t cache_date;
+  int64_t newest_date, cursor_date, oldest_date;
   g_autoptr (GError) error = NULL;
 
   cache_date = valent_sms_device_get_timestamp_finish (self, result, &error);
@@ -1134,18 +1763,39 @@ valent_sms_device_get_timestamp_cb (ValentSmsDevice *self,
       return;
     }
 
-  if (cache_date < request->end_date)
+  /* If a previous sync was interrupted, walk down to where it started and
+   * skip the range it already received.
+   */
+  request->start_date = cache_date;
+  if (sync_state_lookup (self,
+                         request->thread_id,
+                         &newest_date,
+                         &cursor_date,
+                         &oldest_date))
     {
-      if (request->pending != NULL)
-        valent_sms_device_add_json (self, request->pending);
-
-      request->start_date = cache_date;
-      valent_sms_device_request_conversation (self,
-                                              request->thread_id,
-                                              request->end_date,
-                                              request->max_results);
-      g_ptr_array_add (self->message_requests, g_steal_pointer (&request));
+      VALENT_NOTE ("resuming thread %"PRId64" at %"PRId64,
+                   request->thread_id,
+                   cursor_date);
+
+      request->start_date = MIN (cache_date, oldest_date);
+      request->resume_date = newest_date;
+      request->resume_cursor = cursor_date;
     }
+
+  if (!message_request_advance (request, request->end_date))
+    return;
+
+  /* The thread may have been queued while the timestamp was queried
+   */
+  if (g_ptr_array_find_with_equal_func (self->message_requests,
+                                        &request->thread_id,
+                                        find_message_request,
+                                        NULL) ||
+      find_waiting_request (self, request->thread_id) != NULL)
+    return;
+
+  g_queue_push_tail (&self->sync_queue, g_steal_pointer (&request));
+  message_requests_schedule (self);
 }
 
 /**
@@ -1154,6 +1804,11 @@ valent_sms_device_get_timestamp_cb (ValentSmsDevice *self,
  * @packet: a `kdeconnect.sms.messages` packet
  *
  * Handle a packet of messages.
+ *
+ * A single message is taken as the latest in its thread, and if newer than
+ * the graph, the thread is queued to be synced. At most
+ * `ValentSmsDevice:sync-requests` threads are requested at once,
+ * each a page at a time, and pages already received are dropped.
  */
 void
 valent_sms_device_handle_messages (ValentSmsDevice *self,
@@ -1167,6 +1822,7 @@ valent_sms_device_handle_messages (ValentSmsDevice *self,
   int64_t thread_id;
   int64_t start_date = 0, end_date = 0;
   unsigned int index_ = 0;
+  MessageRequest *request = NULL;
 
   VALENT_ENTRY;
 
@@ -1207,39 +1863,63 @@ valent_sms_device_handle_messages (ValentSmsDevice *self,
                                         find_message_request,
                                         &index_))
     {
-      MessageRequest *request = g_ptr_array_index (self->message_requests, index_);
+      request = g_ptr_array_index (self->message_requests, index_);
 
       /* This is a response to our request
        */
       if (request->end_date == end_date)
         {
+          valent_sms_device_add_json (self, node);
+
           if (n_messages >= request->max_results &&
-              request->start_date < start_date)
+              message_request_advance (request, start_date))
             {
-              request->end_date = start_date;
-              valent_sms_device_request_conversation (self,
-                                                      request->thread_id,
-                                                      request->end_date,
-                                                      request->max_results);
+              sync_state_update (self,
+                                 request->thread_id,
+                                 request->newest_date,
+                                 request->end_date,
+                                 request->start_date);
+              message_request_send (self, request);
             }
           else
             {
-              g_ptr_array_remove_index (self->message_requests, index_);
+              message_request_finish (self, index_);
             }
         }
 
-      // FIXME: only store expected responses
-      valent_sms_device_add_json (self, node);
+      /* A page within the range already received, such as a repeated
+       * response, is dropped before it reaches the graph
+       */
+      else if (start_date >= request->end_date &&
+               end_date <= request->newest_date)
+        {
+          VALENT_NOTE ("dropping duplicate page for thread %"PRId64, thread_id);
+        }
+      else
+        {
+          valent_sms_device_add_json (self, node);
+        }
+    }
+  else if ((request = find_waiting_request (self, thread_id)) != NULL)
+    {
+      /* A newer message for a waiting thread just moves the starting point
+       */
+      if (n_messages == 1 && end_date > request->newest_date)
+        {
+          g_clear_pointer (&request->pending, json_node_unref);
+          request->pending = json_node_ref (node);
+          request->end_date = end_date;
+          request->newest_date = end_date;
+        }
     }
   else if (n_messages == 1)
     {
-      MessageRequest *request;
-
       request = g_new0 (MessageRequest, 1);
       request->pending = json_node_ref (node);
       request->thread_id = thread_id;
       request->start_date = end_date;
       request->end_date = end_date;
+      request->newest_date = end_date;
       request->max_results = DEFAULT_MESSAGE_REQUEST;
 
       valent_sms_device_get_timestamp (self,
@@ -16,5 +16,9 @@ void                 valent_sms_device_handle_messages        (ValentSmsDevice *
                                                                JsonNode        *packet);
 void                 valent_sms_device_handle_attachment_file (ValentSmsDevice *self,
                                                                JsonNode        *packet);
+void                 valent_sms_device_get_ingest_progress    (ValentSmsDevice *self,
+                                                               unsigned int    *n_queued,
+                                                               unsigned int    *n_committed,
+                                                               double          *rate);
 
 G_END_DECLS
@@ -109,12 +109,18 @@ valent_sms_plugin_constructed (GObject *object)
   ValentSmsPlugin *self = VALENT_SMS_PLUGIN (object);
   ValentComponent *component = NULL;
   ValentDevice *device = NULL;
+  GSettings *settings = NULL;
 
   G_OBJECT_CLASS (valent_sms_plugin_parent_class)->constructed (object);
 
   device = valent_object_get_parent (VALENT_OBJECT (self));
   self->adapter = valent_sms_device_new (device);
 
+  settings = valent_extension_get_settings (VALENT_EXTENSION (self));
+  g_settings_bind (settings,      "sync-requests",
+                   self->adapter, "sync-requests",
+                   G_SETTINGS_BIND_GET);
+
   component = VALENT_COMPONENT (valent_messages_get_default ());
   valent_component_export_adapter (component, VALENT_EXTENSION (self->adapter));
 
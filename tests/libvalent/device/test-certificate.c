@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // SPDX-FileCopyrightText: Andy Holmes <andrew.g.r.holmes@gmail.com>
 
+#include <glib/gstdio.h>
 #include <valent.h>
 #include <libvalent-test.h>
 
@@ -83,6 +84,50 @@ test_certificate_properties (void)
   g_clear_object (&certificate);
 }
 
+static void
+test_certificate_trusted (void)
+{
+  g_autoptr (GTlsCertificate) certificate = NULL;
+  g_autoptr (GTlsCertificate) trusted = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *certificate_path = NULL;
+  g_autofree char *device_id = NULL;
+
+  certificate = valent_certificate_new_sync (NULL, NULL);
+  device_id = g_strdup (valent_certificate_get_common_name (certificate));
+
+  VALENT_TEST_CHECK ("Unpaired devices have no trusted certificate");
+  trusted = valent_certificate_ref_trusted (device_id);
+  g_assert_null (trusted);
+
+  VALENT_TEST_CHECK ("Unpaired devices are not cached");
+  path = g_build_filename (g_get_user_config_dir (), "valent",
+                           "device", device_id,
+                           NULL);
+  g_mkdir_with_parents (path, 0700);
+  g_clear_object (&certificate);
+  certificate = valent_certificate_new_sync (path, NULL);
+  g_assert_true (G_IS_TLS_CERTIFICATE (certificate));
+
+  trusted = valent_certificate_ref_trusted (device_id);
+  g_assert_true (G_IS_TLS_CERTIFICATE (trusted));
+  g_assert_true (g_tls_certificate_is_same (trusted, certificate));
+  g_clear_object (&trusted);
+
+  VALENT_TEST_CHECK ("Paired devices are cached until invalidated");
+  certificate_path = g_build_filename (path, "certificate.pem", NULL);
+  g_assert_cmpint (g_remove (certificate_path), ==, 0);
+
+  trusted = valent_certificate_ref_trusted (device_id);
+  g_assert_true (G_IS_TLS_CERTIFICATE (trusted));
+  g_assert_true (g_tls_certificate_is_same (trusted, certificate));
+  g_clear_object (&trusted);
+
+  valent_certificate_invalidate (device_id);
+  trusted = valent_certificate_ref_trusted (device_id);
+  g_assert_null (trusted);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -91,8 +136,12 @@ main (int   argc,
 
   g_test_add_func ("/libvalent/device/certificate/new",
                    test_certificate_new);
+
   g_test_add_func ("/libvalent/device/certificate/properties",
                    test_certificate_properties);
 
+  g_test_add_func ("/libvalent/device/certificate/trusted",
+                   test_certificate_trusted);
+
   return g_test_run ();
 }
@@ -9,6 +9,26 @@
 #include "valent-mock-channel.h"
 #include "valent-mock-channel-service.h"
 
+#define N_QUEUED_PACKETS (16)
+
+/* The first packet is written immediately, while the rest are queued and
+ * should be sent in order of priority. Packets with a payload are not
+ * reordered unless the caller asks for it.
+ */
+static const struct
+{
+  const char *type;
+  int         io_priority;
+  gboolean    payload;
+} priority_packets[] = {
+  { "kdeconnect.mock.echo", G_PRIORITY_DEFAULT, FALSE },
+  { "kdeconnect.mock.echo", G_PRIORITY_LOW,     FALSE },
+  { "kdeconnect.mock.echo", G_PRIORITY_DEFAULT, FALSE },
+  { "kdeconnect.ping",      G_PRIORITY_DEFAULT, FALSE },
+  { "kdeconnect.mock.echo", G_PRIORITY_HIGH,    FALSE },
+  { "kdeconnect.mock.echo", G_PRIORITY_DEFAULT, TRUE  },
+};
+static const int64_t priority_order[] = { 0, 3, 4, 2, 5, 1 };
 
 typedef struct
 {
@@ -155,6 +175,30 @@ valent_channel_write_packet_cb (ValentChannel *channel,
   valent_test_quit_loop ();
 }
 
+static void
+valent_channel_write_packet_count_cb (ValentChannel *channel,
+                                      GAsyncResult  *result,
+                                      unsigned int  *n_written)
+{
+  GError *error = NULL;
+
+  valent_channel_write_packet_finish (channel, result, &error);
+  g_assert_no_error (error);
+
+  *n_written += 1;
+}
+
+static void
+valent_channel_read_packet_index_cb (ValentChannel  *channel,
+                                     GAsyncResult   *result,
+                                     JsonNode      **packet)
+{
+  GError *error = NULL;
+
+  *packet = valent_channel_read_packet_finish (channel, result, &error);
+  g_assert_no_error (error);
+}
+
 static void
 valent_test_upload_cb (ValentChannel *channel,
                        GAsyncResult  *result,
@@ -225,6 +269,7 @@ test_channel_service_channel (ChannelServiceFixture *fixture,
   g_autoptr (GTlsCertificate) endpoint_certificate = NULL;
   g_autoptr (GTlsCertificate) endpoint_peer_certificate = NULL;
   g_autoptr (GFile) file = NULL;
+  unsigned int n_written = 0;
   gboolean download_done = FALSE;
   gboolean upload_done = FALSE;
 
@@ -275,6 +320,73 @@ test_channel_service_channel (ChannelServiceFixture *fixture,
   valent_test_run_loop ();
   g_clear_pointer (&packet, json_node_unref);
 
+  VALENT_TEST_CHECK ("Channel can coalesce queued packets");
+  for (unsigned int i = 0; i < N_QUEUED_PACKETS; i++)
+    {
+      g_autoptr (JsonNode) queued = NULL;
+
+      queued = valent_packet_new ("kdeconnect.mock.echo");
+      json_object_set_int_member (valent_packet_get_body (queued), "index", i);
+      valent_channel_write_packet (fixture->channel,
+                                   queued,
+                                   NULL, // cancellable
+                                   (GAsyncReadyCallback)valent_channel_write_packet_count_cb,
+                                   &n_written);
+    }
+
+  for (unsigned int i = 0; i < N_QUEUED_PACKETS; i++)
+    {
+      g_autoptr (JsonNode) received = NULL;
+      int64_t index = -1;
+
+      valent_channel_read_packet (fixture->endpoint,
+                                  NULL, // cancellable
+                                  (GAsyncReadyCallback)valent_channel_read_packet_index_cb,
+                                  &received);
+      valent_test_await_pointer (&received);
+      g_assert_true (valent_packet_get_int (received, "index", &index));
+      g_assert_cmpint (index, ==, i);
+    }
+
+  while (n_written < N_QUEUED_PACKETS)
+    g_main_context_iteration (NULL, TRUE);
+
+  VALENT_TEST_CHECK ("Channel sends queued packets in order of priority");
+  n_written = 0;
+  for (unsigned int i = 0; i < G_N_ELEMENTS (priority_packets); i++)
+    {
+      g_autoptr (JsonNode) queued = NULL;
+
+      queued = valent_packet_new (priority_packets[i].type);
+      json_object_set_int_member (valent_packet_get_body (queued), "index", i);
+      if (priority_packets[i].payload)
+        valent_packet_set_payload_size (queued, 1024);
+
+      valent_channel_write_packet_full (fixture->channel,
+                                        queued,
+                                        priority_packets[i].io_priority,
+                                        NULL, // cancellable
+                                        (GAsyncReadyCallback)valent_channel_write_packet_count_cb,
+                                        &n_written);
+    }
+
+  for (unsigned int i = 0; i < G_N_ELEMENTS (priority_order); i++)
+    {
+      g_autoptr (JsonNode) received = NULL;
+      int64_t index = -1;
+
+      valent_channel_read_packet (fixture->endpoint,
+                                  NULL, // cancellable
+                                  (GAsyncReadyCallback)valent_channel_read_packet_index_cb,
+                                  &received);
+      valent_test_await_pointer (&received);
+      g_assert_true (valent_packet_get_int (received, "index", &index));
+      g_assert_cmpint (index, ==, priority_order[i]);
+    }
+
+  while (n_written < G_N_ELEMENTS (priority_packets))
+    g_main_context_iteration (NULL, TRUE);
+
   VALENT_TEST_CHECK ("Channel can transfer payloads");
   packet = valent_packet_new ("kdeconnect.mock.transfer");
   json_object_set_string_member (valent_packet_get_body (packet),
@@ -8,6 +8,9 @@
 #define TEST_OBJECT_PATH "/ca/andyholmes/Valent/Test"
 #define DEVICE_INTERFACE "ca.andyholmes.Valent.Device"
 
+#define SCALE_DEVICES       (500)
+#define SCALE_DEVICE_PREFIX "00000000_0000_0000_0001_"
+
 
 typedef struct
 {
@@ -72,6 +75,11 @@ static void
 test_manager_management (ManagerFixture *fixture,
                          gconstpointer   user_data)
 {
+  g_autoptr (ValentContext) context = NULL;
+  g_autoptr (GFile) legacy = NULL;
+  g_autoptr (GFile) records = NULL;
+  g_autoptr (GFile) record = NULL;
+  g_autoptr (GFile) partial = NULL;
   unsigned int n_devices = 0;
 
   g_signal_connect (fixture->manager,
@@ -79,6 +87,15 @@ test_manager_management (ManagerFixture *fixture,
                     G_CALLBACK (on_devices_changed),
                     fixture);
 
+  /* A temporary file, as left by an interrupted g_file_set_contents()
+   */
+  context = valent_context_new (NULL, NULL, NULL);
+  records = valent_context_get_cache_file (context, "devices");
+  partial = g_file_get_child (records, "00000000_0000_0000_0000_000000000002.json.ABC123");
+  g_file_make_directory_with_parents (records, NULL, NULL);
+  g_file_replace_contents (partial, "{", 1, NULL, FALSE,
+                           G_FILE_CREATE_NONE, NULL, NULL, NULL);
+
   VALENT_TEST_CHECK ("Manager starts up with the application");
   valent_application_plugin_startup (VALENT_APPLICATION_PLUGIN (fixture->manager));
   valent_test_await_pointer (&fixture->device);
@@ -87,6 +104,16 @@ test_manager_management (ManagerFixture *fixture,
   n_devices = g_list_model_get_n_items (G_LIST_MODEL (fixture->manager));
   g_assert_cmpuint (n_devices, ==, 1);
 
+  VALENT_TEST_CHECK ("Manager migrates the cache to per-device records");
+  legacy = valent_context_get_cache_file (context, "devices.json");
+  g_assert_false (g_file_query_exists (legacy, NULL));
+  record = g_file_get_child (records, "00000000_0000_0000_0000_000000000001.json");
+  g_assert_true (g_file_query_exists (record, NULL));
+
+  VALENT_TEST_CHECK ("Manager ignores files that aren't device records");
+  g_assert_true (g_file_query_exists (partial, NULL));
+  g_file_delete (partial, NULL, NULL);
+
   VALENT_TEST_CHECK ("Manager removes unpaired devices when they disconnect");
   g_object_notify (G_OBJECT (fixture->device), "state");
   g_assert_false (VALENT_IS_DEVICE (fixture->device));
@@ -112,6 +139,45 @@ test_manager_management (ManagerFixture *fixture,
   g_signal_handlers_disconnect_by_data (fixture->manager, fixture);
 }
 
+static void
+test_manager_shutdown_loading (ManagerFixture *fixture,
+                               gconstpointer   user_data)
+{
+  g_autoptr (ValentContext) context = NULL;
+  g_autoptr (GFile) records = NULL;
+  g_autoptr (GFile) record = NULL;
+  unsigned int n_devices = 0;
+
+  g_signal_connect (fixture->manager,
+                    "items-changed",
+                    G_CALLBACK (on_devices_changed),
+                    fixture);
+
+  VALENT_TEST_CHECK ("Manager shuts down before the cache is loaded");
+  valent_application_plugin_startup (VALENT_APPLICATION_PLUGIN (fixture->manager));
+  valent_application_plugin_shutdown (VALENT_APPLICATION_PLUGIN (fixture->manager));
+  g_assert_null (fixture->device);
+
+  VALENT_TEST_CHECK ("Manager restores cached devices when restarted");
+  valent_application_plugin_startup (VALENT_APPLICATION_PLUGIN (fixture->manager));
+  valent_test_await_pointer (&fixture->device);
+
+  n_devices = g_list_model_get_n_items (G_LIST_MODEL (fixture->manager));
+  g_assert_cmpuint (n_devices, ==, 1);
+
+  VALENT_TEST_CHECK ("Manager preserves the cache across the early shutdown");
+  context = valent_context_new (NULL, NULL, NULL);
+  records = valent_context_get_cache_file (context, "devices");
+  record = g_file_get_child (records, "00000000_0000_0000_0000_000000000001.json");
+  g_assert_true (g_file_query_exists (record, NULL));
+
+  VALENT_TEST_CHECK ("Manager shuts down with the application");
+  valent_application_plugin_shutdown (VALENT_APPLICATION_PLUGIN (fixture->manager));
+  valent_test_await_nullptr (&fixture->device);
+
+  g_signal_handlers_disconnect_by_data (fixture->manager, fixture);
+}
+
 static void
 manager_finish (GObject             *object,
                 GAsyncResult        *result,
@@ -123,6 +189,25 @@ manager_finish (GObject             *object,
   g_assert_no_error (error);
 }
 
+static void
+proxy_call_finish (GDBusProxy   *proxy,
+                   GAsyncResult *result,
+                   GVariant    **reply)
+{
+  GError *error = NULL;
+
+  *reply = g_dbus_proxy_call_finish (proxy, result, &error);
+  g_assert_no_error (error);
+}
+
+static void
+on_action_added (GActionGroup *actions,
+                 const char   *action_name,
+                 unsigned int *n_added)
+{
+  *n_added += 1;
+}
+
 static void
 test_manager_dbus (ManagerFixture *fixture,
                    gconstpointer   user_data)
@@ -134,8 +219,10 @@ test_manager_dbus (ManagerFixture *fixture,
   g_autoptr (GDBusActionGroup) actions = NULL;
   g_auto (GStrv) action_names = NULL;
   g_autoptr (GDBusMenuModel) menu = NULL;
+  g_autoptr (GVariant) statistics = NULL;
   const char *unique_name;
   const char *object_path;
+  unsigned int n_added = 0;
 
   g_signal_connect (fixture->manager,
                     "items-changed",
@@ -145,6 +232,10 @@ test_manager_dbus (ManagerFixture *fixture,
   VALENT_TEST_CHECK ("Manager starts up with the application");
   valent_application_plugin_startup (VALENT_APPLICATION_PLUGIN (fixture->manager));
   valent_test_await_pointer (&fixture->device);
+  g_signal_connect (fixture->device,
+                    "action-added",
+                    G_CALLBACK (on_action_added),
+                    &n_added);
 
   VALENT_TEST_CHECK ("Manager can be exported on D-Bus");
   connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
@@ -172,9 +263,24 @@ test_manager_dbus (ManagerFixture *fixture,
   interface = g_dbus_object_get_interface (objects->data, DEVICE_INTERFACE);
   g_assert_nonnull (interface);
 
+  VALENT_TEST_CHECK ("Manager exports devices without instantiating plugins");
+  g_assert_cmpuint (n_added, ==, 0);
+
   g_object_notify (G_OBJECT (fixture->device), "icon-name");
   valent_test_await_signal (interface, "g-properties-changed");
 
+  VALENT_TEST_CHECK ("Manager exports packet statistics on D-Bus");
+  g_dbus_proxy_call (G_DBUS_PROXY (interface),
+                     "GetPacketStatistics",
+                     NULL,
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     (GAsyncReadyCallback)proxy_call_finish,
+                     &statistics);
+  valent_test_await_pointer (&statistics);
+  g_assert_true (g_variant_is_of_type (statistics, G_VARIANT_TYPE ("(a{s(ttt)})")));
+
   VALENT_TEST_CHECK ("Manager exports action group on D-Bus");
   actions = g_dbus_action_group_get (connection, unique_name, object_path);
 
@@ -186,6 +292,10 @@ test_manager_dbus (ManagerFixture *fixture,
   g_assert_cmpuint (g_strv_length (action_names), >, 0);
   g_clear_pointer (&action_names, g_strfreev);
 
+  VALENT_TEST_CHECK ("Device instantiates plugins when the action group is queried");
+  g_assert_cmpuint (n_added, >, 0);
+  g_signal_handlers_disconnect_by_data (fixture->device, &n_added);
+
   VALENT_TEST_CHECK ("Manager exports menu model on D-Bus");
   menu = g_dbus_menu_model_get (connection, unique_name, object_path);
 
@@ -202,6 +312,257 @@ test_manager_dbus (ManagerFixture *fixture,
   g_signal_handlers_disconnect_by_data (fixture->manager, fixture);
 }
 
+static void
+on_devices_mirror (GListModel   *list,
+                   unsigned int  position,
+                   unsigned int  removed,
+                   unsigned int  added,
+                   GPtrArray    *mirror)
+{
+  g_assert_cmpuint (position + removed, <=, mirror->len);
+
+  if (removed > 0)
+    g_ptr_array_remove_range (mirror, position, removed);
+
+  for (unsigned int i = 0; i < added; i++)
+    g_ptr_array_insert (mirror, position + i, g_list_model_get_item (list, position + i));
+}
+
+static char *
+scale_device_id (unsigned int index)
+{
+  return g_strdup_printf (SCALE_DEVICE_PREFIX "%012u", index);
+}
+
+/*< private >
+ * seed_paired_devices:
+ * @n_devices: the number of devices
+ *
+ * Write a cache record and a certificate for @n_devices paired devices, with
+ * IDs from scale_device_id().
+ */
+static void
+seed_paired_devices (unsigned int n_devices)
+{
+  g_autoptr (ValentContext) context = NULL;
+  g_autoptr (GFile) records = NULL;
+  g_autoptr (GTlsCertificate) certificate = NULL;
+  g_autofree char *certificate_pem = NULL;
+
+  context = valent_context_new (NULL, NULL, NULL);
+  records = valent_context_get_cache_file (context, "devices");
+  g_file_make_directory_with_parents (records, NULL, NULL);
+
+  certificate = valent_certificate_new_sync (NULL, NULL);
+  g_object_get (certificate, "certificate-pem", &certificate_pem, NULL);
+
+  for (unsigned int i = 0; i < n_devices; i++)
+    {
+      g_autoptr (ValentContext) device_context = NULL;
+      g_autoptr (GFile) record = NULL;
+      g_autoptr (GFile) cert_file = NULL;
+      g_autofree char *device_id = NULL;
+      g_autofree char *filename = NULL;
+      g_autofree char *identity = NULL;
+
+      device_id = scale_device_id (i);
+      filename = g_strconcat (device_id, ".json", NULL);
+      identity = g_strdup_printf ("{"
+                                  "  \"id\": 0,"
+                                  "  \"type\": \"kdeconnect.identity\","
+                                  "  \"body\": {"
+                                  "    \"deviceId\": \"%s\","
+                                  "    \"deviceName\": \"Device %u\","
+                                  "    \"deviceType\": \"phone\","
+                                  "    \"incomingCapabilities\": [],"
+                                  "    \"outgoingCapabilities\": [],"
+                                  "    \"protocolVersion\": 8"
+                                  "  }"
+                                  "}",
+                                  device_id, i);
+      record = g_file_get_child (records, filename);
+      g_file_replace_contents (record, identity, strlen (identity), NULL, FALSE,
+                               G_FILE_CREATE_NONE, NULL, NULL, NULL);
+
+      device_context = valent_context_new (NULL, "device", device_id);
+      cert_file = valent_context_get_config_file (device_context, "certificate.pem");
+      g_file_replace_contents (cert_file,
+                               certificate_pem,
+                               strlen (certificate_pem),
+                               NULL,  /* etag */
+                               FALSE, /* make_backup */
+                               (G_FILE_CREATE_PRIVATE |
+                                G_FILE_CREATE_REPLACE_DESTINATION),
+                               NULL,  /* etag (out) */
+                               NULL,
+                               NULL);
+    }
+}
+
+static unsigned int
+manager_count_seeded (ValentDeviceManager *manager,
+                      GHashTable          *seen)
+{
+  unsigned int n_devices = g_list_model_get_n_items (G_LIST_MODEL (manager));
+  unsigned int n_seeded = 0;
+
+  for (unsigned int i = 0; i < n_devices; i++)
+    {
+      g_autoptr (ValentDevice) device = NULL;
+      const char *device_id;
+
+      device = g_list_model_get_item (G_LIST_MODEL (manager), i);
+      device_id = valent_device_get_id (device);
+      if (!g_str_has_prefix (device_id, SCALE_DEVICE_PREFIX))
+        continue;
+
+      if (seen != NULL)
+        {
+          g_assert_false (g_hash_table_contains (seen, device_id));
+          g_hash_table_add (seen, g_strdup (device_id));
+        }
+
+      n_seeded++;
+    }
+
+  return n_seeded;
+}
+
+static void
+test_manager_scale (ManagerFixture *fixture,
+                    gconstpointer   user_data)
+{
+  g_autoptr (GPtrArray) mirror = NULL;
+  g_autoptr (GHashTable) seen = NULL;
+  unsigned int n_devices = 0;
+
+  seed_paired_devices (SCALE_DEVICES);
+
+  mirror = g_ptr_array_new_with_free_func (g_object_unref);
+  g_signal_connect (fixture->manager,
+                    "items-changed",
+                    G_CALLBACK (on_devices_mirror),
+                    mirror);
+
+  VALENT_TEST_CHECK ("Manager adds every paired device from the cache");
+  valent_application_plugin_startup (VALENT_APPLICATION_PLUGIN (fixture->manager));
+  while (manager_count_seeded (fixture->manager, NULL) < SCALE_DEVICES)
+    g_main_context_iteration (NULL, TRUE);
+
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  g_assert_cmpuint (manager_count_seeded (fixture->manager, seen), ==, SCALE_DEVICES);
+  for (unsigned int i = 0; i < SCALE_DEVICES; i++)
+    {
+      g_autofree char *device_id = scale_device_id (i);
+
+      g_assert_true (g_hash_table_contains (seen, device_id));
+    }
+  g_hash_table_remove_all (seen);
+
+  VALENT_TEST_CHECK ("Manager removes unpaired devices by ID");
+  n_devices = g_list_model_get_n_items (G_LIST_MODEL (fixture->manager));
+  for (unsigned int i = n_devices; i > 0; i--)
+    {
+      g_autoptr (ValentDevice) device = NULL;
+      const char *device_id;
+      unsigned int index;
+
+      device = g_list_model_get_item (G_LIST_MODEL (fixture->manager), i - 1);
+      device_id = valent_device_get_id (device);
+      if (!g_str_has_prefix (device_id, SCALE_DEVICE_PREFIX))
+        continue;
+
+      index = (unsigned int)g_ascii_strtoull (device_id + strlen (SCALE_DEVICE_PREFIX),
+                                              NULL, 10);
+      if (index % 2 == 0)
+        g_action_group_activate_action (G_ACTION_GROUP (device), "unpair", NULL);
+    }
+
+  g_assert_cmpuint (manager_count_seeded (fixture->manager, seen), ==, SCALE_DEVICES / 2);
+  for (unsigned int i = 0; i < SCALE_DEVICES; i++)
+    {
+      g_autofree char *device_id = scale_device_id (i);
+
+      g_assert_true (g_hash_table_contains (seen, device_id) == (i % 2 != 0));
+    }
+
+  VALENT_TEST_CHECK ("Manager emits changes consistent with its order");
+  n_devices = g_list_model_get_n_items (G_LIST_MODEL (fixture->manager));
+  g_assert_cmpuint (mirror->len, ==, n_devices);
+  for (unsigned int i = 0; i < n_devices; i++)
+    {
+      g_autoptr (ValentDevice) device = NULL;
+
+      device = g_list_model_get_item (G_LIST_MODEL (fixture->manager), i);
+      g_assert_true (device == g_ptr_array_index (mirror, i));
+    }
+
+  VALENT_TEST_CHECK ("Manager shuts down with the application");
+  valent_application_plugin_shutdown (VALENT_APPLICATION_PLUGIN (fixture->manager));
+  g_assert_cmpuint (mirror->len, ==, 0);
+
+  g_signal_handlers_disconnect_by_data (fixture->manager, mirror);
+}
+
+static gboolean
+manager_has_peer (ValentDeviceManager *manager)
+{
+  unsigned int n_devices = g_list_model_get_n_items (G_LIST_MODEL (manager));
+
+  for (unsigned int i = 0; i < n_devices; i++)
+    {
+      g_autoptr (ValentDevice) device = NULL;
+
+      device = g_list_model_get_item (G_LIST_MODEL (manager), i);
+      if (g_strcmp0 (valent_device_get_name (device), "Peer Device") == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+test_manager_startup (ManagerFixture *fixture,
+                      gconstpointer   user_data)
+{
+  int64_t begin, discoverable, cached;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in performance mode");
+      return;
+    }
+
+  VALENT_TEST_CHECK ("Manager starts up without blocking");
+  begin = g_get_monotonic_time ();
+  valent_application_plugin_startup (VALENT_APPLICATION_PLUGIN (fixture->manager));
+  g_test_minimized_result ((g_get_monotonic_time () - begin) / 1000.0,
+                           "startup: %.2f ms",
+                           (g_get_monotonic_time () - begin) / 1000.0);
+
+  VALENT_TEST_CHECK ("Manager starts channel services once the certificate is ready");
+  valent_device_manager_refresh (fixture->manager);
+  while (!manager_has_peer (fixture->manager))
+    {
+      g_main_context_iteration (NULL, TRUE);
+      valent_device_manager_refresh (fixture->manager);
+    }
+  discoverable = g_get_monotonic_time () - begin;
+  g_test_minimized_result (discoverable / 1000.0,
+                           "discoverable: %.2f ms",
+                           discoverable / 1000.0);
+
+  VALENT_TEST_CHECK ("Manager loads cached devices in parallel");
+  while (g_list_model_get_n_items (G_LIST_MODEL (fixture->manager)) < 2)
+    g_main_context_iteration (NULL, TRUE);
+  cached = g_get_monotonic_time () - begin;
+  g_test_minimized_result (cached / 1000.0,
+                           "cached: %.2f ms",
+                           cached / 1000.0);
+
+  valent_application_plugin_shutdown (VALENT_APPLICATION_PLUGIN (fixture->manager));
+}
+
 static void
 test_manager_dispose (ManagerFixture *fixture,
                       gconstpointer   user_data)
@@ -245,12 +606,30 @@ main (int   argc,
               test_manager_management,
               manager_fixture_tear_down);
 
+  g_test_add ("/libvalent/device/device-manager/shutdown-loading",
+              ManagerFixture, NULL,
+              manager_fixture_set_up,
+              test_manager_shutdown_loading,
+              manager_fixture_tear_down);
+
   g_test_add ("/libvalent/device/device-manager/dbus",
               ManagerFixture, NULL,
               manager_fixture_set_up,
               test_manager_dbus,
               manager_fixture_tear_down);
 
+  g_test_add ("/libvalent/device/device-manager/scale",
+              ManagerFixture, NULL,
+              manager_fixture_set_up,
+              test_manager_scale,
+              manager_fixture_tear_down);
+
+  g_test_add ("/libvalent/device/device-manager/startup",
+              ManagerFixture, NULL,
+              manager_fixture_set_up,
+              test_manager_startup,
+              manager_fixture_tear_down);
+
   g_test_add ("/libvalent/device/device-manager/dispose",
               ManagerFixture, NULL,
               manager_fixture_set_up,
@@ -7,6 +7,8 @@
 #include <valent.h>
 #include <libvalent-test.h>
 
+#define THREADED_IO_PACKETS (256)
+
 
 typedef struct
 {
@@ -376,6 +378,84 @@ test_device_verification_key (DeviceFixture *fixture,
   valent_object_destroy (VALENT_OBJECT (endpoint_device));
 }
 
+/*
+ * Plugins are only instantiated when the device is used
+ */
+static void
+on_action_added (GActionGroup *actions,
+                 const char   *action_name,
+                 unsigned int *n_added)
+{
+  *n_added += 1;
+}
+
+static void
+test_device_lazy_plugins (DeviceFixture *fixture,
+                          gconstpointer  user_data)
+{
+  unsigned int n_added = 0;
+
+  g_signal_connect (fixture->device,
+                    "action-added",
+                    G_CALLBACK (on_action_added),
+                    &n_added);
+
+  VALENT_TEST_CHECK ("Device defers plugins while disconnected");
+  valent_test_await_timeout (1);
+  g_assert_cmpuint (n_added, ==, 0);
+
+  VALENT_TEST_CHECK ("Device instantiates plugins when connected");
+  valent_device_add_channel (fixture->device, fixture->channel);
+  g_assert_cmpuint (n_added, >, 0);
+  g_assert_true (g_action_group_has_action (G_ACTION_GROUP (fixture->device),
+                                            "mock.echo"));
+
+  g_signal_handlers_disconnect_by_data (fixture->device, &n_added);
+}
+
+static void
+test_device_capabilities (DeviceFixture *fixture,
+                          gconstpointer  user_data)
+{
+  ValentDevice *device = NULL;
+  g_autoptr (JsonNode) identity = NULL;
+  JsonNode *peer_identity;
+  JsonObject *body;
+  JsonArray *incoming;
+  JsonArray *outgoing;
+
+  peer_identity = json_object_get_member (json_node_get_object (fixture->packets),
+                                          "peer-identity");
+  identity = json_node_copy (peer_identity);
+  body = valent_packet_get_body (identity);
+
+  incoming = json_array_new ();
+  outgoing = json_array_new ();
+  for (unsigned int i = 0; i < 256; i++)
+    {
+      g_autofree char *type = NULL;
+
+      type = g_strdup_printf ("kdeconnect.unknown.%u", i);
+      json_array_add_string_element (incoming, type);
+      json_array_add_string_element (outgoing, type);
+    }
+  json_object_set_array_member (body, "incomingCapabilities", incoming);
+  json_object_set_array_member (body, "outgoingCapabilities", outgoing);
+
+  VALENT_TEST_CHECK ("Plugins are not loaded for unknown capabilities");
+  device = valent_device_new_full (NULL, identity);
+  g_assert_false (g_action_group_has_action (G_ACTION_GROUP (device),
+                                             "mock.echo"));
+  v_await_finalize_object (device);
+
+  VALENT_TEST_CHECK ("Plugins are loaded for matching capabilities");
+  json_array_add_string_element (incoming, "kdeconnect.mock.echo");
+  device = valent_device_new_full (NULL, identity);
+  g_assert_true (g_action_group_has_action (G_ACTION_GROUP (device),
+                                            "mock.echo"));
+  v_await_finalize_object (device);
+}
+
 /*
  * Device Actions
  */
@@ -543,6 +623,9 @@ test_handle_packet (DeviceFixture *fixture,
                     gconstpointer  user_data)
 {
   g_autoptr (JsonNode) packet = NULL;
+  g_autoptr (GVariant) statistics = NULL;
+  uint64_t n_packets = 0;
+  uint64_t n_bytes = 0;
 
   packet = valent_packet_new ("kdeconnect.mock.echo");
 
@@ -556,6 +639,17 @@ test_handle_packet (DeviceFixture *fixture,
   valent_channel_write_packet (fixture->endpoint, packet, NULL, NULL, NULL);
   endpoint_expect_packet_echo (fixture, packet);
 
+  /* Handled packets are accounted for by type */
+  statistics = valent_device_dup_packet_statistics (fixture->device);
+  g_assert_true (g_variant_lookup (statistics,
+                                   "kdeconnect.mock.echo",
+                                   "(ttt)",
+                                   &n_packets,
+                                   &n_bytes,
+                                   NULL));
+  g_assert_cmpuint (n_packets, ==, 1);
+  g_assert_cmpuint (n_bytes, >, 0);
+
   /* Local device is unpaired, we expect to receive a pair packet informing us
    * that the device is unpaired. */
   device_fixture_set_paired (fixture, FALSE);
@@ -607,6 +701,93 @@ send_unpaired_cb (ValentDevice *device,
     *done = TRUE;
 }
 
+static void
+write_packet_cb (ValentChannel *channel,
+                 GAsyncResult  *result,
+                 unsigned int  *n_written)
+{
+  g_autoptr (GError) error = NULL;
+
+  valent_channel_write_packet_finish (channel, result, &error);
+  g_assert_no_error (error);
+
+  *n_written += 1;
+}
+
+static void
+test_handle_packet_threaded (DeviceFixture *fixture,
+                             gconstpointer  user_data)
+{
+  g_autoptr (JsonNode) packet = NULL;
+  g_autoptr (GVariant) statistics = NULL;
+  g_autoptr (GMainContext) context = NULL;
+  unsigned int n_written = 0;
+  uint64_t n_packets = 0;
+  uint64_t n_dropped = 0;
+  uint64_t n_deferred = 0;
+  uint64_t n_deferred_full = 0;
+
+  packet = valent_packet_new ("kdeconnect.mock.echo");
+
+  VALENT_TEST_CHECK ("Device can read channels in a thread");
+  valent_device_set_threaded_io (fixture->device, TRUE);
+  valent_device_add_channel (fixture->device, fixture->channel);
+  device_fixture_set_paired (fixture, TRUE);
+
+  VALENT_TEST_CHECK ("Device handles packets in order from the worker");
+  for (unsigned int i = 0; i < THREADED_IO_PACKETS; i++)
+    valent_channel_write_packet (fixture->endpoint, packet, NULL, NULL, NULL);
+
+  for (unsigned int i = 0; i < THREADED_IO_PACKETS; i++)
+    endpoint_expect_packet_echo (fixture, packet);
+
+  statistics = valent_device_dup_packet_statistics (fixture->device);
+  g_assert_true (g_variant_lookup (statistics,
+                                   "kdeconnect.mock.echo",
+                                   "(ttt)",
+                                   &n_packets,
+                                   NULL,
+                                   NULL));
+  g_assert_cmpuint (n_packets, ==, THREADED_IO_PACKETS);
+  g_clear_pointer (&statistics, g_variant_unref);
+
+  VALENT_TEST_CHECK ("Device reports queue statistics");
+  statistics = valent_device_dup_queue_statistics (fixture->device);
+  g_assert_true (g_variant_lookup (statistics, "dropped", "t", &n_dropped));
+  g_assert_cmpuint (n_dropped, ==, 0);
+  g_assert_true (g_variant_lookup (statistics, "deferred", "t", &n_deferred));
+  g_clear_pointer (&statistics, g_variant_unref);
+
+  /* Write the packets from another context, so that nothing is dispatched
+   * from the queue until the worker has had time to fill it
+   */
+  VALENT_TEST_CHECK ("Device stops reading when the queue is full");
+  context = g_main_context_new ();
+  g_main_context_push_thread_default (context);
+  for (unsigned int i = 0; i < THREADED_IO_PACKETS; i++)
+    {
+      valent_channel_write_packet (fixture->endpoint,
+                                   packet,
+                                   NULL,
+                                   (GAsyncReadyCallback)write_packet_cb,
+                                   &n_written);
+    }
+
+  while (n_written < THREADED_IO_PACKETS)
+    g_main_context_iteration (context, TRUE);
+  g_main_context_pop_thread_default (context);
+  g_usleep (G_USEC_PER_SEC / 10);
+
+  for (unsigned int i = 0; i < THREADED_IO_PACKETS; i++)
+    endpoint_expect_packet_echo (fixture, packet);
+
+  statistics = valent_device_dup_queue_statistics (fixture->device);
+  g_assert_true (g_variant_lookup (statistics, "deferred", "t", &n_deferred_full));
+  g_assert_cmpuint (n_deferred_full, >, n_deferred);
+  g_assert_true (g_variant_lookup (statistics, "dropped", "t", &n_dropped));
+  g_assert_cmpuint (n_dropped, ==, 0);
+}
+
 static void
 test_send_packet (DeviceFixture *fixture,
                   gconstpointer  user_data)
@@ -795,6 +976,18 @@ main (int   argc,
               test_device_verification_key,
               device_fixture_tear_down);
 
+  g_test_add ("/libvalent/device/device/lazy-plugins",
+              DeviceFixture, NULL,
+              device_fixture_set_up,
+              test_device_lazy_plugins,
+              device_fixture_tear_down);
+
+  g_test_add ("/libvalent/device/device/capabilities",
+              DeviceFixture, NULL,
+              device_fixture_set_up,
+              test_device_capabilities,
+              device_fixture_tear_down);
+
   g_test_add ("/libvalent/device/device/actions",
               DeviceFixture, NULL,
               device_fixture_set_up,
@@ -813,6 +1006,12 @@ main (int   argc,
               test_handle_packet,
               device_fixture_tear_down);
 
+  g_test_add ("/libvalent/device/device/handle-packet-threaded",
+              DeviceFixture, NULL,
+              device_fixture_set_up,
+              test_handle_packet_threaded,
+              device_fixture_tear_down);
+
   g_test_add ("/libvalent/device/device/send-packet",
               DeviceFixture, NULL,
               device_fixture_set_up,
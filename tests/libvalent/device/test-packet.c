@@ -4,6 +4,8 @@
 #include <valent.h>
 #include <libvalent-test.h>
 
+#include "valent-packet-private.h"
+
 
 static const char *corrupt_packet =
   "{"
@@ -233,6 +235,26 @@ valent_packet_from_stream_cb (GInputStream  *stream,
   g_assert_no_error (error);
 }
 
+typedef struct
+{
+  JsonNode *packet;
+  GBytes   *unread;
+} ReadFullResult;
+
+static void
+valent_packet_from_stream_full_cb (GInputStream   *stream,
+                                   GAsyncResult   *result,
+                                   ReadFullResult *ret)
+{
+  GError *error = NULL;
+
+  ret->packet = valent_packet_from_stream_full_finish (stream,
+                                                      result,
+                                                      &ret->unread,
+                                                      &error);
+  g_assert_no_error (error);
+}
+
 static void
 valent_packet_from_stream_error_cb (GInputStream  *stream,
                                     GAsyncResult  *result,
@@ -254,6 +276,10 @@ test_packet_streaming (PacketFixture *fixture,
   GInputStream *in = NULL;
   GOutputStream *out = NULL;
   g_autoptr (GBytes) bytes = NULL;
+  ReadFullResult result = { NULL, NULL };
+  const char *data = NULL;
+  size_t size = 0;
+  size_t line_len = 0;
   gboolean done = FALSE;
   GError *error = NULL;
 
@@ -293,6 +319,28 @@ test_packet_streaming (PacketFixture *fixture,
       g_clear_pointer (&packet_out, json_node_unref);
     }
 
+  g_clear_object (&in);
+
+  VALENT_TEST_CHECK ("valent_packet_from_stream_full() returns data following the packet");
+  in = g_memory_input_stream_new_from_bytes (bytes);
+  valent_packet_from_stream_full (in,
+                                  -1,
+                                  0,
+                                  NULL,
+                                  (GAsyncReadyCallback) valent_packet_from_stream_full_cb,
+                                  &result);
+  valent_test_await_pointer (&result.packet);
+  g_assert_nonnull (result.unread);
+
+  data = g_bytes_get_data (bytes, &size);
+  line_len = (const char *)memchr (data, '\n', size) - data + 1;
+  g_assert_cmpmem ((const char *)data + line_len,
+                   MIN (size - line_len, g_bytes_get_size (result.unread)),
+                   g_bytes_get_data (result.unread, NULL),
+                   g_bytes_get_size (result.unread));
+  g_clear_pointer (&result.packet, json_node_unref);
+  g_clear_pointer (&result.unread, g_bytes_unref);
+
   g_clear_object (&out);
   g_clear_object (&in);
   g_clear_pointer (&bytes, g_bytes_unref);
@@ -383,6 +431,212 @@ test_packet_streaming (PacketFixture *fixture,
   g_clear_error (&error);
 }
 
+static void
+decoder_push (ValentPacketDecoder *decoder,
+              const char          *data,
+              size_t               size)
+{
+  uint8_t *buffer;
+
+  buffer = valent_packet_decoder_prepare (decoder, size);
+  memcpy (buffer, data, size);
+  valent_packet_decoder_commit (decoder, size);
+}
+
+static void
+test_packet_decoder (PacketFixture *fixture,
+                     gconstpointer  user_data)
+{
+  g_autoptr (ValentPacketDecoder) decoder = NULL;
+  g_autoptr (GString) stream = NULL;
+  JsonObjectIter iter;
+  JsonNode *packet_in = NULL;
+  size_t offset = 0;
+  GError *error = NULL;
+
+  VALENT_TEST_CHECK ("Decoder can read packets split across writes");
+  decoder = valent_packet_decoder_new (0);
+  stream = g_string_new ("\n");
+  json_object_iter_init (&iter, fixture->packets);
+
+  while (json_object_iter_next (&iter, NULL, &packet_in))
+    {
+      g_autofree char *packet_str = NULL;
+
+      packet_str = json_to_string (packet_in, FALSE);
+      g_string_append_printf (stream, "%s\n", packet_str);
+    }
+
+  json_object_iter_init (&iter, fixture->packets);
+  while (json_object_iter_next (&iter, NULL, &packet_in))
+    {
+      g_autoptr (GBytes) bytes = NULL;
+      g_autoptr (JsonNode) packet_out = NULL;
+
+      while ((bytes = valent_packet_decoder_next (decoder, &error)) == NULL)
+        {
+          size_t len = MIN (7, stream->len - offset);
+
+          g_assert_no_error (error);
+          g_assert_cmpuint (len, >, 0);
+          decoder_push (decoder, stream->str + offset, len);
+          offset += len;
+        }
+
+      packet_out = valent_packet_decode (bytes, &error);
+      g_assert_no_error (error);
+      g_assert_true (json_node_equal (packet_in, packet_out));
+    }
+  g_clear_pointer (&decoder, valent_packet_decoder_unref);
+
+  VALENT_TEST_CHECK ("Decoder reads unread data first");
+  decoder = valent_packet_decoder_new (0);
+  decoder_push (decoder, "\"body\":{}}\n", 11);
+  valent_packet_decoder_unread (decoder,
+                                (const uint8_t *)"{\"id\":0,\"type\":\"kdeconnect.ping\",",
+                                33);
+
+  {
+    g_autoptr (GBytes) bytes = NULL;
+    g_autoptr (JsonNode) packet = NULL;
+
+    bytes = valent_packet_decoder_next (decoder, &error);
+    g_assert_no_error (error);
+    packet = valent_packet_decode (bytes, &error);
+    g_assert_no_error (error);
+    v_assert_packet_type (packet, "kdeconnect.ping");
+  }
+  g_clear_pointer (&decoder, valent_packet_decoder_unref);
+
+  VALENT_TEST_CHECK ("Decoder rejects packets with invalid fields before the end");
+  decoder = valent_packet_decoder_new (0);
+  decoder_push (decoder, "{\"id\":0,\"type\":1", 16);
+  g_assert_null (valent_packet_decoder_next (decoder, &error));
+  g_assert_error (error, VALENT_PACKET_ERROR, VALENT_PACKET_ERROR_INVALID_FIELD);
+  g_clear_error (&error);
+  g_clear_pointer (&decoder, valent_packet_decoder_unref);
+
+  VALENT_TEST_CHECK ("Decoder leaves the \"id\" field to the packet handler");
+  decoder = valent_packet_decoder_new (0);
+  decoder_push (decoder, "{\"id\":\"0\",\"type\":\"kdeconnect.ping\",\"body\":{}}\n", 46);
+
+  {
+    g_autoptr (GBytes) bytes = NULL;
+    g_autoptr (JsonNode) packet = NULL;
+
+    bytes = valent_packet_decoder_next (decoder, &error);
+    g_assert_no_error (error);
+    packet = valent_packet_decode (bytes, &error);
+    g_assert_no_error (error);
+    v_assert_packet_type (packet, "kdeconnect.ping");
+  }
+  g_clear_pointer (&decoder, valent_packet_decoder_unref);
+
+  VALENT_TEST_CHECK ("Decoded packets must be valid UTF-8");
+  {
+    g_autoptr (GBytes) bytes = NULL;
+    g_autoptr (JsonNode) packet = NULL;
+
+    bytes = g_bytes_new_static ("{\"type\":\"\xff\",\"body\":{}}", 22);
+    packet = valent_packet_decode (bytes, &error);
+    g_assert_null (packet);
+    g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    g_clear_error (&error);
+  }
+
+  VALENT_TEST_CHECK ("Decoder rejects packets that are not objects");
+  decoder = valent_packet_decoder_new (0);
+  decoder_push (decoder, "[", 1);
+  g_assert_null (valent_packet_decoder_next (decoder, &error));
+  g_assert_error (error, VALENT_PACKET_ERROR, VALENT_PACKET_ERROR_MALFORMED);
+  g_clear_error (&error);
+  g_clear_pointer (&decoder, valent_packet_decoder_unref);
+
+  VALENT_TEST_CHECK ("Decoder rejects packets missing required fields");
+  decoder = valent_packet_decoder_new (0);
+  decoder_push (decoder, "{\"id\":0,\"body\":{}}\n", 19);
+  g_assert_null (valent_packet_decoder_next (decoder, &error));
+  g_assert_error (error, VALENT_PACKET_ERROR, VALENT_PACKET_ERROR_MISSING_FIELD);
+  g_clear_error (&error);
+  g_clear_pointer (&decoder, valent_packet_decoder_unref);
+
+  VALENT_TEST_CHECK ("Decoder rejects oversize packets before the end");
+  decoder = valent_packet_decoder_new (16);
+  decoder_push (decoder, "{\"id\":0,\"type\":\"kdeconnect", 26);
+  g_assert_null (valent_packet_decoder_next (decoder, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE);
+  g_clear_error (&error);
+}
+
+static void
+test_packet_encoder (PacketFixture *fixture,
+                     gconstpointer  user_data)
+{
+  g_autoptr (ValentPacketEncoder) encoder = NULL;
+  JsonObjectIter iter;
+  JsonNode *packet_in = NULL;
+  GError *error = NULL;
+
+  VALENT_TEST_CHECK ("Encoder serializes packets without modifying them");
+  encoder = valent_packet_encoder_new ();
+  json_object_iter_init (&iter, fixture->packets);
+
+  while (json_object_iter_next (&iter, NULL, &packet_in))
+    {
+      g_autoptr (JsonNode) expected = NULL;
+      g_autoptr (JsonNode) packet_out = NULL;
+      g_autoptr (GBytes) bytes = NULL;
+      const char *data;
+      size_t size;
+
+      expected = json_node_copy (packet_in);
+      bytes = valent_packet_encoder_encode (encoder, packet_in, 42);
+      g_assert_true (json_node_equal (packet_in, expected));
+
+      data = g_bytes_get_data (bytes, &size);
+      g_assert_cmpuint (size, >, 0);
+      g_assert_cmpint (data[size - 1], ==, '\n');
+
+      packet_out = valent_packet_decode (bytes, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (valent_packet_get_id (packet_out), ==, 42);
+
+      json_object_set_int_member (json_node_get_object (expected), "id", 42);
+      g_assert_true (json_node_equal (expected, packet_out));
+    }
+
+  VALENT_TEST_CHECK ("Encoder escapes member names");
+  {
+    g_autoptr (JsonNode) packet = NULL;
+    g_autoptr (JsonNode) packet_out = NULL;
+    g_autoptr (GBytes) bytes = NULL;
+
+    packet = valent_packet_new ("kdeconnect.mock.echo");
+    json_object_set_boolean_member (json_node_get_object (packet),
+                                    "\"quoted\"\tmember\\",
+                                    TRUE);
+    bytes = valent_packet_encoder_encode (encoder, packet, 0);
+    packet_out = valent_packet_decode (bytes, &error);
+    g_assert_no_error (error);
+    g_assert_true (json_node_equal (packet, packet_out));
+  }
+
+  VALENT_TEST_CHECK ("Encoder reuses released buffers");
+  {
+    g_autoptr (JsonNode) packet = NULL;
+    g_autoptr (GBytes) bytes = NULL;
+    const void *data;
+
+    packet = valent_packet_new ("kdeconnect.ping");
+    bytes = valent_packet_encoder_encode (encoder, packet, 0);
+    data = g_bytes_get_data (bytes, NULL);
+    g_clear_pointer (&bytes, g_bytes_unref);
+
+    bytes = valent_packet_encoder_encode (encoder, packet, 0);
+    g_assert_true (g_bytes_get_data (bytes, NULL) == data);
+  }
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -416,5 +670,17 @@ main (int   argc,
               test_packet_streaming,
               packet_fixture_tear_down);
 
+  g_test_add ("/libvalent/device/packet/decoder",
+              PacketFixture, NULL,
+              packet_fixture_set_up,
+              test_packet_decoder,
+              packet_fixture_tear_down);
+
+  g_test_add ("/libvalent/device/packet/encoder",
+              PacketFixture, NULL,
+              packet_fixture_set_up,
+              test_packet_encoder,
+              packet_fixture_tear_down);
+
   return g_test_run ();
 }
@@ -6,6 +6,7 @@
 #include <valent.h>
 #include <libvalent-test.h>
 
+#define THREAD_PAGING_MESSAGES (500)
 
 typedef struct
 {
@@ -23,6 +24,56 @@ messages_component_fixture_tear_down (MessagesComponentFixture *fixture,
 {
 }
 
+static gboolean
+adapter_thread_has_latest (GListModel   *adapter,
+                           unsigned int  position,
+                           const char   *thread_iri,
+                           int64_t       message_id)
+{
+  g_autoptr (GListModel) thread = NULL;
+  g_autoptr (ValentMessage) message = NULL;
+  g_autofree char *iri = NULL;
+
+  thread = g_list_model_get_item (adapter, position);
+  if (thread == NULL)
+    return FALSE;
+
+  g_object_get (thread,
+                "iri",            &iri,
+                "latest-message", &message,
+                NULL);
+
+  return g_strcmp0 (iri, thread_iri) == 0 &&
+         message != NULL &&
+         valent_message_get_id (message) == message_id;
+}
+
+static gboolean
+adapter_is_sorted (GListModel *adapter)
+{
+  unsigned int n_items = g_list_model_get_n_items (adapter);
+  int64_t last_date = G_MAXINT64;
+
+  for (unsigned int i = 0; i < n_items; i++)
+    {
+      g_autoptr (GListModel) thread = NULL;
+      g_autoptr (ValentMessage) message = NULL;
+      int64_t date = 0;
+
+      thread = g_list_model_get_item (adapter, i);
+      g_object_get (thread, "latest-message", &message, NULL);
+      if (message != NULL)
+        date = valent_message_get_date (message);
+
+      if (date > last_date)
+        return FALSE;
+
+      last_date = date;
+    }
+
+  return TRUE;
+}
+
 static void
 test_messages_component_adapter (MessagesComponentFixture *fixture,
                                  gconstpointer             user_data)
@@ -71,6 +122,30 @@ test_messages_component_adapter (MessagesComponentFixture *fixture,
   valent_test_await_signal (adapter, "items-changed");
   g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (adapter)), ==, n_items + 1);
 
+  VALENT_TEST_CHECK ("Adapter sorts message lists by their latest message");
+  g_assert_true (adapter_thread_has_latest (G_LIST_MODEL (adapter), 0,
+                                            "urn:valent:messages:mock:4", 1));
+
+  VALENT_TEST_CHECK ("Adapter updates message lists when messages are added");
+  g_action_group_activate_action (G_ACTION_GROUP (adapter),
+                                  "add-message",
+                                  g_variant_new ("(xx)", 38, 3316));
+  while (!adapter_thread_has_latest (G_LIST_MODEL (adapter), 0,
+                                     "urn:valent:messages:mock:38", 3316))
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (adapter)), ==, n_items + 1);
+  g_assert_true (adapter_is_sorted (G_LIST_MODEL (adapter)));
+
+  VALENT_TEST_CHECK ("Adapter updates message lists when messages are removed");
+  g_action_group_activate_action (G_ACTION_GROUP (adapter),
+                                  "remove-message",
+                                  g_variant_new ("(xx)", 38, 3316));
+  while (!adapter_thread_has_latest (G_LIST_MODEL (adapter), 1,
+                                     "urn:valent:messages:mock:38", 3315))
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (adapter)), ==, n_items + 1);
+  g_assert_true (adapter_is_sorted (G_LIST_MODEL (adapter)));
+
   VALENT_TEST_CHECK ("Adapter detects message lists removed from the graph");
   g_action_group_activate_action (G_ACTION_GROUP (adapter),
                                   "remove-list",
@@ -141,6 +216,177 @@ test_messages_component_message_list (MessagesComponentFixture *fixture,
   g_assert_cmpuint (g_list_model_get_n_items (list), ==, n_items);
 }
 
+/*
+ * Items from pages that aren't loaded are returned as placeholders, without an
+ * IRI, and replaced with items-changed once the page is loaded
+ */
+static ValentMessage *
+thread_await_message (GListModel   *list,
+                      unsigned int  position)
+{
+  ValentMessage *message = NULL;
+
+  message = g_list_model_get_item (list, position);
+  while (valent_object_get_iri (VALENT_OBJECT (message)) == NULL)
+    {
+      g_clear_object (&message);
+      valent_test_await_signal (list, "items-changed");
+      message = g_list_model_get_item (list, position);
+    }
+
+  return message;
+}
+
+static void
+on_items_changed (GListModel   *list,
+                  unsigned int  position,
+                  unsigned int  removed,
+                  unsigned int  added,
+                  unsigned int *changed)
+{
+  changed[0] = position;
+  changed[1] = removed;
+  changed[2] = added;
+}
+
+static void
+test_messages_component_thread_paging (MessagesComponentFixture *fixture,
+                                       gconstpointer             user_data)
+{
+  PeasEngine *engine;
+  PeasPluginInfo *plugin_info;
+  g_autoptr (ValentContext) context = NULL;
+  g_autoptr (GObject) adapter = NULL;
+  g_autoptr (GListModel) list = NULL;
+  g_autoptr (ValentMessage) placeholder = NULL;
+  unsigned int changed[3] = { 0, };
+  g_autoptr (TrackerSparqlConnection) connection = NULL;
+  g_autoptr (GString) sparql = NULL;
+  unsigned int n_items = 0;
+  g_autoptr (GError) error = NULL;
+
+  engine = valent_get_plugin_engine ();
+  plugin_info = peas_engine_get_plugin_info (engine, "mock");
+  context = valent_context_new (NULL, "plugin", "mock");
+  adapter = peas_engine_create_extension (engine,
+                                          plugin_info,
+                                          VALENT_TYPE_MESSAGES_ADAPTER,
+                                          "iri",     "urn:valent:messages:mock",
+                                          "parent",  NULL,
+                                          "context", context,
+                                          NULL);
+  g_object_get (adapter, "connection", &connection, NULL);
+
+  /* Pairs of messages share a timestamp, so ordering depends on the message ID
+   * to break ties across page boundaries.
+   */
+  sparql = g_string_new ("INSERT DATA {"
+                         "  GRAPH <valent:messages> {"
+                         "    <tel:+1-778-628-3857> rdf:type nco:PhoneNumber ;"
+                         "      nco:phoneNumber \"7786283857\" ."
+                         "    <urn:valent:messages:mock:5> rdf:type vmo:CommunicationChannel ;"
+                         "      vmo:communicationChannelId 5 ;"
+                         "      vmo:hasParticipant <tel:+1-778-628-3857> .");
+  for (unsigned int i = 0; i < THREAD_PAGING_MESSAGES; i++)
+    {
+      g_string_append_printf (sparql,
+                              "    <urn:valent:messages:mock:5:%u> rdf:type vmo:PhoneMessage ;"
+                              "      vmo:communicationChannel <urn:valent:messages:mock:5> ;"
+                              "      vmo:subscriptionId -1 ;"
+                              "      nmo:messageSender <tel:+1-778-628-3857> ;"
+                              "      vmo:phoneMessageBox vmo:android-message-type-inbox ;"
+                              "      vmo:phoneMessageId %u ;"
+                              "      nmo:receivedDate \"2018-11-29T17:%02u:%02u.000000-08:00\" ;"
+                              "      nmo:isRead true .",
+                              i, i, (i / 2) / 60, (i / 2) % 60);
+    }
+  g_string_append (sparql, "  }}");
+
+  tracker_sparql_connection_update (connection, sparql->str, NULL, &error);
+  g_assert_no_error (error);
+  valent_test_await_signal (adapter, "items-changed");
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (adapter));
+  for (unsigned int i = 0; i < n_items; i++)
+    {
+      g_autoptr (GListModel) thread = NULL;
+      g_autofree char *iri = NULL;
+
+      thread = g_list_model_get_item (G_LIST_MODEL (adapter), i);
+      g_object_get (thread, "iri", &iri, NULL);
+
+      if (g_strcmp0 (iri, "urn:valent:messages:mock:5") == 0)
+        {
+          list = g_steal_pointer (&thread);
+          break;
+        }
+    }
+  g_assert_true (G_IS_LIST_MODEL (list));
+
+  VALENT_TEST_CHECK ("Message list counts messages without loading them");
+  while (g_list_model_get_n_items (list) != THREAD_PAGING_MESSAGES)
+    g_main_context_iteration (NULL, TRUE);
+
+  VALENT_TEST_CHECK ("Message list pages backwards from the latest message");
+  for (unsigned int i = THREAD_PAGING_MESSAGES; i > 0; i--)
+    {
+      g_autoptr (ValentMessage) message = NULL;
+
+      message = thread_await_message (list, i - 1);
+      g_assert_true (VALENT_IS_MESSAGE (message));
+      g_assert_cmpint (valent_message_get_id (message), ==, i - 1);
+
+      while (g_main_context_iteration (NULL, FALSE))
+        continue;
+    }
+
+  VALENT_TEST_CHECK ("Message list pages forwards from the first message");
+  for (unsigned int i = 0; i < THREAD_PAGING_MESSAGES; i++)
+    {
+      g_autoptr (ValentMessage) message = NULL;
+
+      message = thread_await_message (list, i);
+      g_assert_true (VALENT_IS_MESSAGE (message));
+      g_assert_cmpint (valent_message_get_id (message), ==, i);
+
+      while (g_main_context_iteration (NULL, FALSE))
+        continue;
+    }
+
+  VALENT_TEST_CHECK ("Message list returns placeholders for evicted pages");
+  placeholder = g_list_model_get_item (list, 0);
+  g_assert_true (VALENT_IS_MESSAGE (placeholder));
+  g_assert_null (valent_object_get_iri (VALENT_OBJECT (placeholder)));
+  g_clear_object (&placeholder);
+
+  VALENT_TEST_CHECK ("Message list replaces contiguous placeholders at once");
+  for (unsigned int i = 1; i < 10; i++)
+    {
+      placeholder = g_list_model_get_item (list, i);
+      g_assert_null (valent_object_get_iri (VALENT_OBJECT (placeholder)));
+      g_clear_object (&placeholder);
+    }
+
+  g_signal_connect (list, "items-changed", G_CALLBACK (on_items_changed), changed);
+  valent_test_await_signal (list, "items-changed");
+  g_signal_handlers_disconnect_by_func (list, on_items_changed, changed);
+  g_assert_cmpuint (changed[0], ==, 0);
+  g_assert_cmpuint (changed[1], ==, 10);
+  g_assert_cmpuint (changed[2], ==, 10);
+
+  VALENT_TEST_CHECK ("Message list seeks to arbitrary positions");
+  for (unsigned int i = 0; i < THREAD_PAGING_MESSAGES; i += 97)
+    {
+      g_autoptr (ValentMessage) message = NULL;
+
+      message = thread_await_message (list, i);
+      g_assert_true (VALENT_IS_MESSAGE (message));
+      g_assert_cmpint (valent_message_get_id (message), ==, i);
+    }
+
+  g_assert_null (g_list_model_get_item (list, THREAD_PAGING_MESSAGES));
+}
+
 static void
 test_messages_component_self (MessagesComponentFixture *fixture,
                               gconstpointer             user_data)
@@ -182,6 +428,12 @@ main (int   argc,
               test_messages_component_message_list,
               messages_component_fixture_tear_down);
 
+  g_test_add ("/libvalent/messages/thread-paging",
+              MessagesComponentFixture, NULL,
+              messages_component_fixture_set_up,
+              test_messages_component_thread_paging,
+              messages_component_fixture_tear_down);
+
   g_test_add ("/libvalent/messages/self",
               MessagesComponentFixture, NULL,
               messages_component_fixture_set_up,
@@ -17,6 +17,16 @@
 #define BLUEZ_DEVICE_ADDR  "AA:BB:CC:DD:EE:FF"
 #define BLUEZ_DEVICE_PATH  "/org/bluez/hci0/dev_AA_BB_CC_DD_EE_FF"
 
+#define THROUGHPUT_CHUNK   (64 * 1024)
+#define THROUGHPUT_SIZE    (32 * 1024 * 1024)
+#define BUFFER_TEST_SIZE   (1024 * 1024)
+
+/* BUFFER_SHRINK_USEC in the muxer, and the number of windows an idle
+ * channel is given to release its buffer
+ */
+#define BUFFER_SHRINK_MSEC     (1000)
+#define BUFFER_RELEASE_WINDOWS (4)
+
 
 typedef struct
 {
@@ -496,6 +506,226 @@ test_bluez_service_channel (BluezTestFixture *fixture,
   g_signal_handlers_disconnect_by_data (fixture->service, fixture);
 }
 
+/*
+ * Buffer Policy
+ */
+typedef struct
+{
+  ValentBluezMuxer *muxer;
+  char             *uuid;
+} BufferData;
+
+static gpointer
+buffer_write_thread (gpointer user_data)
+{
+  BufferData *data = (BufferData *)user_data;
+  g_autoptr (GIOStream) stream = NULL;
+  g_autofree uint8_t *buffer = NULL;
+  GError *error = NULL;
+
+  stream = valent_bluez_muxer_channel_open (data->muxer,
+                                            data->uuid,
+                                            NULL,
+                                            &error);
+  g_assert_no_error (error);
+
+  buffer = g_malloc0 (BUFFER_TEST_SIZE);
+  g_output_stream_write_all (g_io_stream_get_output_stream (stream),
+                             buffer,
+                             BUFFER_TEST_SIZE,
+                             NULL,
+                             NULL,
+                             &error);
+  g_assert_no_error (error);
+
+  return g_steal_pointer (&stream);
+}
+
+static void
+test_bluez_muxer_buffer (BluezTestFixture *fixture,
+                         gconstpointer     user_data)
+{
+  g_autoptr (ValentBluezMuxer) muxer = NULL;
+  g_autoptr (ValentBluezMuxer) peer_muxer = NULL;
+  g_autoptr (GIOStream) stream = NULL;
+  g_autoptr (GIOStream) peer_stream = NULL;
+  g_autofree uint8_t *buffer = NULL;
+  g_autofree char *uuid = NULL;
+  BufferData data = { 0, };
+  GThread *thread;
+  size_t n_read = 0;
+  GError *error = NULL;
+
+  test_bluez_service_new_connection (fixture, user_data);
+  valent_test_await_pending ();
+
+  g_object_get (fixture->channel, "muxer", &muxer, NULL);
+  g_object_get (fixture->endpoint, "muxer", &peer_muxer, NULL);
+
+  VALENT_TEST_CHECK ("Buffers grow while the reader keeps up");
+  uuid = g_uuid_string_random ();
+  data.muxer = muxer;
+  data.uuid = uuid;
+  thread = g_thread_new ("buffer", buffer_write_thread, &data);
+
+  peer_stream = valent_bluez_muxer_channel_accept (peer_muxer, uuid, NULL, &error);
+  g_assert_no_error (error);
+
+  buffer = g_malloc (BUFFER_TEST_SIZE);
+  while (n_read < BUFFER_TEST_SIZE)
+    {
+      gssize ret;
+
+      ret = g_input_stream_read (g_io_stream_get_input_stream (peer_stream),
+                                 buffer,
+                                 BUFFER_TEST_SIZE,
+                                 NULL,
+                                 &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (ret, >, 0);
+      n_read += ret;
+    }
+  stream = g_thread_join (thread);
+
+  g_assert_cmpuint (valent_bluez_muxer_channel_get_buffer_size (peer_muxer, uuid),
+                    >, 4096);
+
+  VALENT_TEST_CHECK ("Buffers are released when the channel is idle");
+  for (unsigned int i = 0; i < BUFFER_RELEASE_WINDOWS * BUFFER_SHRINK_MSEC / 100; i++)
+    {
+      if (valent_bluez_muxer_channel_get_buffer_size (peer_muxer, uuid) == 0)
+        break;
+
+      valent_test_await_timeout (100);
+    }
+  g_assert_cmpuint (valent_bluez_muxer_channel_get_buffer_size (peer_muxer, uuid),
+                    ==, 0);
+
+  g_io_stream_close (peer_stream, NULL, NULL);
+  g_io_stream_close (stream, NULL, NULL);
+}
+
+/*
+ * Throughput
+ */
+typedef struct
+{
+  ValentBluezMuxer *muxer;
+  char             *uuid;
+  int64_t           elapsed;
+} ThroughputData;
+
+static gpointer
+throughput_read_thread (gpointer user_data)
+{
+  ThroughputData *data = (ThroughputData *)user_data;
+  g_autoptr (GIOStream) stream = NULL;
+  g_autofree uint8_t *buffer = NULL;
+  GInputStream *input;
+  size_t n_read = 0;
+  int64_t begin;
+  GError *error = NULL;
+
+  stream = valent_bluez_muxer_channel_accept (data->muxer,
+                                              data->uuid,
+                                              NULL,
+                                              &error);
+  g_assert_no_error (error);
+
+  buffer = g_malloc (THROUGHPUT_CHUNK);
+  input = g_io_stream_get_input_stream (stream);
+  begin = g_get_monotonic_time ();
+
+  while (n_read < THROUGHPUT_SIZE)
+    {
+      gssize ret;
+
+      ret = g_input_stream_read (input, buffer, THROUGHPUT_CHUNK, NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (ret, >, 0);
+      n_read += ret;
+    }
+
+  data->elapsed = g_get_monotonic_time () - begin;
+  g_io_stream_close (stream, NULL, NULL);
+
+  return NULL;
+}
+
+static double
+throughput_measure (ValentBluezMuxer *muxer,
+                    ValentBluezMuxer *peer_muxer)
+{
+  g_autoptr (GIOStream) stream = NULL;
+  g_autofree uint8_t *buffer = NULL;
+  g_autofree char *uuid = NULL;
+  ThroughputData data = { 0, };
+  GOutputStream *output;
+  GThread *thread;
+  size_t n_written = 0;
+  GError *error = NULL;
+
+  uuid = g_uuid_string_random ();
+  data.muxer = peer_muxer;
+  data.uuid = uuid;
+  thread = g_thread_new ("throughput", throughput_read_thread, &data);
+
+  stream = valent_bluez_muxer_channel_open (muxer, uuid, NULL, &error);
+  g_assert_no_error (error);
+
+  buffer = g_malloc0 (THROUGHPUT_CHUNK);
+  output = g_io_stream_get_output_stream (stream);
+  while (n_written < THROUGHPUT_SIZE)
+    {
+      g_output_stream_write_all (output,
+                                 buffer,
+                                 THROUGHPUT_CHUNK,
+                                 NULL,
+                                 NULL,
+                                 &error);
+      g_assert_no_error (error);
+      n_written += THROUGHPUT_CHUNK;
+    }
+
+  g_thread_join (thread);
+  g_io_stream_close (stream, NULL, NULL);
+
+  return (THROUGHPUT_SIZE / (1024.0 * 1024.0)) / (data.elapsed / (double)G_USEC_PER_SEC);
+}
+
+static void
+test_bluez_muxer_throughput (BluezTestFixture *fixture,
+                             gconstpointer     user_data)
+{
+  g_autoptr (ValentBluezMuxer) muxer = NULL;
+  g_autoptr (ValentBluezMuxer) peer_muxer = NULL;
+  double fixed, adaptive;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in performance mode");
+      return;
+    }
+
+  test_bluez_service_new_connection (fixture, user_data);
+  valent_test_await_pending ();
+
+  g_object_get (fixture->channel, "muxer", &muxer, NULL);
+  g_object_get (fixture->endpoint, "muxer", &peer_muxer, NULL);
+
+  VALENT_TEST_CHECK ("Fixed-size buffers");
+  g_object_set (peer_muxer, "buffer-max-size", 4096, NULL);
+  fixed = throughput_measure (muxer, peer_muxer);
+  g_test_maximized_result (fixed, "fixed: %.1f MiB/s", fixed);
+
+  VALENT_TEST_CHECK ("Adaptive buffers");
+  g_object_set (peer_muxer, "buffer-max-size", 1024 * 1024, NULL);
+  adaptive = throughput_measure (muxer, peer_muxer);
+  g_test_maximized_result (adaptive, "adaptive: %.1f MiB/s", adaptive);
+
+  g_test_message ("Adaptive buffers: %.1fx throughput", adaptive / fixed);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -517,5 +747,17 @@ main (int   argc,
               test_bluez_service_channel,
               bluez_service_fixture_tear_down);
 
+  g_test_add ("/plugins/bluez/buffer",
+              BluezTestFixture, NULL,
+              bluez_service_fixture_set_up,
+              test_bluez_muxer_buffer,
+              bluez_service_fixture_tear_down);
+
+  g_test_add ("/plugins/bluez/throughput",
+              BluezTestFixture, NULL,
+              bluez_service_fixture_set_up,
+              test_bluez_muxer_throughput,
+              bluez_service_fixture_tear_down);
+
   return g_test_run ();
 }
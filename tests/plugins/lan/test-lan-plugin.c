@@ -12,6 +12,9 @@
 
 #define HANDSHAKE_TIMEOUT_MS            (1100)
 #define IDENTITY_BUFFER_MAX             (8192)
+#define PAYLOAD_LATENCY_FILES           (256)
+#define PAYLOAD_LATENCY_BURST           (32)
+#define ANNOUNCE_TARGETS                (1000)
 
 /* NOTE: These ports must be between 1716-1764 or they will trigger an error.
  *       Port 1716 is still avoided, since it would conflict with a running
@@ -571,8 +574,14 @@ test_lan_service_channel (LanTestFixture *fixture,
   g_autoptr (GFile) file = NULL;
   g_autofree char *host = NULL;
   unsigned int port;
+  g_autoptr (GSocketAddress) address = NULL;
+  g_autofree char *identity_json = NULL;
+  size_t identity_len;
+  uint64_t accepted = 0;
+  uint64_t suppressed = 0;
   gboolean download_done = FALSE;
   gboolean upload_done = FALSE;
+  GError *error = NULL;
 
   test_lan_service_incoming_broadcast (fixture, user_data);
 
@@ -585,6 +594,25 @@ test_lan_service_channel (LanTestFixture *fixture,
   g_assert_cmpstr (host, ==, ENDPOINT_HOST);
   g_assert_cmpuint (port, ==, ENDPOINT_PORT);
 
+  VALENT_TEST_CHECK ("Service ignores broadcasts from connected devices");
+  address = g_inet_socket_address_new_from_string (SERVICE_HOST, SERVICE_PORT);
+  identity_json = valent_packet_serialize (fixture->peer_identity, &identity_len);
+  g_socket_send_to (fixture->socket,
+                    address,
+                    identity_json,
+                    identity_len,
+                    NULL,
+                    &error);
+  g_assert_no_error (error);
+  valent_test_await_timeout (100);
+
+  g_object_get (fixture->service,
+                "discovery-accepted",   &accepted,
+                "discovery-suppressed", &suppressed,
+                NULL);
+  g_assert_cmpuint (accepted, ==, 1);
+  g_assert_cmpuint (suppressed, ==, 1);
+
   VALENT_TEST_CHECK ("Channel can send and receive packets");
   packet = valent_packet_new ("kdeconnect.mock.echo");
   valent_channel_write_packet (fixture->channel,
@@ -632,6 +660,305 @@ test_lan_service_channel (LanTestFixture *fixture,
   g_signal_handlers_disconnect_by_data (fixture->service, fixture);
 }
 
+static void
+payload_transfer (LanTestFixture *fixture,
+                  GFile          *file)
+{
+  g_autoptr (JsonNode) packet = NULL;
+  gboolean download_done = FALSE;
+  gboolean upload_done = FALSE;
+
+  packet = valent_packet_new ("kdeconnect.mock.transfer");
+  valent_test_upload (fixture->channel,
+                      packet,
+                      file,
+                      NULL, // cancellable
+                      (GAsyncReadyCallback)valent_test_upload_cb,
+                      &upload_done);
+  valent_channel_read_packet (fixture->endpoint,
+                              NULL, // cancellable
+                              (GAsyncReadyCallback)valent_channel_read_download_cb,
+                              &download_done);
+  valent_test_await_boolean (&upload_done);
+  valent_test_await_boolean (&download_done);
+}
+
+static void
+test_lan_service_payload_latency (LanTestFixture *fixture,
+                                  gconstpointer   user_data)
+{
+  g_autoptr (GFile) file = NULL;
+  g_autoptr (GTypeClass) client_class = NULL;
+  gboolean upload_done[PAYLOAD_LATENCY_BURST] = { FALSE, };
+  gboolean download_done[PAYLOAD_LATENCY_BURST] = { FALSE, };
+  gboolean resumable = FALSE;
+  int64_t begin, cold, warm, burst;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in performance mode");
+      return;
+    }
+
+  test_lan_service_incoming_broadcast (fixture, user_data);
+  file = g_file_new_for_uri ("resource:///tests/image.png");
+
+  VALENT_TEST_CHECK ("First transfer performs a full handshake");
+  begin = g_get_monotonic_time ();
+  payload_transfer (fixture, file);
+  cold = g_get_monotonic_time () - begin;
+  g_test_minimized_result (cold / 1000.0, "cold: %.2f ms/file", cold / 1000.0);
+
+  VALENT_TEST_CHECK ("Sequential transfers resume the TLS session");
+  client_class = g_type_class_ref (g_tls_backend_get_client_connection_type (g_tls_backend_get_default ()));
+  resumable = g_object_class_find_property (G_OBJECT_CLASS (client_class),
+                                            "session-resumed") != NULL;
+  if (resumable)
+    {
+      g_test_expect_message ("valent-lan-channel",
+                             G_LOG_LEVEL_DEBUG,
+                             "*resumed TLS session*");
+    }
+
+  begin = g_get_monotonic_time ();
+  for (size_t i = 0; i < PAYLOAD_LATENCY_FILES; i++)
+    payload_transfer (fixture, file);
+  warm = (g_get_monotonic_time () - begin) / PAYLOAD_LATENCY_FILES;
+
+  if (resumable)
+    g_test_assert_expected_messages ();
+  else
+    g_test_message ("Session resumption is not reported by this TLS backend");
+  g_test_minimized_result (warm / 1000.0, "warm: %.2f ms/file", warm / 1000.0);
+
+  VALENT_TEST_CHECK ("Concurrent transfers are limited without stalling");
+  begin = g_get_monotonic_time ();
+  for (size_t i = 0; i < PAYLOAD_LATENCY_BURST; i++)
+    {
+      g_autoptr (JsonNode) packet = NULL;
+
+      packet = valent_packet_new ("kdeconnect.mock.transfer");
+      valent_test_upload (fixture->channel,
+                          packet,
+                          file,
+                          NULL, // cancellable
+                          (GAsyncReadyCallback)valent_test_upload_cb,
+                          &upload_done[i]);
+      valent_channel_read_packet (fixture->endpoint,
+                                  NULL, // cancellable
+                                  (GAsyncReadyCallback)valent_channel_read_download_cb,
+                                  &download_done[i]);
+    }
+
+  for (size_t i = 0; i < PAYLOAD_LATENCY_BURST; i++)
+    {
+      valent_test_await_boolean (&upload_done[i]);
+      valent_test_await_boolean (&download_done[i]);
+    }
+  burst = (g_get_monotonic_time () - begin) / PAYLOAD_LATENCY_BURST;
+  g_test_minimized_result (burst / 1000.0, "burst: %.2f ms/file", burst / 1000.0);
+
+  valent_channel_close (fixture->endpoint, NULL, NULL);
+  valent_channel_close (fixture->channel, NULL, NULL);
+
+  g_signal_handlers_disconnect_by_data (fixture->service, fixture);
+}
+
+static unsigned int
+announce_drain (GSocket *socket)
+{
+  char buffer[IDENTITY_BUFFER_MAX];
+  unsigned int n_read = 0;
+
+  while (g_socket_receive (socket, buffer, sizeof (buffer), NULL, NULL) > 0)
+    n_read++;
+
+  return n_read;
+}
+
+static void
+test_lan_announce_batch (void)
+{
+  g_autoptr (GSocket) sender = NULL;
+  g_autoptr (GSocket) receiver = NULL;
+  g_autoptr (GInetAddress) any = NULL;
+  g_autoptr (GSocketAddress) bind_address = NULL;
+  g_autoptr (GSocketAddress) local_address = NULL;
+  g_autoptr (GPtrArray) targets = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (JsonNode) identity = NULL;
+  char *identity_json = NULL;
+  size_t identity_len;
+  uint16_t port;
+  unsigned int offset = 0;
+  unsigned int n_received = 0;
+  int64_t begin, unbatched, batched;
+  GError *error = NULL;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in performance mode");
+      return;
+    }
+
+  /* The receiver is bound to the wildcard address, so it receives datagrams
+   * for every address in 127.0.0.0/8.
+   */
+  receiver = g_socket_new (G_SOCKET_FAMILY_IPV4,
+                           G_SOCKET_TYPE_DATAGRAM,
+                           G_SOCKET_PROTOCOL_UDP,
+                           &error);
+  g_assert_no_error (error);
+
+  any = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
+  bind_address = g_inet_socket_address_new (any, 0);
+  g_socket_bind (receiver, bind_address, TRUE, &error);
+  g_assert_no_error (error);
+  g_socket_set_blocking (receiver, FALSE);
+
+  local_address = g_socket_get_local_address (receiver, &error);
+  g_assert_no_error (error);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local_address));
+
+  sender = g_socket_new (G_SOCKET_FAMILY_IPV4,
+                         G_SOCKET_TYPE_DATAGRAM,
+                         G_SOCKET_PROTOCOL_UDP,
+                         &error);
+  g_assert_no_error (error);
+  g_socket_set_blocking (sender, FALSE);
+
+  targets = g_ptr_array_new_with_free_func (g_object_unref);
+  for (unsigned int i = 0; i < ANNOUNCE_TARGETS; i++)
+    {
+      g_autofree char *host = NULL;
+
+      host = g_strdup_printf ("127.0.%u.%u", i / 250, (i % 250) + 1);
+      g_ptr_array_add (targets, g_inet_socket_address_new_from_string (host, port));
+    }
+
+  identity = valent_packet_new ("kdeconnect.identity");
+  identity_json = valent_packet_serialize (identity, &identity_len);
+  bytes = g_bytes_new_take (identity_json, identity_len);
+
+  VALENT_TEST_CHECK ("Announcing with one system call per address");
+  begin = g_get_monotonic_time ();
+  for (unsigned int i = 0; i < targets->len; i++)
+    {
+      while (g_socket_send_to (sender,
+                               g_ptr_array_index (targets, i),
+                               g_bytes_get_data (bytes, NULL),
+                               g_bytes_get_size (bytes),
+                               NULL,
+                               &error) == -1)
+        {
+          g_assert_error (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK);
+          g_clear_error (&error);
+          announce_drain (receiver);
+          g_socket_condition_wait (sender, G_IO_OUT, NULL, NULL);
+        }
+    }
+  unbatched = g_get_monotonic_time () - begin;
+  announce_drain (receiver);
+  g_test_minimized_result (unbatched / 1000.0,
+                           "unbatched: %.2f ms/%u addresses",
+                           unbatched / 1000.0, ANNOUNCE_TARGETS);
+
+  VALENT_TEST_CHECK ("Announcing in batches");
+  begin = g_get_monotonic_time ();
+  while ((offset = valent_lan_socket_send_batch (sender, targets, offset, bytes, &error)) < targets->len)
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK);
+      g_clear_error (&error);
+      n_received += announce_drain (receiver);
+      g_socket_condition_wait (sender, G_IO_OUT, NULL, NULL);
+    }
+  g_assert_no_error (error);
+  batched = g_get_monotonic_time () - begin;
+  n_received += announce_drain (receiver);
+  g_test_minimized_result (batched / 1000.0,
+                           "batched: %.2f ms/%u addresses",
+                           batched / 1000.0, ANNOUNCE_TARGETS);
+
+  g_assert_cmpuint (n_received, >, 0);
+  g_test_message ("Batched announcements: %.1fx faster, %u/%u received",
+                  (double)unbatched / (double)MAX (batched, 1),
+                  n_received, ANNOUNCE_TARGETS);
+}
+
+static void
+test_lan_socket_send_batch (void)
+{
+  g_autoptr (GSocket) sender = NULL;
+  g_autoptr (GSocket) receiver = NULL;
+  g_autoptr (GInetAddress) loopback = NULL;
+  g_autoptr (GSocketAddress) bind_address = NULL;
+  g_autoptr (GSocketAddress) local_address = NULL;
+  g_autoptr (GPtrArray) targets = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  uint16_t port;
+  unsigned int offset = 0;
+  unsigned int n_received = 0;
+  GError *error = NULL;
+
+  receiver = g_socket_new (G_SOCKET_FAMILY_IPV4,
+                           G_SOCKET_TYPE_DATAGRAM,
+                           G_SOCKET_PROTOCOL_UDP,
+                           &error);
+  g_assert_no_error (error);
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  bind_address = g_inet_socket_address_new (loopback, 0);
+  g_socket_bind (receiver, bind_address, TRUE, &error);
+  g_assert_no_error (error);
+  g_socket_set_blocking (receiver, FALSE);
+
+  local_address = g_socket_get_local_address (receiver, &error);
+  g_assert_no_error (error);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local_address));
+
+  sender = g_socket_new (G_SOCKET_FAMILY_IPV4,
+                         G_SOCKET_TYPE_DATAGRAM,
+                         G_SOCKET_PROTOCOL_UDP,
+                         &error);
+  g_assert_no_error (error);
+  g_socket_set_blocking (sender, FALSE);
+
+  /* An IPv6 destination can not be reached from an IPv4 socket
+   */
+  targets = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (targets, g_inet_socket_address_new_from_string ("127.0.0.1", port));
+  g_ptr_array_add (targets, g_inet_socket_address_new_from_string ("::1", port));
+  g_ptr_array_add (targets, g_inet_socket_address_new_from_string ("127.0.0.1", port));
+  bytes = g_bytes_new_static ("announce", sizeof ("announce") - 1);
+
+  VALENT_TEST_CHECK ("Failed destinations are reported and skipped");
+  g_test_expect_message ("valent-lan-utils",
+                         G_LOG_LEVEL_WARNING,
+                         "*failed to announce*::1*");
+  offset = valent_lan_socket_send_batch (sender, targets, offset, bytes, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (offset, ==, targets->len);
+  g_test_assert_expected_messages ();
+
+  VALENT_TEST_CHECK ("Datagrams are sent to the remaining destinations");
+  while (n_received < 2)
+    {
+      g_socket_condition_timed_wait (receiver,
+                                     G_IO_IN,
+                                     G_USEC_PER_SEC,
+                                     NULL,
+                                     &error);
+      g_assert_no_error (error);
+      n_received += announce_drain (receiver);
+    }
+  g_assert_cmpuint (n_received, ==, 2);
+
+  VALENT_TEST_CHECK ("Sending resumes at the given offset");
+  offset = valent_lan_socket_send_batch (sender, targets, targets->len, bytes, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (offset, ==, targets->len);
+}
+
 /*
  * Compliance Tests
  */
@@ -831,6 +1158,18 @@ main (int   argc,
               test_lan_service_channel,
               lan_service_fixture_tear_down);
 
+  g_test_add ("/plugins/lan/payload-latency",
+              LanTestFixture, NULL,
+              lan_service_fixture_set_up,
+              test_lan_service_payload_latency,
+              lan_service_fixture_tear_down);
+
+  g_test_add_func ("/plugins/lan/announce-batch",
+                   test_lan_announce_batch);
+
+  g_test_add_func ("/plugins/lan/socket-send-batch",
+                   test_lan_socket_send_batch);
+
   for (size_t i = 0; i < G_N_ELEMENTS (compliance_tests); i++)
     {
       g_test_add_data_func (compliance_tests[i].name,
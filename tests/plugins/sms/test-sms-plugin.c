@@ -2,9 +2,17 @@
 // SPDX-FileCopyrightText: Andy Holmes <andrew.g.r.holmes@gmail.com>
 
 #include <gio/gio.h>
+#include <libtracker-sparql/tracker-sparql.h>
 #include <valent.h>
 #include <libvalent-test.h>
 
+#include "valent-sms-device.h"
+
+#define INGEST_MESSAGES    (100000)
+#define INGEST_THREADS     (50)
+
+#define MESSAGE_DATE(i)    (1543541695320 + (int64_t)(i) * 1000)
+
 static void
 test_sms_plugin_basic (ValentTestFixture *fixture,
                        gconstpointer      user_data)
@@ -170,6 +178,375 @@ test_sms_plugin_handle_attachment (ValentTestFixture *fixture,
   valent_test_await_pending ();
 }
 
+static JsonNode *
+messages_new (int64_t      thread_id,
+              unsigned int offset,
+              unsigned int n_messages)
+{
+  g_autoptr (JsonBuilder) builder = NULL;
+
+  builder = json_builder_new ();
+  json_builder_begin_array (builder);
+  for (unsigned int i = offset; i < offset + n_messages; i++)
+    {
+      g_autofree char *body = g_strdup_printf ("Message %u", i);
+
+      json_builder_begin_object (builder);
+      json_builder_set_member_name (builder, "_id");
+      json_builder_add_int_value (builder, i);
+      json_builder_set_member_name (builder, "thread_id");
+      json_builder_add_int_value (builder, thread_id);
+      json_builder_set_member_name (builder, "date");
+      json_builder_add_int_value (builder, MESSAGE_DATE (i));
+      json_builder_set_member_name (builder, "type");
+      json_builder_add_int_value (builder, (i % 2) ? VALENT_MESSAGE_BOX_INBOX
+                                                   : VALENT_MESSAGE_BOX_SENT);
+      json_builder_set_member_name (builder, "read");
+      json_builder_add_int_value (builder, 1);
+      json_builder_set_member_name (builder, "body");
+      json_builder_add_string_value (builder, body);
+      json_builder_set_member_name (builder, "sub_id");
+      json_builder_add_int_value (builder, -1);
+      json_builder_set_member_name (builder, "addresses");
+      json_builder_begin_array (builder);
+      json_builder_begin_object (builder);
+      json_builder_set_member_name (builder, "address");
+      json_builder_add_string_value (builder, "+1-234-567-8910");
+      json_builder_end_object (builder);
+      json_builder_end_array (builder);
+      json_builder_end_object (builder);
+    }
+  json_builder_end_array (builder);
+
+  return json_builder_get_root (builder);
+}
+
+static JsonNode *
+messages_packet_new (int64_t      thread_id,
+                     unsigned int offset,
+                     unsigned int n_messages)
+{
+  g_autoptr (JsonBuilder) builder = NULL;
+
+  valent_packet_init (&builder, "kdeconnect.sms.messages");
+  json_builder_set_member_name (builder, "messages");
+  json_builder_add_value (builder, messages_new (thread_id, offset, n_messages));
+
+  return valent_packet_end (&builder);
+}
+
+static void
+test_sms_plugin_sync_resume (ValentTestFixture *fixture,
+                             gconstpointer      user_data)
+{
+  g_autoptr (TrackerSparqlConnection) connection = NULL;
+  g_autoptr (GFile) ontology = NULL;
+  g_autoptr (ValentContext) context = NULL;
+  g_autoptr (GFile) file = NULL;
+  g_autoptr (ValentSmsDevice) adapter = NULL;
+  g_autofree char *state = NULL;
+  unsigned int n_committed = 0;
+  JsonNode *packet;
+  g_autoptr (GError) error = NULL;
+
+  ontology = g_file_new_for_uri ("resource:///ca/andyholmes/Valent/ontologies/");
+  connection = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+                                              NULL,
+                                              ontology,
+                                              NULL,
+                                              &error);
+  g_assert_no_error (error);
+
+  /* A sync of thread 7 was interrupted after receiving messages 150-249
+   */
+  context = valent_context_new (NULL, "plugin", "sms");
+  file = valent_context_get_data_file (context, "sync-state.ini");
+  state = g_strdup_printf ("[7]\n"
+                           "newest=%"G_GINT64_FORMAT"\n"
+                           "cursor=%"G_GINT64_FORMAT"\n"
+                           "oldest=0\n",
+                           MESSAGE_DATE (249),
+                           MESSAGE_DATE (150));
+  g_file_replace_contents (file, state, strlen (state),
+                           NULL, FALSE, G_FILE_CREATE_NONE, NULL,
+                           NULL, &error);
+  g_assert_no_error (error);
+
+  adapter = g_object_new (VALENT_TYPE_SMS_DEVICE,
+                          "iri",        "urn:valent:messages:resume",
+                          "connection", connection,
+                          "context",    context,
+                          "parent",     fixture->device,
+                          NULL);
+
+  valent_test_fixture_connect (fixture);
+
+  VALENT_TEST_CHECK ("Adapters request the threads on connect");
+  for (unsigned int i = 0; i < 2; i++)
+    {
+      packet = valent_test_fixture_expect_packet (fixture);
+      v_assert_packet_type (packet, "kdeconnect.sms.request_conversations");
+      json_node_unref (packet);
+    }
+
+  VALENT_TEST_CHECK ("Adapter resumes an interrupted sync");
+  packet = messages_packet_new (7, 249, 1);
+  valent_sms_device_handle_messages (adapter, packet);
+  json_node_unref (packet);
+
+  packet = valent_test_fixture_expect_packet (fixture);
+  v_assert_packet_type (packet, "kdeconnect.sms.request_conversation");
+  v_assert_packet_cmpint (packet, "threadID", ==, 7);
+  v_assert_packet_cmpint (packet, "rangeStartTimestamp", ==, MESSAGE_DATE (150));
+  json_node_unref (packet);
+
+  VALENT_TEST_CHECK ("Adapter requests the next page");
+  packet = messages_packet_new (7, 51, 100);
+  valent_sms_device_handle_messages (adapter, packet);
+  json_node_unref (packet);
+
+  packet = valent_test_fixture_expect_packet (fixture);
+  v_assert_packet_type (packet, "kdeconnect.sms.request_conversation");
+  v_assert_packet_cmpint (packet, "threadID", ==, 7);
+  v_assert_packet_cmpint (packet, "rangeStartTimestamp", ==, MESSAGE_DATE (51));
+  json_node_unref (packet);
+
+  VALENT_TEST_CHECK ("Adapter drops duplicate pages");
+  packet = messages_packet_new (7, 51, 100);
+  valent_sms_device_handle_messages (adapter, packet);
+  json_node_unref (packet);
+
+  packet = messages_packet_new (7, 0, 52);
+  valent_sms_device_handle_messages (adapter, packet);
+  json_node_unref (packet);
+
+  while (n_committed < 1 + 100 + 52)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      valent_sms_device_get_ingest_progress (adapter, NULL, &n_committed, NULL);
+    }
+  g_assert_cmpuint (n_committed, ==, 1 + 100 + 52);
+
+  valent_object_destroy (VALENT_OBJECT (adapter));
+  valent_test_await_pending ();
+}
+
+/*< private >
+ * sync_history:
+ * @fixture: a `ValentTestFixture`
+ * @adapter: a `ValentSmsDevice`
+ * @n_threads: the number of threads
+ * @n_messages: the number of messages in each thread
+ * @n_queued_max: (out) (optional): the peak queue depth
+ *
+ * Announce the latest message in each thread, then answer requests from
+ * @adapter with pages of the history, as a device would.
+ *
+ * Returns: the number of messages sent to @adapter
+ */
+static unsigned int
+sync_history (ValentTestFixture *fixture,
+              ValentSmsDevice   *adapter,
+              unsigned int       n_threads,
+              unsigned int       n_messages,
+              unsigned int      *n_queued_max)
+{
+  unsigned int n_sent = 0;
+  unsigned int n_finished = 0;
+  unsigned int n_queued = 0;
+  JsonNode *packet;
+
+  for (unsigned int t = 1; t <= n_threads; t++)
+    {
+      packet = messages_packet_new (t, t * n_messages - 1, 1);
+      valent_sms_device_handle_messages (adapter, packet);
+      json_node_unref (packet);
+      n_sent += 1;
+    }
+
+  while (n_finished < n_threads)
+    {
+      int64_t thread_id, timestamp, n_requested;
+      unsigned int first, last, n_page;
+
+      packet = valent_test_fixture_expect_packet (fixture);
+      v_assert_packet_type (packet, "kdeconnect.sms.request_conversation");
+      g_assert_true (valent_packet_get_int (packet, "threadID", &thread_id));
+      g_assert_true (valent_packet_get_int (packet, "rangeStartTimestamp", &timestamp));
+      g_assert_true (valent_packet_get_int (packet, "numberToRequest", &n_requested));
+      json_node_unref (packet);
+
+      /* Answer with the page ending at the requested message, inclusive
+       */
+      first = (thread_id - 1) * n_messages;
+      last = (timestamp - MESSAGE_DATE (0)) / 1000;
+      n_page = MIN ((unsigned int)n_requested, last - first + 1);
+
+      packet = messages_packet_new (thread_id, last - n_page + 1, n_page);
+      valent_sms_device_handle_messages (adapter, packet);
+      json_node_unref (packet);
+      n_sent += n_page;
+
+      if (n_page < n_requested)
+        n_finished += 1;
+
+      valent_sms_device_get_ingest_progress (adapter, &n_queued, NULL, NULL);
+      if (n_queued_max != NULL)
+        *n_queued_max = MAX (*n_queued_max, n_queued);
+    }
+
+  return n_sent;
+}
+
+static void
+test_sms_plugin_handle_history (ValentTestFixture *fixture,
+                                gconstpointer      user_data)
+{
+  g_autoptr (TrackerSparqlConnection) connection = NULL;
+  g_autoptr (TrackerSparqlCursor) cursor = NULL;
+  g_autoptr (GFile) ontology = NULL;
+  g_autoptr (ValentContext) context = NULL;
+  g_autoptr (ValentSmsDevice) adapter = NULL;
+  unsigned int n_sent = 0;
+  unsigned int n_queued = 0;
+  unsigned int n_committed = 0;
+  JsonNode *packet;
+  g_autoptr (GError) error = NULL;
+
+  ontology = g_file_new_for_uri ("resource:///ca/andyholmes/Valent/ontologies/");
+  connection = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+                                              NULL,
+                                              ontology,
+                                              NULL,
+                                              &error);
+  g_assert_no_error (error);
+
+  context = valent_context_new (NULL, "plugin", "sms-history");
+  adapter = g_object_new (VALENT_TYPE_SMS_DEVICE,
+                          "iri",        "urn:valent:messages:history",
+                          "connection", connection,
+                          "context",    context,
+                          "parent",     fixture->device,
+                          NULL);
+
+  valent_test_fixture_connect (fixture);
+
+  VALENT_TEST_CHECK ("Adapters request the threads on connect");
+  for (unsigned int i = 0; i < 2; i++)
+    {
+      packet = valent_test_fixture_expect_packet (fixture);
+      v_assert_packet_type (packet, "kdeconnect.sms.request_conversations");
+      json_node_unref (packet);
+    }
+
+  VALENT_TEST_CHECK ("Adapter imports the history of each thread");
+  n_sent = sync_history (fixture, adapter, 3, 250, NULL);
+
+  while (n_committed < n_sent)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      valent_sms_device_get_ingest_progress (adapter, &n_queued, &n_committed, NULL);
+    }
+  g_assert_cmpuint (n_queued, ==, 0);
+  g_assert_cmpuint (n_committed, ==, n_sent);
+
+  cursor = tracker_sparql_connection_query (connection,
+                                            "SELECT (COUNT(?message) AS ?count) "
+                                            "WHERE { ?message rdf:type vmo:PhoneMessage }",
+                                            NULL,
+                                            &error);
+  g_assert_no_error (error);
+  g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+  g_assert_cmpint (tracker_sparql_cursor_get_integer (cursor, 0), ==, 3 * 250);
+  tracker_sparql_cursor_close (cursor);
+
+  valent_object_destroy (VALENT_OBJECT (adapter));
+  valent_test_await_pending ();
+}
+
+static void
+test_sms_plugin_ingest (ValentTestFixture *fixture,
+                        gconstpointer      user_data)
+{
+  g_autoptr (TrackerSparqlConnection) connection = NULL;
+  g_autoptr (TrackerSparqlCursor) cursor = NULL;
+  g_autoptr (GFile) ontology = NULL;
+  g_autoptr (ValentContext) context = NULL;
+  g_autoptr (ValentSmsDevice) adapter = NULL;
+  unsigned int n_sent = 0;
+  unsigned int n_queued_max = 0;
+  unsigned int n_committed = 0;
+  JsonNode *packet;
+  int64_t begin, end;
+  double rate;
+  g_autoptr (GError) error = NULL;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in performance mode");
+      return;
+    }
+
+  ontology = g_file_new_for_uri ("resource:///ca/andyholmes/Valent/ontologies/");
+  connection = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+                                              NULL,
+                                              ontology,
+                                              NULL,
+                                              &error);
+  g_assert_no_error (error);
+
+  context = valent_context_new (NULL, "plugin", "sms-benchmark");
+  adapter = g_object_new (VALENT_TYPE_SMS_DEVICE,
+                          "iri",        "urn:valent:messages:benchmark",
+                          "connection", connection,
+                          "context",    context,
+                          "parent",     fixture->device,
+                          NULL);
+
+  valent_test_fixture_connect (fixture);
+
+  for (unsigned int i = 0; i < 2; i++)
+    {
+      packet = valent_test_fixture_expect_packet (fixture);
+      v_assert_packet_type (packet, "kdeconnect.sms.request_conversations");
+      json_node_unref (packet);
+    }
+
+  /* Answer each page request as it arrives, as a device would
+   */
+  VALENT_TEST_CHECK ("Adapter imports a full message history");
+  begin = g_get_monotonic_time ();
+  n_sent = sync_history (fixture,
+                         adapter,
+                         INGEST_THREADS,
+                         INGEST_MESSAGES / INGEST_THREADS,
+                         &n_queued_max);
+
+  while (n_committed < n_sent)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      valent_sms_device_get_ingest_progress (adapter, NULL, &n_committed, NULL);
+    }
+  end = g_get_monotonic_time ();
+
+  cursor = tracker_sparql_connection_query (connection,
+                                            "SELECT (COUNT(?message) AS ?count) "
+                                            "WHERE { ?message rdf:type vmo:PhoneMessage }",
+                                            NULL,
+                                            &error);
+  g_assert_no_error (error);
+  g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+  g_assert_cmpint (tracker_sparql_cursor_get_integer (cursor, 0), ==, INGEST_MESSAGES);
+  tracker_sparql_cursor_close (cursor);
+
+  rate = n_sent / ((end - begin) / (double)G_USEC_PER_SEC);
+  g_test_maximized_result (rate, "%.0f messages/s", rate);
+  g_test_message ("Peak queue depth: %u messages", n_queued_max);
+
+  valent_object_destroy (VALENT_OBJECT (adapter));
+  valent_test_await_pending ();
+}
+
 #if 0
 static const char *schemas[] = {
   "/tests/kdeconnect.sms.attachment_file.json",
@@ -219,6 +596,24 @@ main (int   argc,
               test_sms_plugin_handle_attachment,
               valent_test_fixture_clear);
 
+  g_test_add ("/plugins/sms/sync-resume",
+              ValentTestFixture, path,
+              valent_test_fixture_init,
+              test_sms_plugin_sync_resume,
+              valent_test_fixture_clear);
+
+  g_test_add ("/plugins/sms/handle-history",
+              ValentTestFixture, path,
+              valent_test_fixture_init,
+              test_sms_plugin_handle_history,
+              valent_test_fixture_clear);
+
+  g_test_add ("/plugins/sms/ingest",
+              ValentTestFixture, path,
+              valent_test_fixture_init,
+              test_sms_plugin_ingest,
+              valent_test_fixture_clear);
+
 #if 0
   g_test_add ("/plugins/sms/fuzz",
               ValentTestFixture, path,